@@ -76,13 +76,13 @@
 #include "dsda/analysis.h"
 #include "dsda/args.h"
 #include "dsda/endoom.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/split_tracker.h"
 #include "dsda/text_file.h"
 #include "dsda/time.h"
 #include "dsda/wad_stats.h"
-#include "dsda/zipfile.h"
 
 /* Most of the following has been rewritten by Lee Killough
  *
@@ -207,12 +207,9 @@ static void I_EssentialQuit (void)
   dsda_WriteAnalysis();
   dsda_WriteSplits();
   dsda_SaveWadStats();
-  // We need to close out all wad handles/memory mappings before we can remove
-  // temporary wads on Windows
   // Read Endoom before dumping the wads!
   dsda_CacheEndoom();
   W_Shutdown();
-  dsda_CleanZipTempDirs();
 }
 
 static void I_Quit (void)
@@ -314,6 +311,9 @@ int main(int argc, char **argv)
 
   I_AtExit(I_EssentialQuit, true, "I_EssentialQuit", exit_priority_first);
   I_AtExit(I_Quit, false, "I_Quit", exit_priority_last);
+  if (dsda_Flag(dsda_arg_memstats))
+    I_AtExit(Z_PrintStats, true, "Z_PrintStats", exit_priority_first);
+  dsda_InitProfiler();
 #ifndef PRBOOM_DEBUG
   if (!dsda_Flag(dsda_arg_sigsegv))
   {
@@ -107,6 +107,8 @@ typedef struct
   int leftvol;
   int rightvol;
   dboolean loop;
+  // Sound lump locked while the channel plays, or -1
+  int lumpnum;
 } channel_info_t;
 
 channel_info_t channelinfo[MAX_CHANNELS];
@@ -156,6 +158,20 @@ static void stopchan(int i)
   }
 }
 
+// Channels are also stopped by the mixer, which runs on the audio thread,
+// so their lumps are unlocked later from the main thread (under sfxmutex)
+static void unlockstoppedchans(void)
+{
+  int i;
+
+  for (i = 0; i < MAX_CHANNELS; i++)
+    if (!channelinfo[i].data && channelinfo[i].lumpnum >= 0)
+    {
+      W_UnlockLumpNum(channelinfo[i].lumpnum);
+      channelinfo[i].lumpnum = -1;
+    }
+}
+
 typedef struct wav_data_s
 {
   int sfxid;
@@ -253,15 +269,22 @@ static wav_data_t *GetWavData(int sfxid, const unsigned char *data, size_t len)
 //  (eight, usually) of internal channels.
 // Returns a handle.
 //
-static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
+static int addsfx(int sfxid, int channel, int lump, const unsigned char *data, size_t len)
 {
   channel_info_t *ci = channelinfo + channel;
+  zone_category_t category = Z_SetCategory(ZONE_CAT_SOUND);
   wav_data_t *wav_data = GetWavData(sfxid, data, len);
 
+  Z_SetCategory(category);
+
   stopchan(channel);
+  unlockstoppedchans();
 
   if (wav_data)
   {
+    // converted samples are kept separately, so the lump isn't needed
+    W_UnlockLumpNum(lump);
+
     ci->data = wav_data->data;
     ci->enddata = ci->data + wav_data->samplelen - 1;
     ci->samplerate = wav_data->samplerate;
@@ -269,6 +292,7 @@ static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
   }
   else
   {
+    ci->lumpnum = lump;
     ci->data = data;
     /* Set pointer to end of raw data. */
     ci->enddata = ci->data + len - 1;
@@ -400,6 +424,7 @@ void I_SetChannels(void)
   for (i = 0; i < MAX_CHANNELS; i++)
   {
     memset(&channelinfo[i], 0, sizeof(channel_info_t));
+    channelinfo[i].lumpnum = -1;
   }
 
   // This table provides step widths for pitch parameters.
@@ -484,7 +509,7 @@ int I_StartSound(int id, int channel, sfx_params_t *params)
   SDL_LockMutex (sfxmutex);
 
   // Returns a handle (not used).
-  addsfx(id, channel, data, len);
+  addsfx(id, channel, lump, data, len);
   updateSoundParams(channel, params);
 
   SDL_UnlockMutex (sfxmutex);
@@ -504,6 +529,7 @@ void I_StopSound (int handle)
 
   SDL_LockMutex (sfxmutex);
   stopchan(handle);
+  unlockstoppedchans();
   SDL_UnlockMutex (sfxmutex);
 }
 
@@ -1312,8 +1338,10 @@ static int RegisterSongEx (const void *data, size_t len, int try_mus2mid)
 static int RegisterSong (const void *data, size_t len)
 {
   int result;
+  zone_category_t category = Z_SetCategory(ZONE_CAT_SOUND);
 
   result = RegisterSongEx (data, len, 1);
+  Z_SetCategory(category);
 
   if (result)
     registered_non_rw = true;
@@ -88,6 +88,7 @@
 #include "dsda/game_controller.h"
 #include "dsda/palette.h"
 #include "dsda/pause.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/time.h"
 #include "dsda/gl/render_scale.h"
@@ -580,7 +581,7 @@ void I_HandleCapture(void)
 static int newpal = 0;
 #define NO_PALETTE_CHANGE 1000
 
-void I_FinishUpdate (void)
+static void I_PresentFrame (void)
 {
   //e6y: new mouse code
   UpdateGrab();
@@ -645,6 +646,13 @@ void I_FinishUpdate (void)
   SDL_RenderPresent(sdl_renderer);
 }
 
+void I_FinishUpdate (void)
+{
+  DSDA_PROFILE_BEGIN(dsda_profile_finish_update);
+  I_PresentFrame();
+  DSDA_PROFILE_END(dsda_profile_finish_update);
+}
+
 //
 // I_ScreenShot - moved to i_sshot.c
 //
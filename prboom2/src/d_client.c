@@ -61,6 +61,7 @@
 #include "e6y.h"
 
 #include "dsda/args.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/time.h"
 
@@ -145,7 +146,9 @@ void TryRunTics (void)
     if (advancedemo)
       D_DoAdvanceDemo ();
     M_Ticker ();
+    DSDA_PROFILE_BEGIN(dsda_profile_tic);
     G_Ticker ();
+    DSDA_PROFILE_END(dsda_profile_tic);
     gametic++;
     FakeNetUpdate();
   }
@@ -63,6 +63,7 @@
 #include "dsda/sprite.h"
 #include "dsda/state.h"
 #include "dsda/utility.h"
+#include "dsda/zipfile.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -1669,7 +1670,16 @@ void ProcessDehFile(const char *filename, const char *outfilename, int lumpnum)
 
   // killough 10/98: allow DEH files to come from wad lumps
 
-  if (filename)
+  if (filename && dsda_ZipEntry(filename))
+  {
+    dsda_zip_entry_t* entry = dsda_ZipEntry(filename);
+
+    // archive members are parsed like lumps, straight from memory
+    infile.size = entry->size;
+    infile.inp = infile.lump = dsda_ZipEntryData(entry);
+    file_or_lump = "file";
+  }
+  else if (filename)
   {
     if (!(infile.f = M_OpenFile(filename, "rt")))
     {
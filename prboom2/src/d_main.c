@@ -89,6 +89,7 @@
 #include "dsda/exdemo.h"
 #include "dsda/features.h"
 #include "dsda/global.h"
+#include "dsda/profiler.h"
 #include "dsda/save.h"
 #include "dsda/data_organizer.h"
 #include "dsda/map_format.h"
@@ -341,7 +342,7 @@ void D_MustFillBackScreen(void)
   must_fill_back_screen = true;
 }
 
-void D_Display (fixed_t frac)
+static void D_DrawDisplay (fixed_t frac)
 {
   static dboolean isborderstate        = false;
   static dboolean borderwillneedredraw = false;
@@ -524,6 +525,13 @@ void D_Display (fixed_t frac)
   I_EndDisplay();
 }
 
+void D_Display (fixed_t frac)
+{
+  DSDA_PROFILE_BEGIN(dsda_profile_frame);
+  D_DrawDisplay(frac);
+  DSDA_PROFILE_END(dsda_profile_frame);
+}
+
 //
 //  D_DoomLoop()
 //
@@ -557,7 +565,9 @@ static void D_DoomLoop(void)
       if (advancedemo)
         D_DoAdvanceDemo ();
       M_Ticker ();
+      DSDA_PROFILE_BEGIN(dsda_profile_tic);
       G_Ticker ();
+      DSDA_PROFILE_END(dsda_profile_tic);
       gametic++;
       maketic++;
     }
@@ -1363,17 +1373,31 @@ static void LoadDehackedFilesAtPath(const char *path, dboolean defer_loading, de
     I_EndGlob(glob);
 }
 
+// Archive members are loaded in place, named "<archive>/<member>"
+
 static void D_AddZip(const char* zipped_file_name, wad_source_t source, deh_queue_t *deh_queue)
 {
+  int i;
   char* full_zip_path;
-  const char* temporary_directory;
+  dsda_zip_entry_t** entries;
 
   full_zip_path = I_RequireZip(zipped_file_name);
-  temporary_directory = dsda_UnzipFile(full_zip_path);
+  entries = dsda_OpenZipFile(full_zip_path);
+
+  for (i = 0; entries[i]; ++i)
+    if (dsda_HasFileExt(entries[i]->name, ".wad") || dsda_HasFileExt(entries[i]->name, ".lmp"))
+      D_AddFile(entries[i]->name, source);
 
-  LoadWADsAtPath(temporary_directory, source);
-  LoadDehackedFilesAtPath(temporary_directory, true, deh_queue);
+  for (i = 0; entries[i]; ++i)
+    if (dsda_HasFileExt(entries[i]->name, ".deh") || dsda_HasFileExt(entries[i]->name, ".bex"))
+    {
+      if (deh_queue)
+        D_QueueAutoloadDeh(deh_queue, entries[i]->name);
+      else
+        dsda_AppendStringArg(dsda_arg_deh, entries[i]->name);
+    }
 
+  Z_Free(entries);
   Z_Free(full_zip_path);
 }
 
@@ -1897,7 +1921,10 @@ static void D_DoomMainSetup(void)
     {
       char *file = NULL;
 
-      file = I_RequireDeh(arg->value.v_string_array[i]);
+      if (dsda_ZipEntry(arg->value.v_string_array[i]))
+        file = Z_Strdup(arg->value.v_string_array[i]);
+      else
+        file = I_RequireDeh(arg->value.v_string_array[i]);
 
       // during the beta we have debug output to dehout.txt
       ProcessDehFile(file,D_dehout(),0);
@@ -110,6 +110,12 @@ typedef unsigned char byte;
   #define INLINE inline        /* use standard inline */
 #endif
 
+#ifdef _MSC_VER
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL __thread
+#endif
+
 typedef enum {
   doom_12_compatibility,   /* Doom v1.2 */
   doom_1666_compatibility, /* Doom v1.666 */
@@ -40,6 +40,7 @@
 #include "dsda/split_tracker.h"
 #include "dsda/tracker.h"
 #include "dsda/wad_stats.h"
+#include "dsda/world_hash.h"
 #include "dsda.h"
 
 #define TELEFRAG_DAMAGE 10000
@@ -178,6 +179,14 @@ void dsda_ReadCommandLine(void) {
   if (arg->found)
     dsda_InitGhostImport(arg->value.v_string_array, arg->count);
 
+  arg = dsda_Arg(dsda_arg_export_world_hash);
+  if (arg->found)
+    dsda_InitWorldHashExport(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_check_world_hash);
+  if (arg->found)
+    dsda_InitWorldHashCheck(arg->value.v_string);
+
   if (dsda_Flag(dsda_arg_tas) || dsda_Flag(dsda_arg_build)) dsda_SetTas();
 
   dsda_InitKeyFrame();
@@ -385,6 +394,7 @@ int dsda_MaxKillRequirement() {
 
 void dsda_WatchPTickCompleted(void) {
   dsda_FlipLineActivationTracker();
+  dsda_WorldHashTic();
 }
 
 void dsda_WatchCommand(void) {
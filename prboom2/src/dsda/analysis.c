@@ -18,6 +18,7 @@
 #include "doomstat.h"
 #include "m_file.h"
 
+#include "dsda/batch.h"
 #include "dsda/excmd.h"
 #include "dsda/exdemo.h"
 #include "dsda/settings.h"
@@ -79,7 +80,7 @@ void dsda_WriteAnalysis(void) {
 
   if (!dsda_analysis) return;
 
-  fstream = M_OpenFile("analysis.txt", "w");
+  fstream = M_OpenFile(dsda_BatchOutputFile("analysis.txt"), "w");
 
   if (fstream == NULL) {
     fprintf(stderr, "Unable to open analysis.txt for writing!\n");
@@ -238,6 +238,11 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "quits the game when brute force ends",
     arg_null,
   },
+  [dsda_arg_brute_force_workers] = {
+    "-brute_force_workers", NULL, NULL,
+    "splits brute force between N worker processes",
+    arg_int, 1, 64,
+  },
   [dsda_arg_first_input] = {
     "-first_input", NULL, NULL,
     "builds the first frame F S T",
@@ -353,6 +358,21 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "imports at least one ghost file",
     arg_string_array, AT_LEAST_ONE_STRING,
   },
+  [dsda_arg_export_world_hash] = {
+    "-export_world_hash", NULL, NULL,
+    "writes a hash of the game state for every tic",
+    arg_string,
+  },
+  [dsda_arg_check_world_hash] = {
+    "-check_world_hash", NULL, NULL,
+    "stops at the first tic that differs from a world hash file",
+    arg_string,
+  },
+  [dsda_arg_batch] = {
+    "-batch", NULL, NULL,
+    "fast plays every demo in a list, writing results to a directory",
+    arg_string_array, EXACT_ARRAY_LENGTH(2),
+  },
   [dsda_arg_consoleplayer] = {
     "-consoleplayer", NULL, NULL,
     "sets the console player (for coop playback)",
@@ -438,6 +458,26 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "disable the SIGSEGV signal handler",
     arg_null,
   },
+  [dsda_arg_memstats] = {
+    "-memstats", NULL, NULL,
+    "prints zone memory statistics by category on exit",
+    arg_null,
+  },
+  [dsda_arg_profile] = {
+    "-profile", NULL, NULL,
+    "records profiling zones and writes them to the given file as a chrome trace on exit",
+    arg_string,
+  },
+  [dsda_arg_setupstats] = {
+    "-setupstats", NULL, NULL,
+    "prints a per-stage timing breakdown after each level setup",
+    arg_null,
+  },
+  [dsda_arg_nostartupcache] = {
+    "-nostartupcache", NULL, NULL,
+    "rebuild the texture and sprite tables instead of loading them from the startup cache",
+    arg_null,
+  },
   [dsda_arg_deathmatch] = {
     "-deathmatch", NULL, NULL,
     "turn on deathmatch mode",
@@ -548,6 +588,21 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "sets the fov aspect ratio WxH",
     arg_string, 0, 21,
   },
+  [dsda_arg_render_threads] = {
+    "-render_threads", NULL, NULL,
+    "splits the software renderer into the given number of threaded slices",
+    arg_int, 1, 16,
+  },
+  [dsda_arg_bench_drawers] = {
+    "-bench_drawers", NULL, NULL,
+    "times the scalar and vectorized span and column drawers at startup",
+    arg_null,
+  },
+  [dsda_arg_bench_udmf] = {
+    "-bench_udmf", NULL, NULL,
+    "times the UDMF parser on each TEXTMAP that is loaded",
+    arg_null,
+  },
   [dsda_arg_emulate] = {
     "-emulate", NULL, NULL,
     "emulates errors from a version of prboom+ (a.b.c.d)",
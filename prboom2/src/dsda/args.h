@@ -58,6 +58,7 @@ typedef enum {
   dsda_arg_tas,
   dsda_arg_build,
   dsda_arg_quit_after_brute_force,
+  dsda_arg_brute_force_workers,
   dsda_arg_first_input,
   dsda_arg_command,
   dsda_arg_skipsec,
@@ -81,6 +82,9 @@ typedef enum {
   dsda_arg_track_playback,
   dsda_arg_export_ghost,
   dsda_arg_import_ghost,
+  dsda_arg_export_world_hash,
+  dsda_arg_check_world_hash,
+  dsda_arg_batch,
   dsda_arg_consoleplayer,
   dsda_arg_spechit,
   dsda_arg_setmem,
@@ -98,6 +102,10 @@ typedef enum {
   dsda_arg_resetgamma,
   dsda_arg_force_old_zdoom_nodes,
   dsda_arg_sigsegv,
+  dsda_arg_memstats,
+  dsda_arg_profile,
+  dsda_arg_setupstats,
+  dsda_arg_nostartupcache,
   dsda_arg_deathmatch,
   dsda_arg_altdeath,
   dsda_arg_timer,
@@ -120,6 +128,9 @@ typedef enum {
   dsda_arg_geometry,
   dsda_arg_vidmode,
   dsda_arg_aspect,
+  dsda_arg_render_threads,
+  dsda_arg_bench_drawers,
+  dsda_arg_bench_udmf,
   dsda_arg_emulate,
   dsda_arg_doom95,
   dsda_arg_blockmap,
@@ -0,0 +1,170 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Batch
+//
+//  Plays a list of demos back to back in one session, as -fastdemo
+//  would play each of them. The wads are loaded once for the whole list,
+//  so every demo in it must use the same wads and options. Results for
+//  demo N go to <output>/N: levelstat.txt, analysis.txt, world.wsh and
+//  demo.txt (file name, game tics and real tics).
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/analysis.h"
+#include "dsda/exdemo.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+#include "dsda/world_hash.h"
+
+#include "batch.h"
+
+static char** batch_demos;
+static int batch_demo_count;
+static int batch_index;
+static char* batch_output;
+static dsda_string_t batch_output_dir;
+static dsda_string_t batch_output_file;
+static dboolean batch_demo_finished;
+static int batch_start_tic;
+static int batch_start_time;
+
+void dsda_InitBatch(const char* list, const char* output) {
+  int i;
+  char* buffer;
+  char** lines;
+
+  if (M_ReadFileToString(list, &buffer) < 0)
+    I_Error("dsda_InitBatch: unable to read %s", list);
+
+  lines = dsda_SplitString(buffer, "\n");
+
+  for (i = 0; lines[i]; ++i) {
+    char* line = lines[i];
+    size_t length = strlen(line);
+
+    if (length && line[length - 1] == '\r')
+      line[--length] = '\0';
+
+    if (!length)
+      continue;
+
+    batch_demos = Z_Realloc(batch_demos, (batch_demo_count + 1) * sizeof(*batch_demos));
+    batch_demos[batch_demo_count++] = I_RequireFile(line, ".lmp");
+  }
+
+  Z_Free(lines);
+  Z_Free(buffer);
+
+  if (!batch_demo_count)
+    I_Error("dsda_InitBatch: no demos in %s", list);
+
+  batch_output = Z_Strdup(output);
+  M_MakeDir(batch_output, true);
+}
+
+dboolean dsda_BatchMode(void) {
+  return batch_demo_count > 0;
+}
+
+const char* dsda_BatchDemo(void) {
+  return batch_demos[batch_index];
+}
+
+const char* dsda_BatchOutputFile(const char* name) {
+  if (!batch_output_dir.string)
+    return name;
+
+  dsda_FreeString(&batch_output_file);
+  dsda_StringPrintF(&batch_output_file, "%s/%s", batch_output_dir.string, name);
+
+  return batch_output_file.string;
+}
+
+void dsda_StartBatchDemo(void) {
+  extern int numlevels;
+
+  if (!batch_demo_count)
+    return;
+
+  // The first demo was loaded with its footer during startup
+  if (batch_index)
+    dsda_ReplaceExDemo(batch_demos[batch_index]);
+
+  dsda_FreeString(&batch_output_dir);
+  dsda_StringPrintF(&batch_output_dir, "%s/%d", batch_output, batch_index);
+  M_MakeDir(batch_output_dir.string, true);
+
+  dsda_ResetAnalysis();
+  numlevels = 0;
+
+  dsda_CloseWorldHash();
+  dsda_InitWorldHashExport(dsda_BatchOutputFile("world"));
+
+  batch_demo_finished = false;
+  batch_start_tic = gametic;
+  batch_start_time = dsda_GetTickRealTime();
+}
+
+static void dsda_FinishBatchDemo(void) {
+  FILE* file;
+
+  dsda_CloseWorldHash();
+  dsda_WriteAnalysis();
+
+  file = M_OpenFile(dsda_BatchOutputFile("demo.txt"), "w");
+
+  if (file == NULL)
+    I_Error("dsda_FinishBatchDemo: unable to write %s", batch_output_file.string);
+
+  fprintf(file, "demo %s\n", batch_demos[batch_index]);
+  fprintf(file, "gametics %d\n", gametic - batch_start_tic);
+  fprintf(file, "realtics %d\n", dsda_GetTickRealTime() - batch_start_time);
+
+  fclose(file);
+
+  lprintf(LO_INFO, "Batch: finished %d of %d (%s)\n",
+          batch_index + 1, batch_demo_count, batch_demos[batch_index]);
+
+  batch_demo_finished = true;
+}
+
+// The level keeps ticking until the next demo is started, which can
+// replace the pending ga_playdemo, so this may be called again for the
+// same demo and then only repeats the request.
+dboolean dsda_NextBatchDemo(void) {
+  if (!batch_demo_count)
+    return false;
+
+  if (!batch_demo_finished) {
+    dsda_FinishBatchDemo();
+    ++batch_index;
+  }
+
+  if (batch_index >= batch_demo_count)
+    return false;
+
+  G_DeferedPlayDemo(batch_demos[batch_index]);
+
+  return true;
+}
@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Batch
+//
+
+#ifndef __DSDA_BATCH__
+#define __DSDA_BATCH__
+
+#include "doomtype.h"
+
+void dsda_InitBatch(const char* list, const char* output);
+dboolean dsda_BatchMode(void);
+const char* dsda_BatchDemo(void);
+const char* dsda_BatchOutputFile(const char* name);
+void dsda_StartBatchDemo(void);
+dboolean dsda_NextBatchDemo(void);
+
+#endif
@@ -17,18 +17,31 @@
 
 #include <math.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "d_main.h"
 #include "d_player.h"
 #include "d_ticcmd.h"
 #include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
 #include "lprintf.h"
 #include "m_random.h"
 #include "r_state.h"
 
+#include "dsda/args.h"
 #include "dsda/build.h"
 #include "dsda/demo.h"
 #include "dsda/features.h"
 #include "dsda/key_frame.h"
 #include "dsda/skip.h"
+#include "dsda/thread_pool.h"
 #include "dsda/time.h"
 #include "dsda/utility.h"
 
@@ -82,6 +95,20 @@ static dsda_key_frame_t nomo_key_frame;
 static bf_target_t bf_target;
 static ticcmd_t bf_result[MAX_BF_DEPTH];
 
+// Parallel brute force splits the sequence space into contiguous chunks,
+//   each searched in serial order by a forked worker process
+#define MAX_BF_WORKERS 64
+
+typedef struct {
+  long long volume;
+  int result;
+  dboolean evaluated;
+  fixed_t best_value;
+  ticcmd_t cmds[MAX_BF_DEPTH];
+} bf_worker_result_t;
+
+static int bf_worker_fd = -1;
+
 const char* dsda_bf_attribute_names[dsda_bf_attribute_max] = {
   [dsda_bf_x] = "x",
   [dsda_bf_y] = "y",
@@ -240,7 +267,12 @@ dboolean dsda_BruteForceEnded(void) {
   return brute_force_ended;
 }
 
+static void dsda_FinishBFWorker(int result);
+
 static void dsda_EndBF(int result) {
+  if (bf_worker_fd >= 0)
+    dsda_FinishBFWorker(result);
+
   brute_force_ended = true;
 
   lprintf(LO_INFO, "Brute force complete (%s)!\n", bf_result_text[result]);
@@ -599,6 +631,248 @@ void dsda_BruteForceWithMonsters(void) {
   bf_nomonsters = false;
 }
 
+dboolean dsda_BruteForceWorker(void) {
+  return bf_worker_fd >= 0;
+}
+
+#ifndef _WIN32
+
+static dboolean dsda_WriteBFData(int fd, const void* data, size_t size) {
+  const char* p = data;
+
+  while (size) {
+    ssize_t count;
+
+    count = write(fd, p, size);
+
+    if (count < 0 && errno == EINTR)
+      continue;
+
+    if (count <= 0)
+      return false;
+
+    p += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+static dboolean dsda_ReadBFData(int fd, void* data, size_t size) {
+  char* p = data;
+
+  while (size) {
+    ssize_t count;
+
+    count = read(fd, p, size);
+
+    if (count < 0 && errno == EINTR)
+      continue;
+
+    if (count <= 0)
+      return false;
+
+    p += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+static void dsda_FinishBFWorker(int result) {
+  bf_worker_result_t worker_result;
+
+  memset(&worker_result, 0, sizeof(worker_result));
+  worker_result.volume = bf_volume;
+  worker_result.result = result;
+  worker_result.evaluated = bf_target.evaluated;
+  worker_result.best_value = bf_target.best_value;
+  memcpy(worker_result.cmds, bf_result, sizeof(bf_result));
+
+  dsda_WriteBFData(bf_worker_fd, &worker_result, sizeof(worker_result));
+  close(bf_worker_fd);
+
+  // The exit handlers belong to the parent process
+  fflush(NULL);
+  _exit(0);
+}
+
+static void dsda_SeekBFRange(bf_range_t* range, long long* index) {
+  long long size;
+
+  size = range->max - range->min + 1;
+  range->i = range->min + *index % size;
+  *index /= size;
+}
+
+// Position the search at the given sequence, in the order the serial search visits them
+static void dsda_SeekBruteForce(long long index) {
+  int i;
+
+  for (i = bf_depth - 1; i >= 0; --i) {
+    dsda_SeekBFRange(&brute_force[i].angleturn, &index);
+    dsda_SeekBFRange(&brute_force[i].sidemove, &index);
+    dsda_SeekBFRange(&brute_force[i].forwardmove, &index);
+  }
+}
+
+static void dsda_RunBFWorker(int fd, long long start, long long count) {
+  // Only this thread was copied into the worker: the pool threads and the
+  // audio thread are gone, and their locks may be stuck. Keep clear of both.
+  dsda_DetachThreadPool();
+  nosfxparm = true;
+  nomusicparm = true;
+
+  bf_worker_fd = fd;
+  bf_volume_max = count;
+  dsda_SeekBruteForce(start);
+
+  // Run tics directly, since the window, input, and sound belong to the parent.
+  // The worker exits from dsda_EndBF.
+  while (1) {
+    if (maketic == gametic) {
+      G_BuildTiccmd(&local_cmds[consoleplayer][maketic % BACKUPTICS]);
+      ++maketic;
+    }
+
+    G_Ticker();
+    ++gametic;
+  }
+}
+
+static void dsda_RunParallelBruteForce(int workers) {
+  pid_t pid[MAX_BF_WORKERS];
+  int fd[MAX_BF_WORKERS];
+  bf_worker_result_t worker_result[MAX_BF_WORKERS];
+  dboolean worker_failed = false;
+  long long start;
+  int result;
+  int i;
+
+  if (workers > bf_volume_max)
+    workers = (int) bf_volume_max;
+
+  lprintf(LO_INFO, "Splitting the search between %d workers\n\n", workers);
+
+  // Workers start from the first frame, and the parent returns to it at the end
+  dsda_StoreBFKeyFrame(0);
+
+  // Nothing may be left in flight on the pool when the workers are copied
+  dsda_FinishKeyFrameTasks();
+
+  fflush(NULL);
+
+  start = 0;
+  for (i = 0; i < workers; ++i) {
+    int pipe_fd[2];
+    long long count;
+
+    count = bf_volume_max / workers + (i < bf_volume_max % workers);
+
+    if (pipe(pipe_fd))
+      I_Error("dsda_RunParallelBruteForce: failed to create pipe");
+
+    pid[i] = fork();
+
+    if (pid[i] == -1) {
+      int j;
+
+      for (j = 0; j < i; ++j)
+        kill(pid[j], SIGKILL);
+
+      I_Error("dsda_RunParallelBruteForce: failed to start worker");
+    }
+
+    if (pid[i] == 0) {
+      int j;
+
+      close(pipe_fd[0]);
+      for (j = 0; j < i; ++j)
+        close(fd[j]);
+
+      dsda_RunBFWorker(pipe_fd[1], start, count);
+    }
+
+    close(pipe_fd[1]);
+    fd[i] = pipe_fd[0];
+    start += count;
+  }
+
+  for (i = 0; i < workers; ++i) {
+    if (!dsda_ReadBFData(fd[i], &worker_result[i], sizeof(worker_result[i])))
+      worker_failed = true;
+
+    close(fd[i]);
+    waitpid(pid[i], NULL, 0);
+
+    // The serial search stops at the first success, so later chunks don't matter
+    if (!worker_failed && !bf_target.enabled && worker_result[i].result == BF_SUCCESS) {
+      int j;
+
+      for (j = i + 1; j < workers; ++j) {
+        kill(pid[j], SIGKILL);
+        close(fd[j]);
+        waitpid(pid[j], NULL, 0);
+      }
+
+      workers = i + 1;
+    }
+  }
+
+  if (worker_failed)
+    I_Error("dsda_RunParallelBruteForce: a worker failed");
+
+  // Reduce in sequence order, so ties resolve the same way as the serial search.
+  // The volume adds up to what the serial search would have tested.
+  result = BF_FAILURE;
+  bf_volume = 0;
+
+  for (i = 0; i < workers; ++i) {
+    bf_volume += worker_result[i].volume;
+
+    if (bf_target.enabled) {
+      if (worker_result[i].evaluated && dsda_BFNewBestResult(worker_result[i].best_value)) {
+        bf_target.evaluated = true;
+        bf_target.best_value = worker_result[i].best_value;
+        memcpy(bf_result, worker_result[i].cmds, sizeof(bf_result));
+      }
+    }
+    else if (worker_result[i].result == BF_SUCCESS && result == BF_FAILURE) {
+      result = BF_SUCCESS;
+      memcpy(bf_result, worker_result[i].cmds, sizeof(bf_result));
+    }
+  }
+
+  if (bf_target.enabled && bf_target.evaluated)
+    result = BF_SUCCESS;
+
+  if (result == BF_SUCCESS) {
+    char cmd_str[COMMAND_MOVEMENT_STRING_LENGTH];
+
+    lprintf(LO_INFO, "Result:\n");
+
+    for (i = 0; i < bf_depth; ++i) {
+      dsda_PrintCommandMovement(cmd_str, &bf_result[i]);
+      lprintf(LO_INFO, "    %s\n", cmd_str);
+    }
+
+    lprintf(LO_INFO, "\n");
+  }
+
+  dsda_EndBF(result);
+}
+
+#else
+
+static void dsda_FinishBFWorker(int result) {
+}
+
+static void dsda_RunParallelBruteForce(int workers) {
+  lprintf(LO_WARN, "Parallel brute force is not supported on this platform!\n");
+}
+
+#endif
+
 dboolean dsda_StartBruteForce(int depth) {
   int i;
 
@@ -649,6 +923,14 @@ dboolean dsda_StartBruteForce(int depth) {
 
   dsda_StartTimer(dsda_timer_brute_force);
 
+  {
+    dsda_arg_t* arg;
+
+    arg = dsda_Arg(dsda_arg_brute_force_workers);
+    if (arg->found && arg->value.v_int > 1)
+      dsda_RunParallelBruteForce(arg->value.v_int);
+  }
+
   return true;
 }
 
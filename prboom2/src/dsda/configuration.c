@@ -29,6 +29,7 @@
 #include "s_sound.h"
 #include "smooth.h"
 #include "v_video.h"
+#include "w_wad.h"
 #include "z_zone.h"
 
 #include "dsda/args.h"
@@ -379,6 +380,18 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "dsda_organize_failed_demos", dsda_config_organize_failed_demos,
     CONF_BOOL(0)
   },
+  [dsda_config_generate_reject] = {
+    "dsda_generate_reject", dsda_config_generate_reject,
+    CONF_BOOL(0)
+  },
+  [dsda_config_lump_cache_size] = {
+    "dsda_lump_cache_size", dsda_config_lump_cache_size,
+    dsda_config_int, 0, 65536, { 0 }, NULL, NOT_STRICT, W_UpdateLumpCacheSize
+  },
+  [dsda_config_sight_cache] = {
+    "dsda_sight_cache", dsda_config_sight_cache,
+    CONF_BOOL(0)
+  },
   [dsda_config_script_0] = {
     "dsda_script_0", dsda_config_script_0,
     CONF_STRING("")
@@ -890,12 +903,16 @@ dsda_config_t dsda_config[dsda_config_count] = {
   },
   [dsda_config_auto_key_frame_depth] = {
     "dsda_auto_key_frame_depth", dsda_config_auto_key_frame_depth,
-    dsda_config_int, 0, 600, { 60 }, NULL, STRICT_INT(0), dsda_InitKeyFrame
+    dsda_config_int, 0, 6000, { 60 }, NULL, STRICT_INT(0), dsda_InitKeyFrame
   },
   [dsda_config_auto_key_frame_timeout] = {
     "dsda_auto_key_frame_timeout", dsda_config_auto_key_frame_timeout,
     dsda_config_int, 0, 25, { 10 }, NULL, NOT_STRICT, dsda_InitKeyFrame
   },
+  [dsda_config_auto_key_frame_memory] = {
+    "dsda_auto_key_frame_memory", dsda_config_auto_key_frame_memory,
+    dsda_config_int, 0, 65536, { 1024 }, NULL, NOT_STRICT, dsda_InitKeyFrame
+  },
   [dsda_config_auto_save] = {
     "dsda_config_auto_save", dsda_config_auto_save,
     CONF_BOOL(0)
@@ -1129,6 +1146,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "dsda_background_fps_limit", dsda_config_background_fps_limit,
     dsda_config_int, 0, 1000, { 35 }
   },
+  [dsda_config_render_threads] = {
+    "render_threads", dsda_config_render_threads,
+    dsda_config_int, 1, 16, { 1 }
+  },
   [dsda_config_usegamma] = {
     "usegamma", dsda_config_usegamma,
     dsda_config_int, 0, 4, { 0 }, &usegamma, NOT_STRICT, M_ChangeApplyPalette
@@ -65,6 +65,9 @@ typedef enum {
   dsda_config_mute_unfocused_window,
   dsda_config_cheat_codes,
   dsda_config_organize_failed_demos,
+  dsda_config_generate_reject,
+  dsda_config_lump_cache_size,
+  dsda_config_sight_cache,
   dsda_config_script_0,
   dsda_config_script_1,
   dsda_config_script_2,
@@ -195,6 +198,7 @@ typedef enum {
   dsda_config_auto_key_frame_interval,
   dsda_config_auto_key_frame_depth,
   dsda_config_auto_key_frame_timeout,
+  dsda_config_auto_key_frame_memory,
   dsda_config_auto_save,
   dsda_config_ex_text_scale_x,
   dsda_config_ex_text_ratio_y,
@@ -253,6 +257,7 @@ typedef enum {
   dsda_config_uncapped_framerate,
   dsda_config_fps_limit,
   dsda_config_background_fps_limit,
+  dsda_config_render_threads,
   dsda_config_usegamma,
   dsda_config_screenblocks,
   dsda_config_sdl_video_window_pos,
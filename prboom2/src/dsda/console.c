@@ -38,6 +38,7 @@
 #include "s_sound.h"
 #include "smooth.h"
 #include "v_video.h"
+#include "w_wad.h"
 
 #include "dsda.h"
 #include "dsda/build.h"
@@ -52,6 +53,7 @@
 #include "dsda/messenger.h"
 #include "dsda/mobjinfo.h"
 #include "dsda/playback.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/stretch.h"
 #include "dsda/tracker.h"
@@ -2245,6 +2247,31 @@ static dboolean console_MusicRestart(const char* command, const char* args) {
   return true;
 }
 
+static dboolean console_ProfileStart(const char* command, const char* args) {
+  return dsda_StartProfile();
+}
+
+static dboolean console_ProfileExport(const char* command, const char* args) {
+  char name[CONSOLE_ENTRY_SIZE];
+
+  if (sscanf(args, "%s", name) == 1)
+    return dsda_ExportProfile(name);
+
+  return false;
+}
+
+static dboolean console_MemoryStats(const char* command, const char* args) {
+  Z_PrintStats();
+
+  return true;
+}
+
+static dboolean console_LumpCacheStats(const char* command, const char* args) {
+  W_PrintLumpCacheStats();
+
+  return true;
+}
+
 static dboolean console_AllGhosts(const char* command, const char* args) {
   if (bmapwidth)
     bmapwidth = 0;
@@ -2287,6 +2314,10 @@ static console_command_entry_t console_commands[] = {
   { "player.kill", console_PlayerKill, CF_NEVER },
 
   { "music.restart", console_MusicRestart, CF_ALWAYS },
+  { "memory.stats", console_MemoryStats, CF_ALWAYS },
+  { "lump_cache.stats", console_LumpCacheStats, CF_ALWAYS },
+  { "profile.start", console_ProfileStart, CF_ALWAYS },
+  { "profile.export", console_ProfileExport, CF_ALWAYS },
 
   { "level.exit", console_LevelExit, CF_NEVER },
   { "level.secret_exit", console_LevelSecretExit, CF_NEVER },
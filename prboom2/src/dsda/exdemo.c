@@ -33,6 +33,7 @@
 #include "dsda/features.h"
 #include "dsda/playback.h"
 #include "dsda/utility.h"
+#include "dsda/zipfile.h"
 
 #include "exdemo.h"
 
@@ -283,7 +284,11 @@ static void DemoEx_AddParams(wadtbl_t* wadtbl) {
     for (i = 0; i < arg->count; ++i) {
       char* file;
 
-      file = I_FindDeh(arg->value.v_string_array[i]);
+      if (dsda_ZipEntry(arg->value.v_string_array[i]))
+        file = Z_Strdup(arg->value.v_string_array[i]);
+      else
+        file = I_FindDeh(arg->value.v_string_array[i]);
+
       if (file) {
         filename_p = PathFindFileName(file);
         dsda_StringCat(&dehs, "\"");
@@ -547,6 +552,25 @@ void dsda_LoadExDemo(const char* filename) {
   }
 }
 
+// The wads and params are already set up, so only the signature is taken
+// from the footer of the new demo
+void dsda_ReplaceExDemo(const char* filename) {
+  ForgetExDemo();
+  PartitionDemo(filename);
+
+  if (exdemo.footer)
+  {
+    wadinfo_t* header;
+
+    header = ReadPWADTable(exdemo.footer, exdemo.footer_size);
+
+    if (!header)
+      lprintf(LO_ERROR, "ReplaceExDemo: demo footer is corrupted\n");
+    else
+      DemoEx_GetFeatures(header);
+  }
+}
+
 int dsda_CopyExDemo(const byte** buffer, int* length) {
   if (exdemo.demo) {
     *buffer = exdemo.demo;
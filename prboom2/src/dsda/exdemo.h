@@ -23,6 +23,7 @@
 int dsda_IsExDemoSigned(void);
 void dsda_MergeExDemoFeatures(void);
 void dsda_LoadExDemo(const char* filename);
+void dsda_ReplaceExDemo(const char* filename);
 int dsda_CopyExDemo(const byte** buffer, int* length);
 void dsda_WriteExDemoFooter(void);
 
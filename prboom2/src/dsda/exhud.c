@@ -86,6 +86,9 @@ typedef enum {
   exhud_map_title,
   exhud_map_totals,
   exhud_minimap,
+  exhud_key_frame_stats,
+  exhud_memory_stats,
+  exhud_sight_cache_stats,
   exhud_component_count,
 } exhud_component_id_t;
 
@@ -337,6 +340,30 @@ exhud_component_t components_template[exhud_component_count] = {
     .default_vpt = VPT_EX_TEXT,
     .off_by_default = true,
   },
+  [exhud_key_frame_stats] = {
+    dsda_InitKeyFrameStatsHC,
+    dsda_UpdateKeyFrameStatsHC,
+    dsda_DrawKeyFrameStatsHC,
+    "key_frame_stats",
+    .default_vpt = VPT_EX_TEXT,
+    .off_by_default = true,
+  },
+  [exhud_memory_stats] = {
+    dsda_InitMemoryStatsHC,
+    dsda_UpdateMemoryStatsHC,
+    dsda_DrawMemoryStatsHC,
+    "memory_stats",
+    .default_vpt = VPT_EX_TEXT,
+    .off_by_default = true,
+  },
+  [exhud_sight_cache_stats] = {
+    dsda_InitSightCacheStatsHC,
+    dsda_UpdateSightCacheStatsHC,
+    dsda_DrawSightCacheStatsHC,
+    "sight_cache_stats",
+    .default_vpt = VPT_EX_TEXT,
+    .off_by_default = true,
+  },
 };
 
 typedef struct {
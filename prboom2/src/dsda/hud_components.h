@@ -32,6 +32,7 @@
 #include "hud_components/fps.h"
 #include "hud_components/free_text.h"
 #include "hud_components/health_text.h"
+#include "hud_components/key_frame_stats.h"
 #include "hud_components/keys.h"
 #include "hud_components/level_splits.h"
 #include "hud_components/line_display.h"
@@ -40,11 +41,13 @@
 #include "hud_components/map_time.h"
 #include "hud_components/map_title.h"
 #include "hud_components/map_totals.h"
+#include "hud_components/memory_stats.h"
 #include "hud_components/message.h"
 #include "hud_components/minimap.h"
 #include "hud_components/ready_ammo_text.h"
 #include "hud_components/render_stats.h"
 #include "hud_components/secret_message.h"
+#include "hud_components/sight_cache_stats.h"
 #include "hud_components/speed_text.h"
 #include "hud_components/stat_totals.h"
 #include "hud_components/tracker.h"
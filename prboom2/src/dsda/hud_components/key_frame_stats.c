@@ -0,0 +1,94 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Key Frame Stats HUD Component
+//
+
+
+#include "dsda/key_frame.h"
+
+#include "base.h"
+
+#include "key_frame_stats.h"
+
+typedef struct {
+  dsda_text_t component[2];
+} local_component_t;
+
+static local_component_t* local;
+
+static void dsda_UpdateMemoryComponentText(char* str, size_t max_size, dsda_key_frame_stats_t* stats) {
+  double ratio;
+
+  ratio = stats->memory ? (double) stats->full_memory / stats->memory : 0;
+
+  snprintf(
+    str, max_size,
+    "%sKF %s%4d %sMEM %s%7.1fMB %sRATIO %s%5.1f",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->frames,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->memory / (1024.0 * 1024.0),
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    ratio
+  );
+}
+
+static void dsda_UpdateTimeComponentText(char* str, size_t max_size, dsda_key_frame_stats_t* stats) {
+  snprintf(
+    str, max_size,
+    "%sSTORE %s%6.2f %sRESTORE %s%6.2f %sZIP %s%6.2f",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    stats->store_time > 10000 ? dsda_TextColor(dsda_tc_exhud_render_bad) :
+                                dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->store_time / 1000.0,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->restore_time / 1000.0,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->compress_time / 1000.0
+  );
+}
+
+void dsda_InitKeyFrameStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count, void** data) {
+  *data = Z_Calloc(1, sizeof(local_component_t));
+  local = *data;
+
+  dsda_InitTextHC(&local->component[0], x_offset, y_offset, vpt);
+  dsda_InitTextHC(&local->component[1], x_offset, y_offset + 8, vpt);
+}
+
+void dsda_UpdateKeyFrameStatsHC(void* data) {
+  dsda_key_frame_stats_t stats;
+
+  local = data;
+
+  dsda_KeyFrameStats(&stats);
+
+  dsda_UpdateMemoryComponentText(local->component[0].msg, sizeof(local->component[0].msg), &stats);
+  dsda_UpdateTimeComponentText(local->component[1].msg, sizeof(local->component[1].msg), &stats);
+  dsda_RefreshHudText(&local->component[0]);
+  dsda_RefreshHudText(&local->component[1]);
+}
+
+void dsda_DrawKeyFrameStatsHC(void* data) {
+  local = data;
+
+  dsda_DrawBasicText(&local->component[0]);
+  dsda_DrawBasicText(&local->component[1]);
+}
@@ -0,0 +1,95 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Memory Stats HUD Component
+//
+
+#include "z_zone.h"
+
+#include "base.h"
+
+#include "memory_stats.h"
+
+#define MB (1024.0 * 1024.0)
+
+typedef struct {
+  dsda_text_t component[2];
+} local_component_t;
+
+static local_component_t* local;
+
+static void dsda_UpdateTotalComponentText(char* str, size_t max_size,
+                                          zone_stats_t* stats, zone_stats_t* total) {
+  snprintf(
+    str, max_size,
+    "%sMEM %s%7.1fMB %sPEAK %s%7.1fMB %sLVL %s%6.1fMB",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    total->live / MB,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    total->peak / MB,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats[ZONE_CAT_LEVEL].live / MB
+  );
+}
+
+static void dsda_UpdateCategoryComponentText(char* str, size_t max_size, zone_stats_t* stats) {
+  snprintf(
+    str, max_size,
+    "%sWAD %s%6.1f %sREN %s%6.1f %sKF %s%6.1f %sSND %s%5.1f",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats[ZONE_CAT_WAD].live / MB,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats[ZONE_CAT_RENDERER].live / MB,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats[ZONE_CAT_KEY_FRAME].live / MB,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats[ZONE_CAT_SOUND].live / MB
+  );
+}
+
+void dsda_InitMemoryStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count, void** data) {
+  *data = Z_Calloc(1, sizeof(local_component_t));
+  local = *data;
+
+  dsda_InitTextHC(&local->component[0], x_offset, y_offset, vpt);
+  dsda_InitTextHC(&local->component[1], x_offset, y_offset + 8, vpt);
+}
+
+void dsda_UpdateMemoryStatsHC(void* data) {
+  zone_stats_t stats[ZONE_CAT_MAX];
+  zone_stats_t total;
+
+  local = data;
+
+  Z_GetStats(stats, &total);
+
+  dsda_UpdateTotalComponentText(local->component[0].msg, sizeof(local->component[0].msg), stats, &total);
+  dsda_UpdateCategoryComponentText(local->component[1].msg, sizeof(local->component[1].msg), stats);
+  dsda_RefreshHudText(&local->component[0]);
+  dsda_RefreshHudText(&local->component[1]);
+}
+
+void dsda_DrawMemoryStatsHC(void* data) {
+  local = data;
+
+  dsda_DrawBasicText(&local->component[0]);
+  dsda_DrawBasicText(&local->component[1]);
+}
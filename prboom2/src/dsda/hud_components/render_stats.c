@@ -22,7 +22,7 @@
 #include "render_stats.h"
 
 typedef struct {
-  dsda_text_t component[2];
+  dsda_text_t component[3];
 } local_component_t;
 
 static local_component_t* local;
@@ -74,12 +74,49 @@ static void dsda_UpdateMaxComponentText(char* str, size_t max_size) {
   );
 }
 
+static void dsda_UpdateSliceComponentText(char* str, size_t max_size) {
+  extern dsda_render_stats_t dsda_render_stats;
+
+  int i;
+  int min_time, max_time;
+
+  if (dsda_render_stats.slices < 2) {
+    str[0] = '\0';
+    return;
+  }
+
+  min_time = max_time = dsda_render_stats.slice_time[0];
+  for (i = 1; i < dsda_render_stats.slices; ++i) {
+    if (dsda_render_stats.slice_time[i] < min_time)
+      min_time = dsda_render_stats.slice_time[i];
+
+    if (dsda_render_stats.slice_time[i] > max_time)
+      max_time = dsda_render_stats.slice_time[i];
+  }
+
+  snprintf(
+    str, max_size,
+    "%sSLICES %s%2d %sMIN US %s%5d %sMAX US %s%5d",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    dsda_render_stats.slices,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    min_time,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    max_time > 2 * min_time ? dsda_TextColor(dsda_tc_exhud_render_bad) :
+                              dsda_TextColor(dsda_tc_exhud_render_good),
+    max_time
+  );
+}
+
 void dsda_InitRenderStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count, void** data) {
   *data = Z_Calloc(1, sizeof(local_component_t));
   local = *data;
 
   dsda_InitTextHC(&local->component[0], x_offset, y_offset, vpt);
   dsda_InitTextHC(&local->component[1], x_offset, y_offset + 8, vpt);
+  dsda_InitTextHC(&local->component[2], x_offset, y_offset + 16, vpt);
 }
 
 void dsda_UpdateRenderStatsHC(void* data) {
@@ -87,8 +124,10 @@ void dsda_UpdateRenderStatsHC(void* data) {
 
   dsda_UpdateCurrentComponentText(local->component[0].msg, sizeof(local->component[0].msg));
   dsda_UpdateMaxComponentText(local->component[1].msg, sizeof(local->component[1].msg));
+  dsda_UpdateSliceComponentText(local->component[2].msg, sizeof(local->component[2].msg));
   dsda_RefreshHudText(&local->component[0]);
   dsda_RefreshHudText(&local->component[1]);
+  dsda_RefreshHudText(&local->component[2]);
 }
 
 void dsda_DrawRenderStatsHC(void* data) {
@@ -96,4 +135,5 @@ void dsda_DrawRenderStatsHC(void* data) {
 
   dsda_DrawBasicText(&local->component[0]);
   dsda_DrawBasicText(&local->component[1]);
+  dsda_DrawBasicText(&local->component[2]);
 }
@@ -0,0 +1,68 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Sight Cache Stats HUD Component
+//
+
+#include "p_map.h"
+#include "z_zone.h"
+
+#include "base.h"
+
+#include "sight_cache_stats.h"
+
+typedef struct {
+  dsda_text_t component;
+} local_component_t;
+
+static local_component_t* local;
+
+static void dsda_UpdateComponentText(char* str, size_t max_size) {
+  int hits, lookups;
+
+  P_GetSightCacheStats(&hits, &lookups);
+
+  snprintf(
+    str, max_size,
+    "%sSIGHT %s%4d %sHIT %s%4d %s(%3d%%)",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    lookups,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    hits,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    lookups ? hits * 100 / lookups : 0
+  );
+}
+
+void dsda_InitSightCacheStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count, void** data) {
+  *data = Z_Calloc(1, sizeof(local_component_t));
+  local = *data;
+
+  dsda_InitTextHC(&local->component, x_offset, y_offset, vpt);
+}
+
+void dsda_UpdateSightCacheStatsHC(void* data) {
+  local = data;
+
+  dsda_UpdateComponentText(local->component.msg, sizeof(local->component.msg));
+  dsda_RefreshHudText(&local->component);
+}
+
+void dsda_DrawSightCacheStatsHC(void* data) {
+  local = data;
+
+  dsda_DrawBasicText(&local->component);
+}
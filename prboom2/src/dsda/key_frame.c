@@ -15,7 +15,9 @@
 //	DSDA Key Frame
 //
 
+#include <stdlib.h>
 #include <time.h>
+#include <zlib.h>
 
 #include "doomstat.h"
 #include "s_advsound.h"
@@ -36,6 +38,7 @@
 
 #include "dsda.h"
 #include "dsda/args.h"
+#include "dsda/brute_force.h"
 #include "dsda/build.h"
 #include "dsda/configuration.h"
 #include "dsda/demo.h"
@@ -44,8 +47,10 @@
 #include "dsda/options.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
+#include "dsda/profiler.h"
 #include "dsda/save.h"
 #include "dsda/settings.h"
+#include "dsda/thread_pool.h"
 #include "dsda/time.h"
 
 #include "key_frame.h"
@@ -55,6 +60,12 @@ static int auto_kf_timeout_count;
 
 #define TIMEOUT_LIMIT 1
 
+// Every Nth auto key frame is stored in full; the rest are deltas
+#define ANCHOR_INTERVAL 16
+
+// Unchanged stretches shorter than this are folded into the literal data
+#define MIN_SAME_RUN 16
+
 static dsda_key_frame_t first_kf;
 static dsda_key_frame_t quick_kf;
 static dsda_key_frame_t temp_kf;
@@ -63,9 +74,35 @@ static auto_kf_t* last_auto_kf;
 static int auto_kf_size;
 static int restore_key_frame_index = -1;
 
+// Full contents of the newest auto key frame, used as the delta base
+static byte* delta_base;
+static int delta_base_length;
+static auto_kf_t* delta_base_kf;
+static unsigned int delta_base_id;
+
+static unsigned int next_store_id;
+
+typedef struct {
+  dsda_key_frame_t* kf;
+  byte* data;
+  int data_length;
+  int time;
+} kf_job_t;
+
+// At most one auto key frame is compressing in the background at a time
+static kf_job_t compress_job;
+static dboolean compress_job_queued;
+static dsda_task_group_t compress_group;
+static dsda_task_group_t uncompress_group;
+
+static dsda_key_frame_stats_t kf_stats;
+
 static int dsda_auto_key_frame_interval;
 static int dsda_auto_key_frame_depth;
 static int dsda_auto_key_frame_timeout;
+static int dsda_auto_key_frame_memory;
+
+static void dsda_DropStaleAutoKFs(void);
 
 static int autoKeyFrameTimeout(void) {
   return dsda_StartInBuildMode() ? 0 : dsda_auto_key_frame_timeout;
@@ -92,25 +129,29 @@ static dboolean autoKFExists(auto_kf_t* auto_kf) {
 void dsda_ForgetAutoKeyFrames(void) {
   if (last_auto_kf)
     last_auto_kf->auto_index = 0;
+
+  dsda_DropStaleAutoKFs();
 }
 
 static void dsda_ResetParentKF(dsda_key_frame_t* kf) {
   kf->parent.auto_kf = NULL;
-  kf->parent.buffer = NULL;
+  kf->parent.store_id = 0;
 }
 
 static void dsda_AttachAutoKF(dsda_key_frame_t* kf) {
   if (autoKFExists(last_auto_kf)) {
     kf->parent.auto_kf = last_auto_kf;
-    kf->parent.buffer = last_auto_kf->kf.buffer;
+    kf->parent.store_id = last_auto_kf->store_id;
   }
   else
     dsda_ResetParentKF(kf);
 }
 
 static void dsda_ResolveParentKF(dsda_key_frame_t* kf) {
-  if (autoKFExists(kf->parent.auto_kf) && kf->parent.auto_kf->kf.buffer == kf->parent.buffer)
+  if (autoKFExists(kf->parent.auto_kf) && kf->parent.auto_kf->store_id == kf->parent.store_id) {
     last_auto_kf = kf->parent.auto_kf;
+    dsda_DropStaleAutoKFs();
+  }
   else {
     dsda_ResetParentKF(kf);
     dsda_ForgetAutoKeyFrames();
@@ -163,10 +204,439 @@ static dsda_key_frame_t* dsda_ClosestKeyFrame(int target_tic_count) {
   return closest;
 }
 
-void dsda_CopyKeyFrame(dsda_key_frame_t* dest, dsda_key_frame_t* source) {
-  *dest = *source;
-  dest->buffer = Z_Malloc(dest->buffer_length);
-  memcpy(dest->buffer, source->buffer, dest->buffer_length);
+// Delta format: the full length, followed by records of
+//   [int same][int diff][diff bytes]
+// where "same" bytes are copied from the base at the same offset.
+static byte* dsda_EncodeKFDelta(const byte* base, int base_length,
+                                const byte* buffer, int length, int* delta_length) {
+  byte* delta;
+  byte* p;
+  int max_length;
+  int common;
+  int i;
+
+  // Every record but the first and a trailing same-only one starts with
+  // a run of at least MIN_SAME_RUN unchanged bytes
+  common = MIN(base_length, length);
+  max_length = sizeof(int) + length + (length / MIN_SAME_RUN + 2) * 2 * sizeof(int);
+  delta = Z_Malloc(max_length);
+  p = delta;
+
+  memcpy(p, &length, sizeof(length));
+  p += sizeof(length);
+
+  i = 0;
+  while (i < length) {
+    int same_start, diff_start;
+    int same, diff;
+
+    same_start = i;
+    while (i + 8 <= common && !memcmp(buffer + i, base + i, 8))
+      i += 8;
+    while (i < common && buffer[i] == base[i])
+      ++i;
+    same = i - same_start;
+
+    diff_start = i;
+    while (i < length) {
+      int run = 0;
+
+      while (run < MIN_SAME_RUN && i + run < common && buffer[i + run] == base[i + run])
+        ++run;
+
+      if (run == MIN_SAME_RUN || (run && i + run == length))
+        break;
+
+      i += run + 1;
+    }
+    diff = i - diff_start;
+
+    memcpy(p, &same, sizeof(same));
+    p += sizeof(same);
+    memcpy(p, &diff, sizeof(diff));
+    p += sizeof(diff);
+    memcpy(p, buffer + diff_start, diff);
+    p += diff;
+  }
+
+  *delta_length = p - delta;
+
+  return Z_Realloc(delta, *delta_length);
+}
+
+static byte* dsda_DecodeKFDelta(const byte* base, const byte* delta, int* length) {
+  byte* buffer;
+  int offset;
+
+  memcpy(length, delta, sizeof(*length));
+  delta += sizeof(*length);
+
+  buffer = Z_Malloc(*length);
+
+  offset = 0;
+  while (offset < *length) {
+    int same, diff;
+
+    memcpy(&same, delta, sizeof(same));
+    delta += sizeof(same);
+    memcpy(&diff, delta, sizeof(diff));
+    delta += sizeof(diff);
+
+    memcpy(buffer + offset, base + offset, same);
+    offset += same;
+    memcpy(buffer + offset, delta, diff);
+    delta += diff;
+    offset += diff;
+  }
+
+  return buffer;
+}
+
+static void dsda_SetDeltaBase(auto_kf_t* auto_kf, byte* buffer, int length) {
+  if (delta_base && delta_base != buffer)
+    Z_Free(delta_base);
+
+  delta_base = buffer;
+  delta_base_length = length;
+  delta_base_kf = auto_kf;
+  delta_base_id = auto_kf ? auto_kf->store_id : 0;
+}
+
+static void dsda_ResetDeltaBase(void) {
+  dsda_SetDeltaBase(NULL, NULL, 0);
+}
+
+static dboolean dsda_DeltaBaseValid(auto_kf_t* auto_kf) {
+  return delta_base &&
+         delta_base_kf == auto_kf &&
+         autoKFExists(auto_kf) &&
+         auto_kf->store_id == delta_base_id;
+}
+
+static auto_kf_t* dsda_AutoKFOwner(dsda_key_frame_t* kf) {
+  int i;
+
+  for (i = 0; i < auto_kf_size; ++i)
+    if (&auto_key_frames[i].kf == kf)
+      return &auto_key_frames[i];
+
+  return NULL;
+}
+
+static void dsda_CompressKFTask(void* data) {
+  kf_job_t* job = data;
+  unsigned long long start_time;
+  uLongf length;
+
+  start_time = dsda_MonotonicTime();
+
+  length = compressBound(job->kf->buffer_length);
+  job->data = malloc(length);
+
+  if (
+    job->data &&
+    compress2(job->data, &length, job->kf->buffer, job->kf->buffer_length, Z_BEST_SPEED) == Z_OK &&
+    length < job->kf->buffer_length
+  ) {
+    job->data_length = length;
+  }
+  else {
+    free(job->data);
+    job->data = NULL;
+  }
+
+  job->time = dsda_MonotonicTime() - start_time;
+}
+
+static void dsda_UncompressKFTask(void* data) {
+  kf_job_t* job = data;
+  uLongf length;
+
+  length = job->data_length;
+
+  if (uncompress(job->data, &length, job->kf->buffer, job->kf->buffer_length) != Z_OK ||
+      length != job->data_length)
+    job->data_length = -1;
+}
+
+static void dsda_QueueKFCompression(auto_kf_t* auto_kf) {
+  compress_job.kf = &auto_kf->kf;
+  compress_job.data = NULL;
+  compress_job_queued = true;
+
+  dsda_QueueTask(&compress_group, dsda_CompressKFTask, &compress_job);
+}
+
+// The ring must not free or replace a buffer while it is being compressed,
+//   so anything that does waits here first
+static void dsda_FinishKFCompression(dboolean wait) {
+  dsda_key_frame_t* kf;
+
+  if (!compress_job_queued)
+    return;
+
+  if (wait)
+    dsda_WaitTasks(&compress_group);
+  else if (dsda_TasksPending(&compress_group))
+    return;
+
+  compress_job_queued = false;
+  kf_stats.compress_time = compress_job.time;
+
+  if (!compress_job.data)
+    return;
+
+  kf = compress_job.kf;
+
+  Z_Free(kf->buffer);
+  kf->uncompressed_length = kf->buffer_length;
+  kf->buffer_length = compress_job.data_length;
+  kf->buffer = Z_Malloc(kf->buffer_length);
+  memcpy(kf->buffer, compress_job.data, kf->buffer_length);
+
+  free(compress_job.data);
+  compress_job.data = NULL;
+}
+
+// Rebuild the full contents of an auto key frame, starting from the delta base
+//   or the closest anchor and decompressing every step in parallel
+static byte* dsda_ExpandAutoKF(auto_kf_t* auto_kf, int* length) {
+  auto_kf_t* first;
+  auto_kf_t* step;
+  kf_job_t* steps;
+  byte* buffer;
+  dboolean owned;
+  int count;
+  int i;
+
+  if (dsda_DeltaBaseValid(auto_kf)) {
+    buffer = Z_Malloc(delta_base_length);
+    memcpy(buffer, delta_base, delta_base_length);
+    *length = delta_base_length;
+
+    return buffer;
+  }
+
+  first = auto_kf;
+  while (first->kf.delta && !dsda_DeltaBaseValid(first->prev))
+    first = first->prev;
+
+  count = 1;
+  for (step = first; step != auto_kf; step = step->next)
+    ++count;
+
+  steps = Z_Malloc(count * sizeof(*steps));
+
+  for (i = 0, step = first; i < count; ++i, step = step->next) {
+    steps[i].kf = &step->kf;
+
+    if (step->kf.uncompressed_length) {
+      steps[i].data_length = step->kf.uncompressed_length;
+      steps[i].data = Z_Malloc(steps[i].data_length);
+      dsda_QueueTask(&uncompress_group, dsda_UncompressKFTask, &steps[i]);
+    }
+    else {
+      steps[i].data_length = step->kf.buffer_length;
+      steps[i].data = step->kf.buffer;
+    }
+  }
+
+  dsda_WaitTasks(&uncompress_group);
+
+  for (i = 0; i < count; ++i)
+    if (steps[i].data_length < 0)
+      I_Error("dsda_ExpandAutoKF: failed to decompress key frame");
+
+  if (first->kf.delta) {
+    buffer = delta_base;
+    *length = delta_base_length;
+    owned = false;
+    i = 0;
+  }
+  else {
+    buffer = steps[0].data;
+    *length = steps[0].data_length;
+    owned = steps[0].kf->uncompressed_length != 0;
+    i = 1;
+  }
+
+  for (; i < count; ++i) {
+    byte* next_buffer;
+
+    next_buffer = dsda_DecodeKFDelta(buffer, steps[i].data, length);
+
+    if (owned)
+      Z_Free(buffer);
+
+    buffer = next_buffer;
+    owned = true;
+  }
+
+  if (!owned) {
+    byte* copy;
+
+    copy = Z_Malloc(*length);
+    memcpy(copy, buffer, *length);
+    buffer = copy;
+  }
+
+  for (i = first->kf.delta ? 0 : 1; i < count; ++i)
+    if (steps[i].kf->uncompressed_length)
+      Z_Free(steps[i].data);
+
+  Z_Free(steps);
+
+  return buffer;
+}
+
+// Swap a freshly stored auto key frame for a delta against its predecessor
+static void dsda_CompressAutoKF(auto_kf_t* auto_kf) {
+  byte* buffer;
+  int length;
+
+  buffer = auto_kf->kf.buffer;
+  length = auto_kf->kf.buffer_length;
+
+  auto_kf->store_id = ++next_store_id;
+  auto_kf->full_length = length;
+  auto_kf->kf.parent.store_id = auto_kf->store_id;
+
+  if (auto_kf->auto_index % ANCHOR_INTERVAL && dsda_DeltaBaseValid(auto_kf->prev)) {
+    byte* delta;
+    int delta_length;
+
+    delta = dsda_EncodeKFDelta(delta_base, delta_base_length, buffer, length, &delta_length);
+
+    if (delta_length < length) {
+      auto_kf->kf.buffer = delta;
+      auto_kf->kf.buffer_length = delta_length;
+      auto_kf->kf.delta = true;
+      dsda_SetDeltaBase(auto_kf, buffer, length);
+      return;
+    }
+
+    Z_Free(delta);
+  }
+
+  // Anchor frame - the ring keeps the buffer, so the base needs its own copy
+  dsda_SetDeltaBase(auto_kf, Z_Malloc(length), length);
+  memcpy(delta_base, buffer, length);
+}
+
+static void dsda_ClearAutoKF(auto_kf_t* auto_kf) {
+  auto_kf->auto_index = 0;
+  auto_kf->full_length = 0;
+  auto_kf->kf.delta = false;
+  auto_kf->kf.uncompressed_length = 0;
+
+  if (auto_kf->kf.buffer) {
+    Z_Free(auto_kf->kf.buffer);
+    auto_kf->kf.buffer = NULL;
+  }
+}
+
+// Deltas are useless once the frame they build on is gone,
+//   so the ring drops them together with it
+static void dsda_EvictAutoKF(auto_kf_t* evicted) {
+  auto_kf_t* auto_kf;
+
+  dsda_ClearAutoKF(evicted);
+
+  for (auto_kf = evicted->next; auto_kf != last_auto_kf && auto_kf->kf.delta; auto_kf = auto_kf->next)
+    dsda_ClearAutoKF(auto_kf);
+}
+
+static size_t dsda_AutoKFMemory(void) {
+  size_t memory;
+  int i;
+
+  memory = delta_base_length;
+
+  for (i = 0; i < auto_kf_size; ++i)
+    memory += auto_key_frames[i].kf.buffer_length * (auto_key_frames[i].kf.buffer != NULL);
+
+  return memory;
+}
+
+static auto_kf_t* dsda_OldestAutoKF(void) {
+  auto_kf_t* oldest = NULL;
+  auto_kf_t* auto_kf;
+
+  for (auto_kf = last_auto_kf; auto_kf && auto_kf->kf.buffer; dsda_RewindKF(&auto_kf))
+    oldest = auto_kf;
+
+  return oldest;
+}
+
+// Frames past the newest one are left over from before a rewind or a reset.
+//   Nothing can reach them anymore, so they are freed instead of waiting
+//   for the ring to come around.
+static void dsda_DropStaleAutoKFs(void) {
+  auto_kf_t* oldest;
+  auto_kf_t* auto_kf;
+  zone_category_t category;
+
+  if (!last_auto_kf)
+    return;
+
+  category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+  dsda_FinishKFCompression(true);
+  Z_SetCategory(category);
+
+  oldest = autoKFExists(last_auto_kf) ? dsda_OldestAutoKF() : NULL;
+
+  for (auto_kf = last_auto_kf->next; auto_kf != oldest; auto_kf = auto_kf->next) {
+    dsda_ClearAutoKF(auto_kf);
+
+    if (auto_kf == last_auto_kf)
+      break;
+  }
+
+  if (delta_base_kf && !autoKFExists(delta_base_kf))
+    dsda_ResetDeltaBase();
+}
+
+// Drop the oldest history until the ring fits in the memory budget
+static void dsda_EnforceAutoKFBudget(void) {
+  size_t budget;
+
+  budget = (size_t) dsda_auto_key_frame_memory * 1024 * 1024;
+
+  if (!budget)
+    return;
+
+  while (dsda_AutoKFMemory() > budget) {
+    auto_kf_t* oldest;
+
+    oldest = dsda_OldestAutoKF();
+
+    if (!oldest || oldest == last_auto_kf)
+      break;
+
+    dsda_EvictAutoKF(oldest);
+  }
+}
+
+void dsda_KeyFrameStats(dsda_key_frame_stats_t* stats) {
+  auto_kf_t* auto_kf;
+
+  *stats = kf_stats;
+  stats->frames = 0;
+  stats->memory = auto_kf_size ? dsda_AutoKFMemory() : 0;
+  stats->full_memory = 0;
+
+  for (auto_kf = last_auto_kf; auto_kf && auto_kf->kf.buffer; dsda_RewindKF(&auto_kf)) {
+    ++stats->frames;
+    stats->full_memory += auto_kf->full_length;
+  }
+}
+
+void dsda_FinishKeyFrameTasks(void) {
+  zone_category_t category;
+
+  category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+  dsda_FinishKFCompression(true);
+  Z_SetCategory(category);
 }
 
 void dsda_InitKeyFrame(void) {
@@ -175,6 +645,19 @@ void dsda_InitKeyFrame(void) {
   dsda_auto_key_frame_interval = dsda_IntConfig(dsda_config_auto_key_frame_interval);
   dsda_auto_key_frame_depth = dsda_IntConfig(dsda_config_auto_key_frame_depth);
   dsda_auto_key_frame_timeout = dsda_IntConfig(dsda_config_auto_key_frame_timeout);
+  dsda_auto_key_frame_memory = dsda_IntConfig(dsda_config_auto_key_frame_memory);
+
+  dsda_FinishKFCompression(true);
+  dsda_ResetDeltaBase();
+
+  if (auto_key_frames != NULL) {
+    for (i = 0; i < auto_kf_size; ++i)
+      if (auto_key_frames[i].kf.buffer)
+        Z_Free(auto_key_frames[i].kf.buffer);
+
+    Z_Free(auto_key_frames);
+    auto_key_frames = NULL;
+  }
 
   auto_kf_size = autoKeyFrameDepth();
 
@@ -183,9 +666,6 @@ void dsda_InitKeyFrame(void) {
     return;
   }
 
-  if (auto_key_frames != NULL)
-    Z_Free(auto_key_frames);
-
   ++auto_kf_size; // chain includes a terminator
 
   auto_key_frames = Z_Calloc(auto_kf_size, sizeof(auto_kf_t));
@@ -219,6 +699,10 @@ void dsda_ExportKeyFrame(byte* buffer, int length) {
 
 // Stripped down version of G_DoSaveGame
 void dsda_StoreKeyFrame(dsda_key_frame_t* key_frame, byte complete, byte export) {
+  zone_category_t category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+
+  DSDA_PROFILE_BEGIN(dsda_profile_store_key_frame);
+
   key_frame->game_tic_count = true_logictic;
 
   P_InitSaveBuffer();
@@ -238,9 +722,15 @@ void dsda_StoreKeyFrame(dsda_key_frame_t* key_frame, byte complete, byte export)
 
   key_frame->buffer = savebuffer;
   key_frame->buffer_length = save_p - savebuffer;
+  key_frame->delta = false;
+  key_frame->uncompressed_length = 0;
 
   P_ForgetSaveBuffer();
 
+  DSDA_PROFILE_END(dsda_profile_store_key_frame);
+
+  Z_SetCategory(category);
+
   dsda_AttachAutoKF(key_frame);
 
   if (complete) {
@@ -256,18 +746,34 @@ void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe) {
   void G_AfterLoad(void);
 
   byte complete;
+  byte* buffer;
+  int buffer_length;
+  auto_kf_t* auto_kf;
 
   if (key_frame->buffer == NULL) {
     doom_printf("No key frame found");
     return;
   }
 
+  buffer = key_frame->buffer;
+  buffer_length = key_frame->buffer_length;
+  dsda_StartTimer(dsda_timer_key_frame);
+
+  auto_kf = dsda_AutoKFOwner(key_frame);
+
+  if (auto_kf) {
+    zone_category_t category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+
+    buffer = dsda_ExpandAutoKF(auto_kf, &buffer_length);
+    Z_SetCategory(category);
+  }
+
   dsda_TrackFeature(uf_keyframe);
 
   if (skip_wipe || dsda_BuildMode())
     dsda_SkipNextWipe();
 
-  save_p = key_frame->buffer;
+  save_p = buffer;
 
   P_LOAD_BYTE(complete);
   P_LOAD_X(key_frame->game_tic_count);
@@ -288,6 +794,12 @@ void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe) {
 
   dsda_QueueJoin();
 
+  // The next auto key frame follows this one, so keep its contents as the base
+  if (auto_kf)
+    dsda_SetDeltaBase(auto_kf, buffer, buffer_length);
+
+  kf_stats.restore_time = dsda_ElapsedTime(dsda_timer_key_frame);
+
   dsda_ResolveParentKF(key_frame);
 
   doom_printf("Restored key frame");
@@ -361,6 +873,15 @@ void dsda_UpdateAutoKeyFrames(void) {
   int current_time;
   int interval_tics;
   dsda_key_frame_t* current_key_frame;
+  zone_category_t category;
+
+  // Brute force workers are forked and keep no key frames of their own
+  if (dsda_BruteForceWorker())
+    return;
+
+  category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+  dsda_FinishKFCompression(false);
+  Z_SetCategory(category);
 
   if (
     auto_kf_timed_out ||
@@ -382,8 +903,12 @@ void dsda_UpdateAutoKeyFrames(void) {
       return;
     }
 
+    category = Z_SetCategory(ZONE_CAT_KEY_FRAME);
+
+    dsda_FinishKFCompression(true);
+
     last_auto_kf = last_auto_kf->next;
-    last_auto_kf->next->auto_index = 0;
+    dsda_EvictAutoKF(last_auto_kf->next);
     last_auto_kf->auto_index = last_auto_kf->prev->auto_index + 1;
 
     current_key_frame = &last_auto_kf->kf;
@@ -393,7 +918,9 @@ void dsda_UpdateAutoKeyFrames(void) {
 
       dsda_StartTimer(dsda_timer_key_frame);
       dsda_StoreKeyFrame(current_key_frame, false, false);
-      elapsed_time = dsda_ElapsedTimeMS(dsda_timer_key_frame);
+      dsda_CompressAutoKF(last_auto_kf);
+      kf_stats.store_time = dsda_ElapsedTime(dsda_timer_key_frame);
+      elapsed_time = kf_stats.store_time / 1000;
 
       if (autoKeyFrameTimeout()) {
         if (elapsed_time > autoKeyFrameTimeout()) {
@@ -409,7 +936,18 @@ void dsda_UpdateAutoKeyFrames(void) {
       }
     }
 
-    if (!first_kf.buffer)
-      dsda_CopyKeyFrame(&first_kf, current_key_frame);
+    if (!first_kf.buffer) {
+      first_kf = *current_key_frame;
+      first_kf.delta = false;
+      first_kf.uncompressed_length = 0;
+      first_kf.buffer = Z_Malloc(delta_base_length);
+      first_kf.buffer_length = delta_base_length;
+      memcpy(first_kf.buffer, delta_base, delta_base_length);
+    }
+
+    dsda_EnforceAutoKFBudget();
+    dsda_QueueKFCompression(last_auto_kf);
+
+    Z_SetCategory(category);
   }
 }
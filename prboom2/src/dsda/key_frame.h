@@ -18,12 +18,14 @@
 #ifndef __DSDA_KEY_FRAME__
 #define __DSDA_KEY_FRAME__
 
+#include <stddef.h>
+
 #include "doomtype.h"
 
 struct auto_kf_s;
 
 typedef struct {
-  byte* buffer;
+  unsigned int store_id;
   struct auto_kf_s* auto_kf;
 } parent_kf_t;
 
@@ -31,16 +33,29 @@ typedef struct {
   byte* buffer;
   int buffer_length;
   int game_tic_count;
+  dboolean delta; // buffer holds changes against the previous auto key frame
+  int uncompressed_length; // nonzero when the buffer is compressed
   parent_kf_t parent;
 } dsda_key_frame_t;
 
 typedef struct auto_kf_s {
   int auto_index;
+  unsigned int store_id;
+  int full_length;
   dsda_key_frame_t kf;
   struct auto_kf_s* prev;
   struct auto_kf_s* next;
 } auto_kf_t;
 
+typedef struct {
+  int frames;
+  size_t memory;
+  size_t full_memory;
+  int store_time; // microseconds
+  int restore_time;
+  int compress_time;
+} dsda_key_frame_stats_t;
+
 void dsda_StoreKeyFrame(dsda_key_frame_t* key_frame, byte complete, byte export);
 void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe);
 void dsda_InitKeyFrame(void);
@@ -54,5 +69,7 @@ void dsda_RewindAutoKeyFrame(void);
 void dsda_ResetAutoKeyFrameTimeout(void);
 void dsda_UpdateAutoKeyFrames(void);
 void dsda_ForgetAutoKeyFrames(void);
+void dsda_FinishKeyFrameTasks(void);
+void dsda_KeyFrameStats(dsda_key_frame_stats_t* stats);
 
 #endif
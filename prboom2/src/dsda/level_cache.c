@@ -0,0 +1,275 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Level Cache
+//
+//  Derived level data that depends only on the map lumps is kept in
+//  <data dir>/levels, one file per section, named by a hash of the lumps.
+//  Any mismatch in the header means the data is rebuilt and rewritten.
+//  Each section is keyed on the object counts it was built from, which the
+//  caller passes in, since some sections are opened before the nodes load.
+//
+
+#include <string.h>
+
+#include "doomstat.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/data_organizer.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "level_cache.h"
+
+#define LEVEL_CACHE_VERSION 3
+#define LEVEL_CACHE_COUNTS 6
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t section;
+  int32_t variant;
+  int32_t counts[LEVEL_CACHE_COUNTS];
+  uint32_t build_time;
+  uint32_t length;
+} level_cache_header_t;
+
+static const char* section_ext[DSDA_LEVEL_CACHE_SECTIONS] = {
+  [dsda_level_cache_blockmap] = "bmap",
+  [dsda_level_cache_geometry] = "geom",
+  [dsda_level_cache_gl] = "gl",
+  [dsda_level_cache_reject] = "rej",
+};
+
+static dsda_cksum_t level_cksum;
+static dboolean level_cache_ready;
+
+static const byte* read_data;
+static dsda_level_cache_section_t read_section;
+static size_t read_length;
+static size_t read_offset;
+static dboolean read_overrun;
+static unsigned long long read_start;
+static unsigned long long read_build_time;
+
+static byte* write_data;
+static size_t write_length;
+static size_t write_capacity;
+static dsda_level_cache_section_t write_section;
+
+static dboolean section_reused[DSDA_LEVEL_CACHE_SECTIONS];
+static unsigned long long time_saved;
+
+static char* dsda_LevelCachePath(dsda_level_cache_section_t section) {
+  dsda_string_t path;
+
+  dsda_StringPrintF(&path, "%s/levels", dsda_DataDir());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.%s", level_cksum.string, section_ext[section]);
+
+  return path.string;
+}
+
+static void dsda_FillLevelCacheHeader(level_cache_header_t* header,
+                                      dsda_level_cache_section_t section, int variant,
+                                      const int* counts, int count_count) {
+  int i;
+
+  if (count_count > LEVEL_CACHE_COUNTS)
+    I_Error("dsda_FillLevelCacheHeader: too many counts for %s", section_ext[section]);
+
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, "DLVL", 4);
+  header->version = LEVEL_CACHE_VERSION;
+  header->section = section;
+  header->variant = variant;
+
+  for (i = 0; i < count_count; ++i)
+    header->counts[i] = counts[i];
+}
+
+void dsda_InitLevelCache(const int* lumps, int lump_count) {
+  int i;
+  struct MD5Context md5;
+
+  MD5Init(&md5);
+
+  for (i = 0; i < lump_count; ++i) {
+    int length;
+
+    length = W_SafeLumpLength(lumps[i]);
+
+    MD5Update(&md5, (const byte*) &length, sizeof(length));
+    if (length > 0) {
+      MD5Update(&md5, W_BorrowLumpNum(lumps[i]), length);
+      W_ReturnLumpNum(lumps[i]);
+    }
+  }
+
+  MD5Final(level_cksum.bytes, &md5);
+  dsda_TranslateCheckSum(&level_cksum);
+
+  level_cache_ready = true;
+}
+
+dboolean dsda_OpenLevelCache(dsda_level_cache_section_t section, int variant,
+                             const int* counts, int count_count) {
+  char* path;
+  level_cache_header_t expected;
+  const level_cache_header_t* header;
+
+  if (!level_cache_ready)
+    return false;
+
+  read_start = dsda_MonotonicTime();
+
+  path = dsda_LevelCachePath(section);
+  read_data = M_MapFile(path, &read_length);
+  Z_Free(path);
+
+  if (!read_data)
+    return false;
+
+  dsda_FillLevelCacheHeader(&expected, section, variant, counts, count_count);
+  header = (const level_cache_header_t*) read_data;
+
+  if (
+    read_length < sizeof(*header) ||
+    memcmp(header->magic, expected.magic, 4) ||
+    header->version != expected.version ||
+    header->section != expected.section ||
+    header->variant != expected.variant ||
+    memcmp(header->counts, expected.counts, sizeof(expected.counts)) ||
+    header->length != read_length - sizeof(*header)
+  ) {
+    lprintf(LO_DEBUG, "dsda_OpenLevelCache: ignoring stale %s data\n", section_ext[section]);
+
+    M_UnmapFile(read_data, read_length);
+    read_data = NULL;
+
+    return false;
+  }
+
+  read_section = section;
+  read_build_time = header->build_time;
+  read_offset = sizeof(*header);
+  read_overrun = false;
+
+  return true;
+}
+
+const void* dsda_ReadLevelCache(size_t size) {
+  const void* result;
+
+  if (read_overrun || size > read_length - read_offset) {
+    read_overrun = true;
+
+    return NULL;
+  }
+
+  result = read_data + read_offset;
+  read_offset += size;
+
+  return result;
+}
+
+dboolean dsda_LevelCacheComplete(void) {
+  return !read_overrun && read_offset == read_length;
+}
+
+dboolean dsda_CloseLevelCache(void) {
+  dboolean result;
+  unsigned long long load_time;
+
+  result = dsda_LevelCacheComplete();
+
+  M_UnmapFile(read_data, read_length);
+  read_data = NULL;
+
+  load_time = dsda_MonotonicTime() - read_start;
+
+  if (result) {
+    section_reused[read_section] = true;
+
+    if (read_build_time > load_time)
+      time_saved += read_build_time - load_time;
+  }
+
+  return result;
+}
+
+void dsda_BeginLevelCache(dsda_level_cache_section_t section, int variant,
+                          const int* counts, int count_count) {
+  write_section = section;
+  write_length = 0;
+
+  dsda_WriteLevelCache(NULL, sizeof(level_cache_header_t));
+  dsda_FillLevelCacheHeader((level_cache_header_t*) write_data, section, variant,
+                            counts, count_count);
+}
+
+void dsda_WriteLevelCache(const void* data, size_t size) {
+  if (write_length + size > write_capacity) {
+    write_capacity = MAX(write_capacity * 2, write_length + size);
+    write_data = Z_Realloc(write_data, write_capacity);
+  }
+
+  if (data)
+    memcpy(write_data + write_length, data, size);
+
+  write_length += size;
+}
+
+void dsda_EndLevelCache(unsigned long long build_time) {
+  char* path;
+  level_cache_header_t* header;
+
+  if (!level_cache_ready)
+    return;
+
+  header = (level_cache_header_t*) write_data;
+  header->build_time = (uint32_t) MIN(build_time, UINT32_MAX);
+  header->length = write_length - sizeof(*header);
+
+  path = dsda_LevelCachePath(write_section);
+
+  if (!M_WriteFile(path, write_data, write_length))
+    lprintf(LO_DEBUG, "dsda_EndLevelCache: unable to write %s\n", path);
+
+  Z_Free(path);
+}
+
+void dsda_ReportLevelCache(void) {
+  int i;
+  dsda_string_t sections;
+
+  dsda_InitString(&sections, NULL);
+
+  for (i = 0; i < DSDA_LEVEL_CACHE_SECTIONS; ++i)
+    if (section_reused[i])
+      dsda_StringCatF(&sections, " %s", section_ext[i]);
+
+  if (sections.string)
+    lprintf(LO_INFO, "Level cache reused%s, saved %llu ms\n",
+            sections.string, (time_saved + 500) / 1000);
+
+  dsda_FreeString(&sections);
+
+  memset(section_reused, 0, sizeof(section_reused));
+  time_saved = 0;
+}
@@ -0,0 +1,45 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Level Cache
+//
+
+#ifndef __DSDA_LEVEL_CACHE__
+#define __DSDA_LEVEL_CACHE__
+
+#include <stddef.h>
+
+#include "doomtype.h"
+
+typedef enum {
+  dsda_level_cache_blockmap,
+  dsda_level_cache_geometry,
+  dsda_level_cache_gl,
+  dsda_level_cache_reject,
+  DSDA_LEVEL_CACHE_SECTIONS
+} dsda_level_cache_section_t;
+
+void dsda_InitLevelCache(const int* lumps, int lump_count);
+dboolean dsda_OpenLevelCache(dsda_level_cache_section_t section, int variant,
+                             const int* counts, int count_count);
+const void* dsda_ReadLevelCache(size_t size);
+dboolean dsda_LevelCacheComplete(void);
+dboolean dsda_CloseLevelCache(void);
+void dsda_BeginLevelCache(dsda_level_cache_section_t section, int variant,
+                          const int* counts, int count_count);
+void dsda_WriteLevelCache(const void* data, size_t size);
+void dsda_EndLevelCache(unsigned long long build_time);
+void dsda_ReportLevelCache(void);
+
+#endif
@@ -31,7 +31,11 @@ void dsda_CacheSoundLumps(void) {
     sfxinfo_t *sfx = &S_sfx[i];
     sfx->lumpnum = I_GetSfxLumpNum(sfx);
 
-    if (sfx->lumpnum >= 0)
+    // Read each sound into the lump cache, where it can be evicted
+    // again when dsda_lump_cache_size is set
+    if (sfx->lumpnum >= 0) {
       W_LockLumpNum(sfx->lumpnum);
+      W_UnlockLumpNum(sfx->lumpnum);
+    }
   }
 }
@@ -0,0 +1,1291 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Node Builder
+//
+//  Partitions are picked from a sample of the segs, scored by splits and
+//  balance. Every subsector is traced as the convex region left by its
+//  partitions and its own segs, with minisegs closing the gaps, so the
+//  output is usable by the GL renderer.
+//
+//  The first partitions are chosen on the main thread, and the subtrees
+//  below them are built on the thread pool. Each subtree has its own
+//  context, so workers only read shared data and use malloc instead of
+//  the zone. The contexts are merged in one post-order pass at the end.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdata.h"
+#include "lprintf.h"
+#include "m_bbox.h"
+#include "m_file.h"
+#include "md5.h"
+#include "r_state.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/data_organizer.h"
+#include "dsda/thread_pool.h"
+#include "dsda/utility.h"
+
+#include "node_builder.h"
+
+// Bump this when the output changes, so cached nodes are rebuilt
+#define NODE_BUILDER_VERSION "dsda-nodes-1"
+
+#define SIDE_EPSILON (1.0 / 256)
+#define MATCH_EPSILON (1.0 / 64)
+#define MERGE_EPSILON (1.0 / 4096)
+#define MAX_CANDIDATES 64
+#define SPLIT_COST 8
+#define MIN_TASK_SEGS 32
+#define REGION_MARGIN 64
+#define EDGE_SLACK 1.0
+
+#define REF_SUBSECTOR 0x40000000
+#define REF_TASK 0x20000000
+#define REF_INDEX(ref) ((ref) & 0x1fffffff)
+
+#define XGL3_SEG_SIZE 13
+#define XGL3_NODE_SIZE 40
+
+typedef struct {
+  fixed_t x, y;
+  double fx, fy;
+} bsp_vertex_t;
+
+typedef struct {
+  int v1, v2;
+  int linedef;
+  int side;
+} bsp_seg_t;
+
+typedef struct {
+  double x, y;
+} bsp_point_t;
+
+typedef struct {
+  bsp_point_t* points;
+  int count;
+} bsp_polygon_t;
+
+typedef struct {
+  fixed_t x, y, dx, dy;
+  double fx, fy, fdx, fdy;
+  double length;
+} bsp_line_t;
+
+typedef struct {
+  bsp_line_t partition;
+  int children[2];
+} bsp_node_t;
+
+typedef struct {
+  int first_seg;
+  int seg_count;
+} bsp_subsector_t;
+
+typedef struct {
+  int v1;
+  int linedef;
+  int side;
+} bsp_subsector_seg_t;
+
+typedef struct {
+  double x, y;
+  int vertex;
+  int seg;
+} bsp_loop_point_t;
+
+typedef struct {
+  const bsp_vertex_t* shared_vertices;
+  int shared_vertex_count;
+
+  bsp_vertex_t* vertices;
+  int vertex_count;
+  int vertex_capacity;
+
+  bsp_node_t* nodes;
+  int node_count;
+  int node_capacity;
+
+  bsp_subsector_t* subsectors;
+  int subsector_count;
+  int subsector_capacity;
+
+  bsp_subsector_seg_t* segs;
+  int seg_count;
+  int seg_capacity;
+
+  int root;
+  int vertex_base;
+  dboolean failed;
+} bsp_context_t;
+
+typedef struct {
+  bsp_context_t context;
+  bsp_seg_t* segs;
+  int seg_count;
+  bsp_polygon_t region;
+} bsp_task_t;
+
+typedef struct {
+  byte* subsectors;
+  int subsector_count;
+  byte* segs;
+  int seg_count;
+  byte* nodes;
+  int node_count;
+} bsp_output_t;
+
+// Set up on the main thread and only read by workers
+static bsp_line_t* linedef_lines;
+
+// Only touched on the main thread
+static bsp_task_t* tasks;
+static int task_count;
+static int task_capacity;
+static int task_seg_limit;
+static bsp_output_t output;
+
+#define RESERVE(ctx, array, count, capacity) \
+  ((count) < (capacity) || dsda_GrowBSPArray((ctx), (void**) &(array), &(capacity), sizeof(*(array))))
+
+static dboolean dsda_GrowBSPArray(bsp_context_t* ctx, void** items, int* capacity, size_t size) {
+  int new_capacity;
+  void* result;
+
+  new_capacity = *capacity ? *capacity * 2 : 64;
+  result = realloc(*items, new_capacity * size);
+
+  if (!result) {
+    ctx->failed = true;
+    return false;
+  }
+
+  *items = result;
+  *capacity = new_capacity;
+
+  return true;
+}
+
+static void dsda_FreeBSPContext(bsp_context_t* ctx) {
+  free(ctx->vertices);
+  free(ctx->nodes);
+  free(ctx->subsectors);
+  free(ctx->segs);
+}
+
+static void dsda_InitBSPLine(bsp_line_t* line, fixed_t x, fixed_t y, fixed_t dx, fixed_t dy) {
+  line->x = x;
+  line->y = y;
+  line->dx = dx;
+  line->dy = dy;
+  line->fx = (double) x / FRACUNIT;
+  line->fy = (double) y / FRACUNIT;
+  line->fdx = (double) dx / FRACUNIT;
+  line->fdy = (double) dy / FRACUNIT;
+  line->length = sqrt(line->fdx * line->fdx + line->fdy * line->fdy);
+}
+
+// Positive on the front (right) side, matching R_PointOnSide
+static double dsda_PointSide(const bsp_line_t* line, double x, double y) {
+  return (line->fdy * (x - line->fx) - line->fdx * (y - line->fy)) / line->length;
+}
+
+static const bsp_vertex_t* dsda_BSPVertex(const bsp_context_t* ctx, int id) {
+  if (id < ctx->shared_vertex_count)
+    return &ctx->shared_vertices[id];
+
+  return &ctx->vertices[id - ctx->shared_vertex_count];
+}
+
+static int dsda_AddBSPVertex(bsp_context_t* ctx, double x, double y) {
+  bsp_vertex_t* vertex;
+
+  if (!RESERVE(ctx, ctx->vertices, ctx->vertex_count, ctx->vertex_capacity))
+    return -1;
+
+  vertex = &ctx->vertices[ctx->vertex_count];
+  vertex->x = (fixed_t) floor(x * FRACUNIT + 0.5);
+  vertex->y = (fixed_t) floor(y * FRACUNIT + 0.5);
+  vertex->fx = (double) vertex->x / FRACUNIT;
+  vertex->fy = (double) vertex->y / FRACUNIT;
+
+  return ctx->shared_vertex_count + ctx->vertex_count++;
+}
+
+static bsp_line_t dsda_SegPartition(const bsp_seg_t* seg) {
+  bsp_line_t line;
+
+  line = linedef_lines[seg->linedef];
+
+  if (seg->side)
+    dsda_InitBSPLine(&line, line.x + line.dx, line.y + line.dy, -line.dx, -line.dy);
+
+  return line;
+}
+
+typedef enum {
+  seg_front,
+  seg_back,
+  seg_split,
+} seg_side_t;
+
+static seg_side_t dsda_ClassifySeg(const bsp_context_t* ctx, const bsp_line_t* line,
+                                   const bsp_seg_t* seg, double* a, double* b) {
+  const bsp_vertex_t* v1;
+  const bsp_vertex_t* v2;
+
+  v1 = dsda_BSPVertex(ctx, seg->v1);
+  v2 = dsda_BSPVertex(ctx, seg->v2);
+
+  *a = dsda_PointSide(line, v1->fx, v1->fy);
+  *b = dsda_PointSide(line, v2->fx, v2->fy);
+
+  if (fabs(*a) <= SIDE_EPSILON && fabs(*b) <= SIDE_EPSILON) {
+    double dot;
+
+    dot = (v2->fx - v1->fx) * line->fdx + (v2->fy - v1->fy) * line->fdy;
+
+    return dot > 0 ? seg_front : seg_back;
+  }
+
+  if (*a >= -SIDE_EPSILON && *b >= -SIDE_EPSILON)
+    return seg_front;
+
+  if (*a <= SIDE_EPSILON && *b <= SIDE_EPSILON)
+    return seg_back;
+
+  return seg_split;
+}
+
+static int dsda_PartitionCost(const bsp_context_t* ctx, const bsp_line_t* line,
+                              const bsp_seg_t* segs, int count, int best_cost) {
+  int i;
+  int front = 0;
+  int back = 0;
+  int splits = 0;
+
+  for (i = 0; i < count; ++i) {
+    double a, b;
+
+    switch (dsda_ClassifySeg(ctx, line, &segs[i], &a, &b)) {
+      case seg_front:
+        ++front;
+        break;
+      case seg_back:
+        ++back;
+        break;
+      default:
+        ++front;
+        ++back;
+        ++splits;
+
+        if (splits * SPLIT_COST >= best_cost)
+          return INT_MAX;
+
+        break;
+    }
+  }
+
+  if (!front || !back)
+    return INT_MAX;
+
+  return splits * SPLIT_COST + abs(front - back);
+}
+
+// Returns false when the segs are already convex
+static dboolean dsda_ChoosePartition(const bsp_context_t* ctx, const bsp_seg_t* segs, int count,
+                                     bsp_line_t* partition) {
+  int i;
+  int step;
+  int best_cost = INT_MAX;
+
+  step = count / MAX_CANDIDATES + 1;
+
+  for (i = 0; i < count; i += step) {
+    bsp_line_t line;
+    int cost;
+
+    line = dsda_SegPartition(&segs[i]);
+    cost = dsda_PartitionCost(ctx, &line, segs, count, best_cost);
+
+    if (cost < best_cost) {
+      best_cost = cost;
+      *partition = line;
+    }
+  }
+
+  // The sample can miss the only segs that see others behind them
+  if (best_cost == INT_MAX && step > 1)
+    for (i = 0; i < count; ++i) {
+      bsp_line_t line;
+
+      if (i % step == 0)
+        continue;
+
+      line = dsda_SegPartition(&segs[i]);
+
+      if (dsda_PartitionCost(ctx, &line, segs, count, INT_MAX) < INT_MAX) {
+        *partition = line;
+        return true;
+      }
+    }
+
+  return best_cost < INT_MAX;
+}
+
+static dboolean dsda_SplitSegs(bsp_context_t* ctx, const bsp_line_t* line,
+                               const bsp_seg_t* segs, int count,
+                               bsp_seg_t* front, int* front_count,
+                               bsp_seg_t* back, int* back_count) {
+  int i;
+
+  *front_count = 0;
+  *back_count = 0;
+
+  for (i = 0; i < count; ++i) {
+    const bsp_seg_t* seg = &segs[i];
+    seg_side_t side;
+    double a, b;
+
+    side = dsda_ClassifySeg(ctx, line, seg, &a, &b);
+
+    if (side == seg_split) {
+      const bsp_vertex_t* v1;
+      const bsp_vertex_t* v2;
+      const bsp_vertex_t* split;
+      double t;
+      int vertex;
+      bsp_seg_t* first;
+      bsp_seg_t* second;
+
+      v1 = dsda_BSPVertex(ctx, seg->v1);
+      v2 = dsda_BSPVertex(ctx, seg->v2);
+      t = a / (a - b);
+
+      vertex = dsda_AddBSPVertex(ctx, v1->fx + t * (v2->fx - v1->fx),
+                                      v1->fy + t * (v2->fy - v1->fy));
+      if (vertex < 0)
+        return false;
+
+      // The vertex array may have moved
+      v1 = dsda_BSPVertex(ctx, seg->v1);
+      v2 = dsda_BSPVertex(ctx, seg->v2);
+      split = dsda_BSPVertex(ctx, vertex);
+
+      // Rounding to fixed point can land the split on an endpoint
+      if (split->x == v1->x && split->y == v1->y) {
+        --ctx->vertex_count;
+        side = b > 0 ? seg_front : seg_back;
+      }
+      else if (split->x == v2->x && split->y == v2->y) {
+        --ctx->vertex_count;
+        side = a > 0 ? seg_front : seg_back;
+      }
+      else {
+        first = a > 0 ? &front[(*front_count)++] : &back[(*back_count)++];
+        second = a > 0 ? &back[(*back_count)++] : &front[(*front_count)++];
+
+        *first = *seg;
+        first->v2 = vertex;
+        *second = *seg;
+        second->v1 = vertex;
+
+        continue;
+      }
+    }
+
+    if (side == seg_front)
+      front[(*front_count)++] = *seg;
+    else
+      back[(*back_count)++] = *seg;
+  }
+
+  return true;
+}
+
+static dboolean dsda_ClipPolygon(const bsp_polygon_t* in, const bsp_line_t* line,
+                                 dboolean keep_back, bsp_polygon_t* out) {
+  int i;
+
+  out->count = 0;
+  out->points = malloc((in->count + 2) * sizeof(*out->points));
+
+  if (!out->points)
+    return false;
+
+  for (i = 0; i < in->count; ++i) {
+    const bsp_point_t* p = &in->points[i];
+    const bsp_point_t* q = &in->points[(i + 1) % in->count];
+    double sp, sq;
+
+    sp = dsda_PointSide(line, p->x, p->y);
+    sq = dsda_PointSide(line, q->x, q->y);
+
+    if (keep_back) {
+      sp = -sp;
+      sq = -sq;
+    }
+
+    if (sp >= 0)
+      out->points[out->count++] = *p;
+
+    if ((sp > 0 && sq < 0) || (sp < 0 && sq > 0)) {
+      double t = sp / (sp - sq);
+
+      out->points[out->count].x = p->x + t * (q->x - p->x);
+      out->points[out->count].y = p->y + t * (q->y - p->y);
+      out->count++;
+    }
+  }
+
+  return true;
+}
+
+// Drops repeated corners and corners on a straight edge
+static void dsda_SimplifyPolygon(bsp_polygon_t* polygon) {
+  int i;
+  int changed = true;
+
+  while (changed && polygon->count >= 3) {
+    changed = false;
+
+    for (i = 0; i < polygon->count && polygon->count >= 3; ++i) {
+      const bsp_point_t* p = &polygon->points[(i + polygon->count - 1) % polygon->count];
+      const bsp_point_t* q = &polygon->points[i];
+      const bsp_point_t* r = &polygon->points[(i + 1) % polygon->count];
+      double dx, dy, length, distance;
+
+      dx = r->x - p->x;
+      dy = r->y - p->y;
+      length = sqrt(dx * dx + dy * dy);
+
+      if (length > MERGE_EPSILON)
+        distance = fabs(dy * (q->x - p->x) - dx * (q->y - p->y)) / length;
+      else
+        distance = 0;
+
+      if (distance <= MERGE_EPSILON) {
+        memmove(&polygon->points[i], &polygon->points[i + 1],
+                (polygon->count - i - 1) * sizeof(*polygon->points));
+        --polygon->count;
+        changed = true;
+      }
+    }
+  }
+}
+
+static void dsda_AddLoopPoint(bsp_loop_point_t* points, int* count,
+                              double x, double y, int vertex, int seg) {
+  bsp_loop_point_t* last;
+
+  if (*count) {
+    last = &points[*count - 1];
+
+    if (fabs(last->x - x) <= MERGE_EPSILON && fabs(last->y - y) <= MERGE_EPSILON) {
+      if (last->vertex < 0)
+        last->vertex = vertex;
+      if (last->seg < 0)
+        last->seg = seg;
+
+      return;
+    }
+  }
+
+  last = &points[(*count)++];
+  last->x = x;
+  last->y = y;
+  last->vertex = vertex;
+  last->seg = seg;
+}
+
+static void dsda_CloseLoop(bsp_loop_point_t* points, int* count) {
+  bsp_loop_point_t* first;
+  bsp_loop_point_t* last;
+
+  if (*count < 2)
+    return;
+
+  first = &points[0];
+  last = &points[*count - 1];
+
+  if (fabs(last->x - first->x) <= MERGE_EPSILON && fabs(last->y - first->y) <= MERGE_EPSILON) {
+    if (last->vertex >= 0)
+      first->vertex = last->vertex;
+    if (last->seg >= 0)
+      first->seg = last->seg;
+
+    --(*count);
+  }
+}
+
+static void dsda_AddSegToLoop(const bsp_context_t* ctx, const bsp_seg_t* segs, int seg,
+                              bsp_loop_point_t* points, int* count) {
+  const bsp_vertex_t* v1;
+  const bsp_vertex_t* v2;
+
+  v1 = dsda_BSPVertex(ctx, segs[seg].v1);
+  v2 = dsda_BSPVertex(ctx, segs[seg].v2);
+
+  dsda_AddLoopPoint(points, count, v1->fx, v1->fy, segs[seg].v1, seg);
+  dsda_AddLoopPoint(points, count, v2->fx, v2->fy, segs[seg].v2, -1);
+}
+
+// Every seg must start exactly one loop point
+static dboolean dsda_CheckLoop(const bsp_loop_point_t* points, int count, int seg_count) {
+  int i;
+  int found = 0;
+
+  for (i = 0; i < count; ++i)
+    if (points[i].seg >= 0)
+      ++found;
+
+  return found == seg_count;
+}
+
+// Walks the convex region clockwise, placing each seg on the edge it lies on
+static dboolean dsda_TraceSubsector(const bsp_context_t* ctx, const bsp_seg_t* segs, int count,
+                                    const bsp_polygon_t* polygon,
+                                    bsp_loop_point_t* points, int* point_count) {
+  int i, j;
+  byte* matched;
+  int* edge_segs;
+  double* edge_t;
+  dboolean skip_corner = false;
+
+  matched = calloc(count, sizeof(*matched));
+  edge_segs = malloc(count * sizeof(*edge_segs));
+  edge_t = malloc(count * sizeof(*edge_t));
+
+  if (!matched || !edge_segs || !edge_t) {
+    free(matched);
+    free(edge_segs);
+    free(edge_t);
+    return false;
+  }
+
+  *point_count = 0;
+
+  for (i = 0; i < polygon->count; ++i) {
+    const bsp_point_t* p = &polygon->points[i];
+    const bsp_point_t* q = &polygon->points[(i + 1) % polygon->count];
+    double ex, ey, length;
+    double edge_end = 0;
+    int edge_count = 0;
+    int corner = -1;
+
+    if (!skip_corner) {
+      dsda_AddLoopPoint(points, point_count, p->x, p->y, -1, -1);
+
+      if (points[*point_count - 1].vertex < 0 && points[*point_count - 1].seg < 0)
+        corner = *point_count - 1;
+    }
+
+    skip_corner = false;
+
+    ex = q->x - p->x;
+    ey = q->y - p->y;
+    length = sqrt(ex * ex + ey * ey);
+
+    if (length <= MATCH_EPSILON)
+      continue;
+
+    ex /= length;
+    ey /= length;
+
+    for (j = 0; j < count; ++j) {
+      const bsp_vertex_t* v1;
+      const bsp_vertex_t* v2;
+      double t1, t2;
+
+      if (matched[j])
+        continue;
+
+      v1 = dsda_BSPVertex(ctx, segs[j].v1);
+      v2 = dsda_BSPVertex(ctx, segs[j].v2);
+
+      if (fabs(ey * (v1->fx - p->x) - ex * (v1->fy - p->y)) > MATCH_EPSILON ||
+          fabs(ey * (v2->fx - p->x) - ex * (v2->fy - p->y)) > MATCH_EPSILON)
+        continue;
+
+      t1 = ex * (v1->fx - p->x) + ey * (v1->fy - p->y);
+      t2 = ex * (v2->fx - p->x) + ey * (v2->fy - p->y);
+
+      // Segs assigned within SIDE_EPSILON of a shallow partition can run
+      // a little past the corners of their region
+      if (t2 <= t1 || t1 < -EDGE_SLACK || t2 > length + EDGE_SLACK)
+        continue;
+
+      matched[j] = true;
+      edge_end = MAX(edge_end, t2);
+
+      // Insertion sort along the edge
+      {
+        int k = edge_count++;
+
+        while (k > 0 && edge_t[k - 1] > t1) {
+          edge_t[k] = edge_t[k - 1];
+          edge_segs[k] = edge_segs[k - 1];
+          --k;
+        }
+
+        edge_t[k] = t1;
+        edge_segs[k] = j;
+      }
+    }
+
+    // A seg that overshoots a corner replaces it, keeping the loop convex
+    if (edge_count && edge_t[0] < 0 && corner == *point_count - 1)
+      --(*point_count);
+
+    for (j = 0; j < edge_count; ++j)
+      dsda_AddSegToLoop(ctx, segs, edge_segs[j], points, point_count);
+
+    if (edge_count && edge_end > length)
+      skip_corner = true;
+  }
+
+  if (skip_corner && *point_count && points[0].vertex < 0 && points[0].seg < 0) {
+    --(*point_count);
+    memmove(&points[0], &points[1], *point_count * sizeof(*points));
+  }
+
+  dsda_CloseLoop(points, point_count);
+
+  for (i = 0; i < count; ++i)
+    if (!matched[i])
+      break;
+
+  free(matched);
+  free(edge_segs);
+  free(edge_t);
+
+  return i == count && dsda_CheckLoop(points, *point_count, count);
+}
+
+// Fallback for regions the trace can't follow: order the segs clockwise
+// around their center and bridge each gap with a single miniseg
+static void dsda_ChainSubsector(const bsp_context_t* ctx, const bsp_seg_t* segs, int count,
+                                bsp_loop_point_t* points, int* point_count) {
+  int i, j;
+  int* order;
+  double* angle;
+  double cx = 0, cy = 0;
+
+  order = malloc(count * sizeof(*order));
+  angle = malloc(count * sizeof(*angle));
+
+  *point_count = 0;
+
+  if (!order || !angle) {
+    free(order);
+    free(angle);
+
+    for (i = 0; i < count; ++i)
+      dsda_AddSegToLoop(ctx, segs, i, points, point_count);
+
+    dsda_CloseLoop(points, point_count);
+    return;
+  }
+
+  for (i = 0; i < count; ++i) {
+    const bsp_vertex_t* v1 = dsda_BSPVertex(ctx, segs[i].v1);
+    const bsp_vertex_t* v2 = dsda_BSPVertex(ctx, segs[i].v2);
+
+    cx += (v1->fx + v2->fx) / 2;
+    cy += (v1->fy + v2->fy) / 2;
+  }
+
+  cx /= count;
+  cy /= count;
+
+  for (i = 0; i < count; ++i) {
+    const bsp_vertex_t* v1 = dsda_BSPVertex(ctx, segs[i].v1);
+    const bsp_vertex_t* v2 = dsda_BSPVertex(ctx, segs[i].v2);
+    double a;
+
+    a = atan2((v1->fy + v2->fy) / 2 - cy, (v1->fx + v2->fx) / 2 - cx);
+
+    // Clockwise is decreasing angle
+    for (j = i; j > 0 && angle[j - 1] < a; --j) {
+      angle[j] = angle[j - 1];
+      order[j] = order[j - 1];
+    }
+
+    angle[j] = a;
+    order[j] = i;
+  }
+
+  for (i = 0; i < count; ++i)
+    dsda_AddSegToLoop(ctx, segs, order[i], points, point_count);
+
+  dsda_CloseLoop(points, point_count);
+
+  free(order);
+  free(angle);
+}
+
+static int dsda_BuildSubsector(bsp_context_t* ctx, const bsp_seg_t* segs, int count,
+                               const bsp_polygon_t* region) {
+  int i;
+  int first;
+  int point_count = 0;
+  dboolean traced = false;
+  bsp_polygon_t polygon;
+  bsp_loop_point_t* points;
+  bsp_subsector_t* subsector;
+
+  // Each seg adds at most two points, and each polygon corner one more
+  points = malloc((2 * count + region->count + count + 2) * sizeof(*points));
+  polygon.points = malloc(region->count * sizeof(*polygon.points));
+
+  if (!points || !polygon.points) {
+    free(points);
+    free(polygon.points);
+    ctx->failed = true;
+    return REF_SUBSECTOR;
+  }
+
+  memcpy(polygon.points, region->points, region->count * sizeof(*polygon.points));
+  polygon.count = region->count;
+
+  // The subsector is the part of the region in front of all of its segs
+  for (i = 0; i < count && polygon.count >= 3; ++i) {
+    bsp_polygon_t clipped;
+    bsp_line_t line;
+
+    line = dsda_SegPartition(&segs[i]);
+
+    if (!dsda_ClipPolygon(&polygon, &line, false, &clipped)) {
+      polygon.count = 0;
+      break;
+    }
+
+    free(polygon.points);
+    polygon = clipped;
+  }
+
+  dsda_SimplifyPolygon(&polygon);
+
+  if (polygon.count >= 3)
+    traced = dsda_TraceSubsector(ctx, segs, count, &polygon, points, &point_count);
+
+  if (!traced)
+    dsda_ChainSubsector(ctx, segs, count, points, &point_count);
+
+  free(polygon.points);
+
+  // Minisegs take their sector from the first seg when loaded
+  for (first = 0; first < point_count; ++first)
+    if (points[first].seg >= 0)
+      break;
+
+  if (first == point_count || !RESERVE(ctx, ctx->subsectors, ctx->subsector_count, ctx->subsector_capacity)) {
+    free(points);
+    ctx->failed = true;
+    return REF_SUBSECTOR;
+  }
+
+  subsector = &ctx->subsectors[ctx->subsector_count];
+  subsector->first_seg = ctx->seg_count;
+  subsector->seg_count = point_count;
+
+  for (i = 0; i < point_count; ++i) {
+    bsp_loop_point_t* point = &points[(first + i) % point_count];
+    bsp_subsector_seg_t* seg;
+
+    if (point->vertex < 0)
+      point->vertex = dsda_AddBSPVertex(ctx, point->x, point->y);
+
+    if (point->vertex < 0 || !RESERVE(ctx, ctx->segs, ctx->seg_count, ctx->seg_capacity)) {
+      free(points);
+      return REF_SUBSECTOR;
+    }
+
+    seg = &ctx->segs[ctx->seg_count++];
+    seg->v1 = point->vertex;
+
+    if (point->seg >= 0) {
+      seg->linedef = segs[point->seg].linedef;
+      seg->side = segs[point->seg].side;
+    }
+    else {
+      seg->linedef = -1;
+      seg->side = 0;
+    }
+  }
+
+  free(points);
+
+  return REF_SUBSECTOR | ctx->subsector_count++;
+}
+
+static int dsda_BuildSubtree(bsp_context_t* ctx, bsp_seg_t* segs, int count,
+                             bsp_polygon_t* region, dboolean defer) {
+  bsp_line_t partition;
+  bsp_seg_t* front = NULL;
+  bsp_seg_t* back = NULL;
+  bsp_polygon_t front_region = { NULL, 0 };
+  bsp_polygon_t back_region = { NULL, 0 };
+  int front_count, back_count;
+  int children[2];
+  bsp_node_t* node;
+
+  if (ctx->failed) {
+    free(segs);
+    free(region->points);
+    return REF_SUBSECTOR;
+  }
+
+  if (defer && count <= task_seg_limit) {
+    bsp_task_t* task;
+
+    if (!RESERVE(ctx, tasks, task_count, task_capacity)) {
+      free(segs);
+      free(region->points);
+      return REF_SUBSECTOR;
+    }
+
+    task = &tasks[task_count];
+    memset(task, 0, sizeof(*task));
+    task->segs = segs;
+    task->seg_count = count;
+    task->region = *region;
+
+    return REF_TASK | task_count++;
+  }
+
+  if (!dsda_ChoosePartition(ctx, segs, count, &partition)) {
+    int ref;
+
+    ref = dsda_BuildSubsector(ctx, segs, count, region);
+
+    free(segs);
+    free(region->points);
+
+    return ref;
+  }
+
+  front = malloc(count * sizeof(*front));
+  back = malloc(count * sizeof(*back));
+
+  if (!front || !back ||
+      !dsda_SplitSegs(ctx, &partition, segs, count, front, &front_count, back, &back_count) ||
+      !dsda_ClipPolygon(region, &partition, false, &front_region) ||
+      !dsda_ClipPolygon(region, &partition, true, &back_region)) {
+    ctx->failed = true;
+    free(front);
+    free(back);
+    free(front_region.points);
+    free(back_region.points);
+    free(segs);
+    free(region->points);
+    return REF_SUBSECTOR;
+  }
+
+  // Splits that rounded onto an endpoint can leave one side empty
+  if (!front_count || !back_count) {
+    int ref;
+
+    free(front);
+    free(back);
+    free(front_region.points);
+    free(back_region.points);
+
+    ref = dsda_BuildSubsector(ctx, segs, count, region);
+
+    free(segs);
+    free(region->points);
+
+    return ref;
+  }
+
+  free(segs);
+  free(region->points);
+
+  children[0] = dsda_BuildSubtree(ctx, front, front_count, &front_region, defer);
+  children[1] = dsda_BuildSubtree(ctx, back, back_count, &back_region, defer);
+
+  if (!RESERVE(ctx, ctx->nodes, ctx->node_count, ctx->node_capacity))
+    return REF_SUBSECTOR;
+
+  node = &ctx->nodes[ctx->node_count];
+  node->partition = partition;
+  node->children[0] = children[0];
+  node->children[1] = children[1];
+
+  return ctx->node_count++;
+}
+
+static void dsda_BuildTask(void* data) {
+  bsp_task_t* task = data;
+
+  task->context.root = dsda_BuildSubtree(&task->context, task->segs, task->seg_count,
+                                         &task->region, false);
+}
+
+static void dsda_WriteInt32(byte** buffer, unsigned int value) {
+  (*buffer)[0] = value & 0xff;
+  (*buffer)[1] = (value >> 8) & 0xff;
+  (*buffer)[2] = (value >> 16) & 0xff;
+  (*buffer)[3] = (value >> 24) & 0xff;
+  *buffer += 4;
+}
+
+static void dsda_WriteInt16(byte** buffer, int value) {
+  (*buffer)[0] = value & 0xff;
+  (*buffer)[1] = (value >> 8) & 0xff;
+  *buffer += 2;
+}
+
+static int dsda_FinalVertex(const bsp_context_t* ctx, int id) {
+  if (id < ctx->shared_vertex_count)
+    return id;
+
+  return ctx->vertex_base + id - ctx->shared_vertex_count;
+}
+
+static void dsda_WriteBBox(byte** buffer, const fixed_t* bbox) {
+  dsda_WriteInt16(buffer, (bbox[BOXTOP] + FRACUNIT - 1) >> FRACBITS);
+  dsda_WriteInt16(buffer, bbox[BOXBOTTOM] >> FRACBITS);
+  dsda_WriteInt16(buffer, bbox[BOXLEFT] >> FRACBITS);
+  dsda_WriteInt16(buffer, (bbox[BOXRIGHT] + FRACUNIT - 1) >> FRACBITS);
+}
+
+// Post-order, so the root node is written last as the renderer expects
+static unsigned int dsda_EmitSubtree(const bsp_context_t* ctx, int ref, fixed_t* bbox) {
+  if (ref & REF_TASK) {
+    const bsp_task_t* task = &tasks[REF_INDEX(ref)];
+
+    return dsda_EmitSubtree(&task->context, task->context.root, bbox);
+  }
+
+  if (ref & REF_SUBSECTOR) {
+    int i;
+    byte* buffer;
+    const bsp_subsector_t* subsector = &ctx->subsectors[REF_INDEX(ref)];
+
+    M_ClearBox(bbox);
+
+    buffer = output.subsectors + 4 * output.subsector_count;
+    dsda_WriteInt32(&buffer, subsector->seg_count);
+
+    buffer = output.segs + XGL3_SEG_SIZE * output.seg_count;
+
+    for (i = 0; i < subsector->seg_count; ++i) {
+      const bsp_subsector_seg_t* seg = &ctx->segs[subsector->first_seg + i];
+      const bsp_vertex_t* vertex = dsda_BSPVertex(ctx, seg->v1);
+
+      M_AddToBox(bbox, vertex->x, vertex->y);
+
+      dsda_WriteInt32(&buffer, dsda_FinalVertex(ctx, seg->v1));
+      dsda_WriteInt32(&buffer, 0xffffffff);
+      dsda_WriteInt32(&buffer, seg->linedef);
+      *buffer++ = seg->side;
+    }
+
+    output.seg_count += subsector->seg_count;
+
+    return NF_SUBSECTOR | output.subsector_count++;
+  }
+  else {
+    const bsp_node_t* node = &ctx->nodes[ref];
+    fixed_t child_bbox[2][4];
+    unsigned int children[2];
+    byte* buffer;
+
+    children[0] = dsda_EmitSubtree(ctx, node->children[0], child_bbox[0]);
+    children[1] = dsda_EmitSubtree(ctx, node->children[1], child_bbox[1]);
+
+    buffer = output.nodes + XGL3_NODE_SIZE * output.node_count;
+    dsda_WriteInt32(&buffer, node->partition.x);
+    dsda_WriteInt32(&buffer, node->partition.y);
+    dsda_WriteInt32(&buffer, node->partition.dx);
+    dsda_WriteInt32(&buffer, node->partition.dy);
+    dsda_WriteBBox(&buffer, child_bbox[0]);
+    dsda_WriteBBox(&buffer, child_bbox[1]);
+    dsda_WriteInt32(&buffer, children[0]);
+    dsda_WriteInt32(&buffer, children[1]);
+
+    M_ClearBox(bbox);
+    M_AddToBox(bbox, child_bbox[0][BOXLEFT], child_bbox[0][BOXBOTTOM]);
+    M_AddToBox(bbox, child_bbox[0][BOXRIGHT], child_bbox[0][BOXTOP]);
+    M_AddToBox(bbox, child_bbox[1][BOXLEFT], child_bbox[1][BOXBOTTOM]);
+    M_AddToBox(bbox, child_bbox[1][BOXRIGHT], child_bbox[1][BOXTOP]);
+
+    return output.node_count++;
+  }
+}
+
+static byte* dsda_SerializeNodes(const bsp_context_t* main_ctx, int* length) {
+  int i;
+  int vertex_count;
+  int subsector_count;
+  int seg_count;
+  int node_count;
+  byte* result;
+  byte* buffer;
+  fixed_t bbox[4];
+
+  vertex_count = main_ctx->vertex_count;
+  subsector_count = main_ctx->subsector_count;
+  seg_count = main_ctx->seg_count;
+  node_count = main_ctx->node_count;
+
+  for (i = 0; i < task_count; ++i) {
+    bsp_context_t* ctx = &tasks[i].context;
+
+    ctx->vertex_base = vertex_count;
+    vertex_count += ctx->vertex_count;
+    subsector_count += ctx->subsector_count;
+    seg_count += ctx->seg_count;
+    node_count += ctx->node_count;
+  }
+
+  *length = 4 + 8 + 8 * (vertex_count - numvertexes) +
+            4 + 4 * subsector_count +
+            4 + XGL3_SEG_SIZE * seg_count +
+            4 + XGL3_NODE_SIZE * node_count;
+
+  result = Z_Malloc(*length);
+  buffer = result;
+
+  memcpy(buffer, "XGL3", 4);
+  buffer += 4;
+
+  dsda_WriteInt32(&buffer, numvertexes);
+  dsda_WriteInt32(&buffer, vertex_count - numvertexes);
+
+  for (i = numvertexes; i < main_ctx->vertex_count; ++i) {
+    dsda_WriteInt32(&buffer, main_ctx->vertices[i].x);
+    dsda_WriteInt32(&buffer, main_ctx->vertices[i].y);
+  }
+
+  for (i = 0; i < task_count; ++i) {
+    const bsp_context_t* ctx = &tasks[i].context;
+    int j;
+
+    for (j = 0; j < ctx->vertex_count; ++j) {
+      dsda_WriteInt32(&buffer, ctx->vertices[j].x);
+      dsda_WriteInt32(&buffer, ctx->vertices[j].y);
+    }
+  }
+
+  dsda_WriteInt32(&buffer, subsector_count);
+  output.subsectors = buffer;
+  buffer += 4 * subsector_count;
+
+  dsda_WriteInt32(&buffer, seg_count);
+  output.segs = buffer;
+  buffer += XGL3_SEG_SIZE * seg_count;
+
+  dsda_WriteInt32(&buffer, node_count);
+  output.nodes = buffer;
+
+  output.subsector_count = 0;
+  output.seg_count = 0;
+  output.node_count = 0;
+
+  dsda_EmitSubtree(main_ctx, main_ctx->root, bbox);
+
+  return result;
+}
+
+static byte* dsda_RunNodeBuilder(int* length) {
+  int i;
+  int seg_count = 0;
+  int workers;
+  bsp_context_t main_ctx = { 0 };
+  bsp_seg_t* segs;
+  bsp_polygon_t region;
+  fixed_t bbox[4];
+  byte* result;
+  dboolean failed;
+
+  linedef_lines = Z_Malloc(numlines * sizeof(*linedef_lines));
+  segs = malloc(2 * numlines * sizeof(*segs));
+  region.points = malloc(4 * sizeof(*region.points));
+  region.count = 4;
+
+  if (!segs || !region.points)
+    I_Error("dsda_BuildNodes: out of memory");
+
+  main_ctx.vertex_capacity = numvertexes + 64;
+  main_ctx.vertices = malloc(main_ctx.vertex_capacity * sizeof(*main_ctx.vertices));
+
+  if (!main_ctx.vertices)
+    I_Error("dsda_BuildNodes: out of memory");
+
+  M_ClearBox(bbox);
+
+  for (i = 0; i < numvertexes; ++i) {
+    bsp_vertex_t* vertex = &main_ctx.vertices[i];
+
+    vertex->x = vertexes[i].x;
+    vertex->y = vertexes[i].y;
+    vertex->fx = (double) vertex->x / FRACUNIT;
+    vertex->fy = (double) vertex->y / FRACUNIT;
+
+    M_AddToBox(bbox, vertex->x, vertex->y);
+  }
+
+  main_ctx.vertex_count = numvertexes;
+
+  for (i = 0; i < numlines; ++i) {
+    const line_t* line = &lines[i];
+    int v1 = line->v1 - vertexes;
+    int v2 = line->v2 - vertexes;
+
+    dsda_InitBSPLine(&linedef_lines[i], line->v1->x, line->v1->y,
+                     line->v2->x - line->v1->x, line->v2->y - line->v1->y);
+
+    if (!line->dx && !line->dy)
+      continue;
+
+    if (line->sidenum[0] != NO_INDEX) {
+      segs[seg_count].v1 = v1;
+      segs[seg_count].v2 = v2;
+      segs[seg_count].linedef = i;
+      segs[seg_count].side = 0;
+      ++seg_count;
+    }
+
+    if (line->sidenum[1] != NO_INDEX) {
+      segs[seg_count].v1 = v2;
+      segs[seg_count].v2 = v1;
+      segs[seg_count].linedef = i;
+      segs[seg_count].side = 1;
+      ++seg_count;
+    }
+  }
+
+  if (!seg_count)
+    I_Error("dsda_BuildNodes: level has no lines");
+
+  // Clockwise, so the interior is on the front side of every edge
+  region.points[0].x = (double) (bbox[BOXLEFT] >> FRACBITS) - REGION_MARGIN;
+  region.points[0].y = (double) (bbox[BOXTOP] >> FRACBITS) + REGION_MARGIN;
+  region.points[1].x = (double) (bbox[BOXRIGHT] >> FRACBITS) + REGION_MARGIN;
+  region.points[1].y = region.points[0].y;
+  region.points[2].x = region.points[1].x;
+  region.points[2].y = (double) (bbox[BOXBOTTOM] >> FRACBITS) - REGION_MARGIN;
+  region.points[3].x = region.points[0].x;
+  region.points[3].y = region.points[2].y;
+
+  // Leave enough subtrees to keep every worker busy while the big ones finish
+  workers = dsda_ThreadPoolSize();
+  task_seg_limit = MAX(seg_count / (4 * (workers + 1)), MIN_TASK_SEGS);
+  task_count = 0;
+
+  main_ctx.root = dsda_BuildSubtree(&main_ctx, segs, seg_count, &region, workers > 0);
+
+  if (task_count) {
+    dsda_task_group_t group = { 0 };
+
+    for (i = 0; i < task_count; ++i) {
+      tasks[i].context.shared_vertices = main_ctx.vertices;
+      tasks[i].context.shared_vertex_count = main_ctx.vertex_count;
+      dsda_QueueTask(&group, dsda_BuildTask, &tasks[i]);
+    }
+
+    dsda_WaitTasks(&group);
+  }
+
+  failed = main_ctx.failed;
+  for (i = 0; i < task_count; ++i)
+    failed |= tasks[i].context.failed;
+
+  if (failed)
+    I_Error("dsda_BuildNodes: out of memory");
+
+  result = dsda_SerializeNodes(&main_ctx, length);
+
+  lprintf(LO_DEBUG, "dsda_BuildNodes: %d nodes, %d subsectors, %d segs, %d subtrees\n",
+          output.node_count, output.subsector_count, output.seg_count, task_count);
+
+  for (i = 0; i < task_count; ++i)
+    dsda_FreeBSPContext(&tasks[i].context);
+
+  dsda_FreeBSPContext(&main_ctx);
+  free(tasks);
+  tasks = NULL;
+  task_count = 0;
+  task_capacity = 0;
+
+  Z_Free(linedef_lines);
+  linedef_lines = NULL;
+
+  return result;
+}
+
+static char* dsda_NodeCachePath(const int* lumps, int lump_count) {
+  int i;
+  struct MD5Context md5;
+  dsda_cksum_t cksum;
+  dsda_string_t path;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const byte*) NODE_BUILDER_VERSION, strlen(NODE_BUILDER_VERSION));
+
+  for (i = 0; i < lump_count; ++i)
+    MD5Update(&md5, W_LumpByNum(lumps[i]), W_LumpLength(lumps[i]));
+
+  MD5Final(cksum.bytes, &md5);
+  dsda_TranslateCheckSum(&cksum);
+
+  dsda_StringPrintF(&path, "%s/nodes", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.xgl3", cksum.string);
+
+  return path.string;
+}
+
+static dboolean dsda_ValidNodeCache(const byte* data, int length) {
+  return length >= 12 &&
+         !memcmp(data, "XGL3", 4) &&
+         (data[4] | (data[5] << 8) | (data[6] << 16) | ((unsigned int) data[7] << 24)) ==
+           (unsigned int) numvertexes;
+}
+
+byte* dsda_BuildNodes(const int* lumps, int lump_count, int* length) {
+  char* path;
+  byte* result = NULL;
+
+  path = dsda_NodeCachePath(lumps, lump_count);
+
+  *length = M_ReadFile(path, &result);
+
+  if (result && dsda_ValidNodeCache(result, *length)) {
+    lprintf(LO_DEBUG, "dsda_BuildNodes: loaded %s\n", path);
+  }
+  else {
+    Z_Free(result);
+
+    lprintf(LO_INFO, "dsda_BuildNodes: building nodes\n");
+
+    result = dsda_RunNodeBuilder(length);
+
+    if (!M_WriteFile(path, result, *length))
+      lprintf(LO_WARN, "dsda_BuildNodes: unable to write %s\n", path);
+  }
+
+  Z_Free(path);
+
+  return result;
+}
@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Node Builder
+//
+
+#ifndef __DSDA_NODE_BUILDER__
+#define __DSDA_NODE_BUILDER__
+
+#include "doomtype.h"
+
+// Returns uncompressed XGL3 nodes for the loaded lines and vertexes.
+// The lumps identify the map geometry in the on-disk node cache.
+// The result is allocated with Z_Malloc and owned by the caller.
+byte* dsda_BuildNodes(const int* lumps, int lump_count, int* length);
+
+#endif
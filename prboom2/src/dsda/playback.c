@@ -23,6 +23,7 @@
 #include "w_wad.h"
 
 #include "dsda/args.h"
+#include "dsda/batch.h"
 #include "dsda/demo.h"
 #include "dsda/exdemo.h"
 #include "dsda/input.h"
@@ -150,6 +151,13 @@ const char* dsda_ParsePlaybackOptions(void) {
     return playback_filename;
   }
 
+  // A batch plays its first demo as -fastdemo, and the rest follow it
+  arg = dsda_Arg(dsda_arg_batch);
+  if (arg->found) {
+    dsda_InitBatch(arg->value.v_string_array[0], arg->value.v_string_array[1]);
+    dsda_UpdateStringArg(dsda_arg_fastdemo, dsda_BatchDemo());
+  }
+
   arg = dsda_Arg(dsda_arg_fastdemo);
   if (arg->found) {
     fastdemo_arg = arg;
@@ -0,0 +1,254 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Profiler
+//
+//  Each thread records closed zones into its own ring, so recording
+//  never takes a lock. The rings are read when exporting, which should
+//  happen on the main thread while no other thread is recording.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "lprintf.h"
+
+#include "dsda/args.h"
+#include "dsda/time.h"
+
+#include "profiler.h"
+
+#ifdef PROFILER
+
+#define MAX_PROFILE_THREADS 64
+#define PROFILE_RING_SIZE (1 << 16) // events per thread
+#define PROFILE_STACK_SIZE 64
+
+typedef struct {
+  unsigned long long start;
+  unsigned int duration;
+  int zone;
+} profile_event_t;
+
+typedef struct {
+  int id;
+  int generation;
+  unsigned int head;
+  int depth;
+  unsigned long long stack[PROFILE_STACK_SIZE];
+  profile_event_t events[PROFILE_RING_SIZE];
+} profile_thread_t;
+
+static const char* zone_names[DSDA_PROFILE_COUNT] = {
+  [dsda_profile_frame] = "frame",
+  [dsda_profile_tic] = "tic",
+  [dsda_profile_bsp_nodes] = "R_RenderBSPNodes",
+  [dsda_profile_draw_planes] = "R_DrawPlanes",
+  [dsda_profile_draw_masked] = "R_DrawMasked",
+  [dsda_profile_draw_slice] = "R_DrawSlice",
+  [dsda_profile_run_thinkers] = "P_RunThinkers",
+  [dsda_profile_check_sight] = "P_CheckSight",
+  [dsda_profile_path_traverse] = "P_PathTraverse",
+  [dsda_profile_update_sounds] = "S_UpdateSounds",
+  [dsda_profile_finish_update] = "I_FinishUpdate",
+  [dsda_profile_store_key_frame] = "dsda_StoreKeyFrame",
+};
+
+static profile_thread_t* profile_threads[MAX_PROFILE_THREADS];
+static SDL_atomic_t profile_thread_count;
+static SDL_atomic_t profile_generation;
+static THREAD_LOCAL profile_thread_t* profile_thread;
+static unsigned long long profile_epoch;
+static volatile int profiling;
+static const char* profile_filename;
+
+static profile_thread_t* dsda_ProfileThread(void) {
+  int id;
+
+  if (profile_thread)
+    return profile_thread;
+
+  id = SDL_AtomicAdd(&profile_thread_count, 1);
+
+  // Threads past the limit go unrecorded
+  if (id >= MAX_PROFILE_THREADS)
+    return NULL;
+
+  profile_thread = calloc(1, sizeof(*profile_thread));
+
+  if (profile_thread) {
+    profile_thread->id = id;
+    profile_threads[id] = profile_thread;
+  }
+
+  return profile_thread;
+}
+
+void dsda_ProfileBegin(dsda_profile_zone_t zone) {
+  profile_thread_t* thread;
+
+  if (!profiling || !(thread = dsda_ProfileThread()))
+    return;
+
+  if (thread->depth < PROFILE_STACK_SIZE)
+    thread->stack[thread->depth] = dsda_MonotonicTime();
+
+  ++thread->depth;
+}
+
+void dsda_ProfileEnd(dsda_profile_zone_t zone) {
+  profile_thread_t* thread;
+  profile_event_t* event;
+  int generation;
+
+  thread = profile_thread;
+
+  // Zones opened before profiling started are dropped
+  if (!thread || thread->depth <= 0)
+    return;
+
+  --thread->depth;
+
+  if (!profiling || thread->depth >= PROFILE_STACK_SIZE)
+    return;
+
+  // Each thread empties its own ring when it sees a new start
+  generation = SDL_AtomicGet(&profile_generation);
+
+  if (thread->generation != generation) {
+    thread->generation = generation;
+    thread->head = 0;
+  }
+
+  event = &thread->events[thread->head++ & (PROFILE_RING_SIZE - 1)];
+  event->start = thread->stack[thread->depth];
+  event->duration = (unsigned int) (dsda_MonotonicTime() - event->start);
+  event->zone = zone;
+}
+
+dboolean dsda_StartProfile(void) {
+  SDL_AtomicAdd(&profile_generation, 1);
+
+  profile_epoch = dsda_MonotonicTime();
+  profiling = true;
+
+  return true;
+}
+
+dboolean dsda_ExportProfile(const char* filename) {
+  FILE* file;
+  int i, count;
+  dboolean first = true;
+
+  profiling = false;
+
+  file = fopen(filename, "w");
+
+  if (!file) {
+    lprintf(LO_WARN, "dsda_ExportProfile: unable to open %s\n", filename);
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  count = MIN(SDL_AtomicGet(&profile_thread_count), MAX_PROFILE_THREADS);
+
+  for (i = 0; i < count; ++i) {
+    profile_thread_t* thread;
+    unsigned int j, start;
+
+    thread = profile_threads[i];
+
+    if (!thread)
+      continue;
+
+    fprintf(
+      file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+      "\"args\":{\"name\":\"%s %d\"}}",
+      first ? "" : ",\n", thread->id, thread->id ? "worker" : "main", thread->id
+    );
+    first = false;
+
+    start = thread->head > PROFILE_RING_SIZE ? thread->head - PROFILE_RING_SIZE : 0;
+
+    for (j = start; j != thread->head; ++j) {
+      profile_event_t* event;
+
+      event = &thread->events[j & (PROFILE_RING_SIZE - 1)];
+
+      // Events from before the last start are stale
+      if (event->start < profile_epoch)
+        continue;
+
+      fprintf(
+        file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%u}",
+        zone_names[event->zone], thread->id, event->start - profile_epoch, event->duration
+      );
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  lprintf(LO_INFO, "Profile written to %s\n", filename);
+
+  return true;
+}
+
+static void dsda_ExportProfileAtExit(void) {
+  dsda_ExportProfile(profile_filename);
+}
+
+void dsda_InitProfiler(void) {
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_profile);
+
+  if (!arg->found)
+    return;
+
+  profile_filename = arg->value.v_string;
+
+  dsda_StartProfile();
+
+  I_AtExit(dsda_ExportProfileAtExit, true, "dsda_ExportProfile", exit_priority_first);
+}
+
+#else
+
+void dsda_ProfileBegin(dsda_profile_zone_t zone) {
+}
+
+void dsda_ProfileEnd(dsda_profile_zone_t zone) {
+}
+
+dboolean dsda_StartProfile(void) {
+  lprintf(LO_WARN, "dsda_StartProfile: built without the profiler\n");
+
+  return false;
+}
+
+dboolean dsda_ExportProfile(const char* filename) {
+  return false;
+}
+
+void dsda_InitProfiler(void) {
+  if (dsda_Flag(dsda_arg_profile))
+    dsda_StartProfile();
+}
+
+#endif
@@ -0,0 +1,55 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Profiler
+//
+
+#ifndef __DSDA_PROFILER__
+#define __DSDA_PROFILER__
+
+#include "doomtype.h"
+
+typedef enum {
+  dsda_profile_frame,
+  dsda_profile_tic,
+  dsda_profile_bsp_nodes,
+  dsda_profile_draw_planes,
+  dsda_profile_draw_masked,
+  dsda_profile_draw_slice,
+  dsda_profile_run_thinkers,
+  dsda_profile_check_sight,
+  dsda_profile_path_traverse,
+  dsda_profile_update_sounds,
+  dsda_profile_finish_update,
+  dsda_profile_store_key_frame,
+  DSDA_PROFILE_COUNT
+} dsda_profile_zone_t;
+
+// Zones must be closed in the reverse order they were opened, on the same thread.
+// Without the PROFILER build option they compile to nothing.
+#ifdef PROFILER
+#define DSDA_PROFILE_BEGIN(x) dsda_ProfileBegin(x)
+#define DSDA_PROFILE_END(x) dsda_ProfileEnd(x)
+#else
+#define DSDA_PROFILE_BEGIN(x)
+#define DSDA_PROFILE_END(x)
+#endif
+
+void dsda_ProfileBegin(dsda_profile_zone_t zone);
+void dsda_ProfileEnd(dsda_profile_zone_t zone);
+void dsda_InitProfiler(void);
+dboolean dsda_StartProfile(void);
+dboolean dsda_ExportProfile(const char* filename);
+
+#endif
@@ -0,0 +1,459 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Reject
+//
+//  Sector visibility is traced through the two-sided lines between
+//  sectors, treating each one as a portal. A portal is only followed
+//  if some straight line from the source portal can pass through every
+//  portal on the way to it. Floor and ceiling heights, walls inside a
+//  sector, and polyobjects are ignored, so the result can only reject
+//  pairs that really have no line of sight.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lprintf.h"
+#include "r_state.h"
+#include "z_zone.h"
+
+#include "dsda/level_cache.h"
+#include "dsda/thread_pool.h"
+#include "dsda/time.h"
+
+#include "reject.h"
+
+// Distances are in map units
+#define REJECT_EPSILON 0.01
+
+// Sectors that take longer than this to trace see everything
+#define REJECT_STEP_LIMIT 65536
+
+typedef struct {
+  double x1, y1;
+  double x2, y2;
+} reject_seg_t;
+
+// The sector a portal leads to is on its left side
+typedef struct {
+  reject_seg_t seg;
+  int line;
+  int to;
+} reject_portal_t;
+
+typedef struct {
+  reject_seg_t pass;
+  int next;
+  int end;
+  int line;
+} reject_frame_t;
+
+typedef struct {
+  int first;
+  int stride;
+  int overflows;
+  dboolean failed;
+} reject_task_t;
+
+static reject_portal_t* portals;
+static int* sector_portals;
+static byte* visible;
+static int row_size;
+
+#define VISIBLE(row, i) ((row)[(i) >> 3] & (1 << ((i) & 7)))
+#define SET_VISIBLE(row, i) ((row)[(i) >> 3] |= (1 << ((i) & 7)))
+
+static double dsda_RejectSide(double x, double y, double ax, double ay, double dx, double dy, double len) {
+  return (dx * (y - ay) - dy * (x - ax)) / len;
+}
+
+// Keeps the part of seg on the given side of the line through a and b
+static dboolean dsda_ClipRejectSeg(reject_seg_t* seg, double ax, double ay, double bx, double by, double sign) {
+  double dx, dy, len;
+  double d1, d2, t;
+
+  dx = bx - ax;
+  dy = by - ay;
+  len = sqrt(dx * dx + dy * dy);
+
+  if (len < REJECT_EPSILON)
+    return true;
+
+  d1 = sign * dsda_RejectSide(seg->x1, seg->y1, ax, ay, dx, dy, len);
+  d2 = sign * dsda_RejectSide(seg->x2, seg->y2, ax, ay, dx, dy, len);
+
+  if (d1 >= -REJECT_EPSILON && d2 >= -REJECT_EPSILON)
+    return true;
+
+  if (d1 < -REJECT_EPSILON && d2 < -REJECT_EPSILON)
+    return false;
+
+  t = (d1 + REJECT_EPSILON) / (d1 - d2);
+
+  if (d1 < -REJECT_EPSILON) {
+    seg->x1 += t * (seg->x2 - seg->x1);
+    seg->y1 += t * (seg->y2 - seg->y1);
+  }
+  else {
+    double x = seg->x1 + t * (seg->x2 - seg->x1);
+    double y = seg->y1 + t * (seg->y2 - seg->y1);
+
+    seg->x2 = x;
+    seg->y2 = y;
+  }
+
+  return true;
+}
+
+static dboolean dsda_ClipRejectPass(reject_seg_t* seg, const reject_seg_t* pass) {
+  return dsda_ClipRejectSeg(seg, pass->x1, pass->y1, pass->x2, pass->y2, 1);
+}
+
+// A line through one end of the source and one end of the pass bounds
+// what can be seen through both when the rest of each is on either side
+static dboolean dsda_ClipRejectSeparators(reject_seg_t* seg,
+                                          const reject_seg_t* source, const reject_seg_t* pass) {
+  int i, j;
+
+  for (i = 0; i < 2; ++i)
+    for (j = 0; j < 2; ++j) {
+      double sx, sy, ox, oy;
+      double px, py, qx, qy;
+      double dx, dy, len;
+      double ds, dp;
+
+      sx = i ? source->x2 : source->x1;
+      sy = i ? source->y2 : source->y1;
+      ox = i ? source->x1 : source->x2;
+      oy = i ? source->y1 : source->y2;
+      px = j ? pass->x2 : pass->x1;
+      py = j ? pass->y2 : pass->y1;
+      qx = j ? pass->x1 : pass->x2;
+      qy = j ? pass->y1 : pass->y2;
+
+      dx = px - sx;
+      dy = py - sy;
+      len = sqrt(dx * dx + dy * dy);
+
+      if (len < REJECT_EPSILON)
+        continue;
+
+      ds = dsda_RejectSide(ox, oy, sx, sy, dx, dy, len);
+      dp = dsda_RejectSide(qx, qy, sx, sy, dx, dy, len);
+
+      if (ds > REJECT_EPSILON && dp < -REJECT_EPSILON) {
+        if (!dsda_ClipRejectSeg(seg, sx, sy, px, py, -1))
+          return false;
+      }
+      else if (ds < -REJECT_EPSILON && dp > REJECT_EPSILON) {
+        if (!dsda_ClipRejectSeg(seg, sx, sy, px, py, 1))
+          return false;
+      }
+    }
+
+  return true;
+}
+
+static dboolean dsda_TraceRejectSector(int source, byte* row, byte* onstack, reject_frame_t* stack) {
+  int steps = 0;
+  int first;
+
+  for (first = sector_portals[source]; first < sector_portals[source + 1]; ++first) {
+    const reject_portal_t* start = &portals[first];
+    int depth;
+
+    SET_VISIBLE(row, start->to);
+
+    stack[0].pass = start->seg;
+    stack[0].next = sector_portals[start->to];
+    stack[0].end = sector_portals[start->to + 1];
+    stack[0].line = start->line;
+    onstack[start->line] = true;
+    depth = 1;
+
+    while (depth) {
+      reject_frame_t* frame = &stack[depth - 1];
+      const reject_portal_t* portal;
+      reject_seg_t seg;
+
+      if (frame->next == frame->end) {
+        onstack[frame->line] = false;
+        --depth;
+        continue;
+      }
+
+      portal = &portals[frame->next++];
+
+      if (onstack[portal->line])
+        continue;
+
+      if (++steps > REJECT_STEP_LIMIT) {
+        while (depth)
+          onstack[stack[--depth].line] = false;
+
+        return false;
+      }
+
+      seg = portal->seg;
+
+      if (!dsda_ClipRejectPass(&seg, &frame->pass))
+        continue;
+
+      if (depth > 1 &&
+          (!dsda_ClipRejectPass(&seg, &start->seg) ||
+           !dsda_ClipRejectSeparators(&seg, &start->seg, &frame->pass)))
+        continue;
+
+      SET_VISIBLE(row, portal->to);
+
+      frame = &stack[depth++];
+      frame->pass = seg;
+      frame->next = sector_portals[portal->to];
+      frame->end = sector_portals[portal->to + 1];
+      frame->line = portal->line;
+      onstack[portal->line] = true;
+    }
+  }
+
+  return true;
+}
+
+static void dsda_RejectTask(void* data) {
+  reject_task_t* task = data;
+  reject_frame_t* stack;
+  byte* onstack;
+  int i;
+
+  onstack = calloc(numlines, sizeof(*onstack));
+  stack = malloc((numlines + 1) * sizeof(*stack));
+
+  if (!onstack || !stack) {
+    task->failed = true;
+  }
+  else {
+    for (i = task->first; i < numsectors; i += task->stride) {
+      byte* row = visible + (size_t) i * row_size;
+
+      SET_VISIBLE(row, i);
+
+      if (!dsda_TraceRejectSector(i, row, onstack, stack)) {
+        memset(row, 0xff, row_size);
+        ++task->overflows;
+      }
+    }
+  }
+
+  free(onstack);
+  free(stack);
+}
+
+static void dsda_AddRejectPortal(int* count, const line_t* line, const sector_t* from, const sector_t* to,
+                                 dboolean flip) {
+  int from_id = from->iSectorID;
+  reject_portal_t* portal;
+  double x1, y1, x2, y2;
+
+  portal = &portals[sector_portals[from_id] + count[from_id]++];
+
+  x1 = (double) line->v1->x / FRACUNIT;
+  y1 = (double) line->v1->y / FRACUNIT;
+  x2 = (double) line->v2->x / FRACUNIT;
+  y2 = (double) line->v2->y / FRACUNIT;
+
+  // The back sector is on the left of v1 -> v2
+  portal->seg.x1 = flip ? x2 : x1;
+  portal->seg.y1 = flip ? y2 : y1;
+  portal->seg.x2 = flip ? x1 : x2;
+  portal->seg.y2 = flip ? y1 : y2;
+  portal->line = line - lines;
+  portal->to = to->iSectorID;
+}
+
+static dboolean dsda_BuildRejectPortals(void) {
+  int* count;
+  int i;
+
+  sector_portals = calloc(numsectors + 1, sizeof(*sector_portals));
+  count = calloc(numsectors, sizeof(*count));
+
+  if (!sector_portals || !count) {
+    free(count);
+    return false;
+  }
+
+  for (i = 0; i < numlines; ++i) {
+    const line_t* line = &lines[i];
+
+    if (line->backsector && line->backsector != line->frontsector) {
+      ++sector_portals[line->frontsector->iSectorID + 1];
+      ++sector_portals[line->backsector->iSectorID + 1];
+    }
+  }
+
+  for (i = 0; i < numsectors; ++i)
+    sector_portals[i + 1] += sector_portals[i];
+
+  portals = malloc((sector_portals[numsectors] + 1) * sizeof(*portals));
+
+  if (!portals) {
+    free(count);
+    return false;
+  }
+
+  for (i = 0; i < numlines; ++i) {
+    const line_t* line = &lines[i];
+
+    if (line->backsector && line->backsector != line->frontsector) {
+      dsda_AddRejectPortal(count, line, line->frontsector, line->backsector, false);
+      dsda_AddRejectPortal(count, line, line->backsector, line->frontsector, true);
+    }
+  }
+
+  free(count);
+
+  return true;
+}
+
+static void dsda_FreeRejectData(void) {
+  free(portals);
+  free(sector_portals);
+  free(visible);
+  portals = NULL;
+  sector_portals = NULL;
+  visible = NULL;
+}
+
+static byte* dsda_LoadCachedReject(size_t length) {
+  byte* reject = NULL;
+  int counts[] = { numlines, numsectors };
+
+  if (dsda_OpenLevelCache(dsda_level_cache_reject, 0, counts, arrlen(counts))) {
+    const byte* data;
+
+    data = dsda_ReadLevelCache(length);
+
+    if (data && dsda_LevelCacheComplete()) {
+      reject = Z_MallocLevel(length);
+      memcpy(reject, data, length);
+    }
+
+    if (!dsda_CloseLevelCache()) {
+      Z_Free(reject);
+      reject = NULL;
+    }
+  }
+
+  return reject;
+}
+
+byte* dsda_GenerateReject(void) {
+  dsda_task_group_t group = { 0 };
+  reject_task_t* tasks;
+  unsigned long long start;
+  size_t length;
+  byte* reject;
+  int task_count;
+  int overflows;
+  int rejected;
+  int i, j;
+  int counts[] = { numlines, numsectors };
+
+  length = ((size_t) numsectors * numsectors + 7) / 8;
+
+  reject = dsda_LoadCachedReject(length);
+  if (reject)
+    return reject;
+
+  start = dsda_MonotonicTime();
+
+  row_size = (numsectors + 7) / 8;
+  visible = calloc((size_t) numsectors * row_size + 1, 1);
+
+  if (!visible || !dsda_BuildRejectPortals()) {
+    dsda_FreeRejectData();
+    lprintf(LO_WARN, "dsda_GenerateReject: out of memory\n");
+    return NULL;
+  }
+
+  // Each task owns whole rows, so the tasks never write to the same byte
+  task_count = dsda_ThreadPoolSize() + 1;
+  tasks = calloc(task_count, sizeof(*tasks));
+
+  if (!tasks) {
+    dsda_FreeRejectData();
+    lprintf(LO_WARN, "dsda_GenerateReject: out of memory\n");
+    return NULL;
+  }
+
+  for (i = 0; i < task_count; ++i) {
+    tasks[i].first = i;
+    tasks[i].stride = task_count;
+    dsda_QueueTask(&group, dsda_RejectTask, &tasks[i]);
+  }
+
+  dsda_WaitTasks(&group);
+
+  overflows = 0;
+  for (i = 0; i < task_count; ++i) {
+    if (tasks[i].failed) {
+      free(tasks);
+      dsda_FreeRejectData();
+      lprintf(LO_WARN, "dsda_GenerateReject: out of memory\n");
+      return NULL;
+    }
+
+    overflows += tasks[i].overflows;
+  }
+
+  free(tasks);
+
+  // Sight is symmetric, so a pair is only rejected if neither side sees the other
+  reject = Z_MallocLevel(length);
+  memset(reject, 0, length);
+  rejected = 0;
+
+  for (i = 0; i < numsectors; ++i) {
+    const byte* row = visible + (size_t) i * row_size;
+
+    for (j = i + 1; j < numsectors; ++j)
+      if (!VISIBLE(row, j) && !VISIBLE(visible + (size_t) j * row_size, i)) {
+        int pnum;
+
+        pnum = i * numsectors + j;
+        reject[pnum >> 3] |= 1 << (pnum & 7);
+        pnum = j * numsectors + i;
+        reject[pnum >> 3] |= 1 << (pnum & 7);
+        rejected += 2;
+      }
+  }
+
+  dsda_FreeRejectData();
+
+  dsda_BeginLevelCache(dsda_level_cache_reject, 0, counts, arrlen(counts));
+  dsda_WriteLevelCache(reject, length);
+  dsda_EndLevelCache(dsda_MonotonicTime() - start);
+
+  lprintf(LO_INFO, "dsda_GenerateReject: %.1f%% of sector pairs rejected in %llu ms",
+          numsectors ? 100.0 * rejected / ((double) numsectors * numsectors) : 0.0,
+          (dsda_MonotonicTime() - start) / 1000);
+
+  if (overflows)
+    lprintf(LO_INFO, " (%d sectors too complex)", overflows);
+
+  lprintf(LO_INFO, "\n");
+
+  return reject;
+}
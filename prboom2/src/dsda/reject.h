@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Reject
+//
+
+#ifndef __DSDA_REJECT__
+#define __DSDA_REJECT__
+
+#include "doomtype.h"
+
+// Returns a conservative REJECT table for the loaded sectors and lines,
+// or NULL if it could not be built. The result is allocated with
+// Z_MallocLevel. This changes sight checks, so it is not demo compatible.
+byte* dsda_GenerateReject(void);
+
+#endif
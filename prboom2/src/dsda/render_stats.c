@@ -29,6 +29,8 @@ dsda_render_stats_t dsda_render_stats_max;
 int dsda_render_stats_fps = 35;
 
 static void dsda_UpdateMaxValues(dsda_render_stats_t* x, dsda_render_stats_t* y) {
+  int i;
+
   if (x->visplanes < y->visplanes)
     x->visplanes = y->visplanes;
 
@@ -37,6 +39,13 @@ static void dsda_UpdateMaxValues(dsda_render_stats_t* x, dsda_render_stats_t* y)
 
   if (x->vissprites < y->vissprites)
     x->vissprites = y->vissprites;
+
+  if (x->slices < y->slices)
+    x->slices = y->slices;
+
+  for (i = 0; i < y->slices; ++i)
+    if (x->slice_time[i] < y->slice_time[i])
+      x->slice_time[i] = y->slice_time[i];
 }
 
 void dsda_BeginRenderStats(void) {
@@ -72,6 +81,13 @@ void dsda_RecordDrawSegs(int n) {
   frame_stats.drawsegs += n;
 }
 
+void dsda_RecordRenderSlice(int slice, int time) {
+  if (frame_stats.slices <= slice)
+    frame_stats.slices = slice + 1;
+
+  frame_stats.slice_time[slice] = time;
+}
+
 void dsda_UpdateRenderStats(void) {
   dsda_UpdateMaxValues(&interval_stats, &frame_stats);
 
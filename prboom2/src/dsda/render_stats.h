@@ -18,10 +18,14 @@
 #ifndef __RENDER_STATS__
 #define __RENDER_STATS__
 
+#define DSDA_MAX_RENDER_SLICES 16
+
 typedef struct {
   int visplanes;
   int drawsegs;
   int vissprites;
+  int slices;
+  int slice_time[DSDA_MAX_RENDER_SLICES]; // microseconds
 } dsda_render_stats_t;
 
 void dsda_BeginRenderStats(void);
@@ -31,6 +35,7 @@ void dsda_RecordVisPlane(void);
 void dsda_RecordVisPlanes(int n);
 void dsda_RecordDrawSeg(void);
 void dsda_RecordDrawSegs(int n);
+void dsda_RecordRenderSlice(int slice, int time);
 void dsda_UpdateRenderStats(void);
 
 #endif
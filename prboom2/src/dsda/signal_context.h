@@ -29,6 +29,7 @@ typedef enum {
   sf_draw_scene          = 0x0400,
   sf_status_bar          = 0x0800,
   sf_hud                 = 0x1000,
+  sf_draw_slices         = 0x2000,
 } signal_context_t;
 
 extern int signal_context;
@@ -0,0 +1,224 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Cache
+//
+//  Tables built at startup from the loaded wads are kept in
+//  <data root>/startup, one file per section, named by a hash of the
+//  lump directory (names, namespaces, sizes and positions, in load order).
+//  Each section also records a checksum of its own inputs.
+//  Any mismatch in the header means the table is rebuilt and rewritten.
+//
+
+#include <string.h>
+
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/data_organizer.h"
+
+#include "startup_cache.h"
+
+#define STARTUP_CACHE_VERSION 1
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t section;
+  int32_t numlumps;
+  byte inputs[16];
+  uint32_t length;
+} startup_cache_header_t;
+
+static const char* section_ext[DSDA_STARTUP_CACHE_SECTIONS] = {
+  [dsda_startup_cache_textures] = "tex",
+  [dsda_startup_cache_sprites] = "spr",
+};
+
+static dsda_cksum_t directory_cksum;
+static dboolean startup_cache_ready;
+
+static const byte* read_data;
+static size_t read_length;
+static size_t read_offset;
+static dboolean read_overrun;
+
+static byte* write_data;
+static size_t write_length;
+static size_t write_capacity;
+static dsda_startup_cache_section_t write_section;
+
+static char* dsda_StartupCachePath(dsda_startup_cache_section_t section) {
+  dsda_string_t path;
+
+  dsda_StringPrintF(&path, "%s/startup", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.%s", directory_cksum.string, section_ext[section]);
+
+  return path.string;
+}
+
+static void dsda_FillStartupCacheHeader(startup_cache_header_t* header,
+                                        dsda_startup_cache_section_t section,
+                                        const dsda_cksum_t* inputs) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, "DSTC", 4);
+  header->version = STARTUP_CACHE_VERSION;
+  header->section = section;
+  header->numlumps = numlumps;
+  memcpy(header->inputs, inputs->bytes, sizeof(header->inputs));
+}
+
+void dsda_InitStartupCache(void) {
+  int i;
+  struct MD5Context md5;
+
+  if (dsda_Flag(dsda_arg_nostartupcache))
+    return;
+
+  MD5Init(&md5);
+
+  for (i = 0; i < numlumps; ++i) {
+    const lumpinfo_t* lump = &lumpinfo[i];
+    int32_t fields[5];
+
+    fields[0] = lump->size;
+    fields[1] = lump->position;
+    fields[2] = lump->li_namespace;
+    fields[3] = lump->source;
+    fields[4] = lump->wadfile ? (int32_t) (lump->wadfile - wadfiles) : -1;
+
+    MD5Update(&md5, (const byte*) lump->name, 8);
+    MD5Update(&md5, (const byte*) fields, sizeof(fields));
+  }
+
+  MD5Final(directory_cksum.bytes, &md5);
+  dsda_TranslateCheckSum(&directory_cksum);
+
+  startup_cache_ready = true;
+}
+
+dboolean dsda_OpenStartupCache(dsda_startup_cache_section_t section, const dsda_cksum_t* inputs) {
+  char* path;
+  startup_cache_header_t expected;
+  const startup_cache_header_t* header;
+
+  if (!startup_cache_ready)
+    return false;
+
+  path = dsda_StartupCachePath(section);
+  read_data = M_MapFile(path, &read_length);
+  Z_Free(path);
+
+  if (!read_data)
+    return false;
+
+  dsda_FillStartupCacheHeader(&expected, section, inputs);
+  header = (const startup_cache_header_t*) read_data;
+
+  if (
+    read_length < sizeof(*header) ||
+    memcmp(header->magic, expected.magic, 4) ||
+    header->version != expected.version ||
+    header->section != expected.section ||
+    header->numlumps != expected.numlumps ||
+    memcmp(header->inputs, expected.inputs, sizeof(expected.inputs)) ||
+    header->length != read_length - sizeof(*header)
+  ) {
+    lprintf(LO_DEBUG, "dsda_OpenStartupCache: ignoring stale %s data\n", section_ext[section]);
+
+    M_UnmapFile(read_data, read_length);
+    read_data = NULL;
+
+    return false;
+  }
+
+  read_offset = sizeof(*header);
+  read_overrun = false;
+
+  return true;
+}
+
+const void* dsda_ReadStartupCache(size_t size) {
+  const void* result;
+
+  if (read_overrun || size > read_length - read_offset) {
+    read_overrun = true;
+
+    return NULL;
+  }
+
+  result = read_data + read_offset;
+  read_offset += size;
+
+  return result;
+}
+
+dboolean dsda_CloseStartupCache(void) {
+  dboolean result;
+
+  result = !read_overrun && read_offset == read_length;
+
+  M_UnmapFile(read_data, read_length);
+  read_data = NULL;
+
+  return result;
+}
+
+void dsda_BeginStartupCache(dsda_startup_cache_section_t section, const dsda_cksum_t* inputs) {
+  write_section = section;
+  write_length = 0;
+
+  dsda_WriteStartupCache(NULL, sizeof(startup_cache_header_t));
+  dsda_FillStartupCacheHeader((startup_cache_header_t*) write_data, section, inputs);
+}
+
+void dsda_WriteStartupCache(const void* data, size_t size) {
+  if (write_length + size > write_capacity) {
+    write_capacity = MAX(write_capacity * 2, write_length + size);
+    write_data = Z_Realloc(write_data, write_capacity);
+  }
+
+  if (data)
+    memcpy(write_data + write_length, data, size);
+
+  write_length += size;
+}
+
+void dsda_EndStartupCache(void) {
+  char* path;
+  startup_cache_header_t* header;
+
+  if (startup_cache_ready) {
+    header = (startup_cache_header_t*) write_data;
+    header->length = write_length - sizeof(*header);
+
+    path = dsda_StartupCachePath(write_section);
+
+    if (!M_WriteFile(path, write_data, write_length))
+      lprintf(LO_DEBUG, "dsda_EndStartupCache: unable to write %s\n", path);
+
+    Z_Free(path);
+  }
+
+  // startup tables are only built once, so don't hold on to the buffer
+  Z_Free(write_data);
+  write_data = NULL;
+  write_length = 0;
+  write_capacity = 0;
+}
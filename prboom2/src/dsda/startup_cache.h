@@ -0,0 +1,42 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Cache
+//
+
+#ifndef __DSDA_STARTUP_CACHE__
+#define __DSDA_STARTUP_CACHE__
+
+#include <stddef.h>
+
+#include "doomtype.h"
+#include "dsda/utility.h"
+
+typedef enum {
+  dsda_startup_cache_textures,
+  dsda_startup_cache_sprites,
+  DSDA_STARTUP_CACHE_SECTIONS
+} dsda_startup_cache_section_t;
+
+// The inputs checksum covers whatever the section is built from
+// beyond the lump directory, e.g. the contents of TEXTURE1.
+void dsda_InitStartupCache(void);
+dboolean dsda_OpenStartupCache(dsda_startup_cache_section_t section, const dsda_cksum_t* inputs);
+const void* dsda_ReadStartupCache(size_t size);
+dboolean dsda_CloseStartupCache(void);
+void dsda_BeginStartupCache(dsda_startup_cache_section_t section, const dsda_cksum_t* inputs);
+void dsda_WriteStartupCache(const void* data, size_t size);
+void dsda_EndStartupCache(void);
+
+#endif
@@ -0,0 +1,217 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Thread Pool
+//
+//  Tasks must not touch the zone allocator or call I_Error,
+//  since neither is safe to use off the main thread.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "lprintf.h"
+
+#include "thread_pool.h"
+
+#define MAX_WORKERS 64
+
+typedef struct {
+  dsda_task_group_t* group;
+  dsda_task_func_t func;
+  void* data;
+} task_t;
+
+static SDL_mutex* pool_mutex;
+static SDL_cond* task_cond;
+static SDL_cond* done_cond;
+static SDL_Thread* workers[MAX_WORKERS];
+static int worker_count = -1;
+static dboolean shutting_down;
+static dboolean detached;
+
+static task_t* tasks;
+static int task_count;
+static int task_capacity;
+
+static task_t dsda_PopTask(int i) {
+  task_t task;
+
+  task = tasks[i];
+  --task_count;
+  memmove(&tasks[i], &tasks[i + 1], (task_count - i) * sizeof(*tasks));
+
+  return task;
+}
+
+static void dsda_RunTask(task_t task) {
+  SDL_UnlockMutex(pool_mutex);
+  task.func(task.data);
+  SDL_LockMutex(pool_mutex);
+
+  --task.group->pending;
+  SDL_CondBroadcast(done_cond);
+}
+
+static int dsda_WorkerThread(void* data) {
+  SDL_LockMutex(pool_mutex);
+
+  while (1) {
+    while (!task_count && !shutting_down)
+      SDL_CondWait(task_cond, pool_mutex);
+
+    if (shutting_down)
+      break;
+
+    dsda_RunTask(dsda_PopTask(0));
+  }
+
+  SDL_UnlockMutex(pool_mutex);
+
+  return 0;
+}
+
+static void dsda_ShutdownThreadPool(void) {
+  int i;
+
+  SDL_LockMutex(pool_mutex);
+  shutting_down = true;
+  SDL_CondBroadcast(task_cond);
+  SDL_UnlockMutex(pool_mutex);
+
+  for (i = 0; i < worker_count; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  worker_count = 0;
+}
+
+static void dsda_InitThreadPool(void) {
+  int i;
+  int count;
+
+  if (worker_count >= 0)
+    return;
+
+  worker_count = 0;
+
+  pool_mutex = SDL_CreateMutex();
+  task_cond = SDL_CreateCond();
+  done_cond = SDL_CreateCond();
+
+  // Without synchronization primitives, queued tasks still run on the waiting thread
+  if (!pool_mutex || !task_cond || !done_cond) {
+    lprintf(LO_WARN, "dsda_InitThreadPool: %s\n", SDL_GetError());
+    return;
+  }
+
+  // The thread that waits on a task group also runs tasks from it
+  count = BETWEEN(0, MAX_WORKERS, SDL_GetCPUCount() - 1);
+
+  for (i = 0; i < count; ++i) {
+    workers[worker_count] = SDL_CreateThread(dsda_WorkerThread, "dsda_worker", NULL);
+
+    if (!workers[worker_count]) {
+      lprintf(LO_WARN, "dsda_InitThreadPool: %s\n", SDL_GetError());
+      break;
+    }
+
+    ++worker_count;
+  }
+
+  I_AtExit(dsda_ShutdownThreadPool, true, "dsda_ShutdownThreadPool", exit_priority_first);
+}
+
+// A forked process only has the thread that called fork, and the pool lock
+// may have been copied while held. From here on tasks run inline and the
+// pool is never touched again.
+void dsda_DetachThreadPool(void) {
+  detached = true;
+}
+
+int dsda_ThreadPoolSize(void) {
+  if (detached)
+    return 0;
+
+  dsda_InitThreadPool();
+
+  return worker_count;
+}
+
+void dsda_QueueTask(dsda_task_group_t* group, dsda_task_func_t func, void* data) {
+  task_t* task;
+
+  if (!detached)
+    dsda_InitThreadPool();
+
+  if (detached || !pool_mutex) {
+    func(data);
+    return;
+  }
+
+  SDL_LockMutex(pool_mutex);
+
+  if (task_count == task_capacity) {
+    task_capacity = task_capacity ? task_capacity * 2 : 64;
+    tasks = realloc(tasks, task_capacity * sizeof(*tasks));
+    if (!tasks)
+      I_Error("dsda_QueueTask: out of memory");
+  }
+
+  task = &tasks[task_count++];
+  task->group = group;
+  task->func = func;
+  task->data = data;
+  ++group->pending;
+
+  SDL_CondSignal(task_cond);
+  SDL_UnlockMutex(pool_mutex);
+}
+
+void dsda_WaitTasks(dsda_task_group_t* group) {
+  if (detached || !pool_mutex)
+    return;
+
+  SDL_LockMutex(pool_mutex);
+
+  while (group->pending) {
+    int i;
+
+    for (i = 0; i < task_count; ++i)
+      if (tasks[i].group == group)
+        break;
+
+    if (i < task_count)
+      dsda_RunTask(dsda_PopTask(i));
+    else
+      SDL_CondWait(done_cond, pool_mutex);
+  }
+
+  SDL_UnlockMutex(pool_mutex);
+}
+
+dboolean dsda_TasksPending(dsda_task_group_t* group) {
+  dboolean result;
+
+  if (detached || !pool_mutex)
+    return false;
+
+  SDL_LockMutex(pool_mutex);
+  result = group->pending > 0;
+  SDL_UnlockMutex(pool_mutex);
+
+  return result;
+}
@@ -0,0 +1,37 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Thread Pool
+//
+
+#ifndef __DSDA_THREAD_POOL__
+#define __DSDA_THREAD_POOL__
+
+#include "doomtype.h"
+
+typedef void (*dsda_task_func_t)(void* data);
+
+// Tasks are tracked in groups so a caller can wait on just the work it queued.
+// A group must outlive all of its tasks and is only touched under the pool lock.
+typedef struct {
+  int pending;
+} dsda_task_group_t;
+
+void dsda_DetachThreadPool(void);
+int dsda_ThreadPoolSize(void);
+void dsda_QueueTask(dsda_task_group_t* group, dsda_task_func_t func, void* data);
+void dsda_WaitTasks(dsda_task_group_t* group);
+dboolean dsda_TasksPending(dsda_task_group_t* group);
+
+#endif
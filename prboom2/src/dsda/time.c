@@ -56,6 +56,15 @@ static int clock_gettime(int clockid, struct timespec *tp) {
 
 static struct timespec dsda_time[DSDA_TIMER_COUNT];
 
+// Microseconds on a monotonic clock, safe to call from any thread
+unsigned long long dsda_MonotonicTime(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (unsigned long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
 void dsda_StartTimer(int timer) {
   clock_gettime(CLOCK_MONOTONIC, &dsda_time[timer]);
 }
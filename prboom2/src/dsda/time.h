@@ -31,6 +31,7 @@ typedef enum {
 extern int (*dsda_GetTick)(void);
 extern unsigned long long (*dsda_TickElapsedTime)(void);
 
+unsigned long long dsda_MonotonicTime(void);
 void dsda_StartTimer(int timer);
 unsigned long long dsda_ElapsedTime(int timer);
 unsigned long long dsda_ElapsedTimeMS(int timer);
@@ -24,6 +24,8 @@ extern "C" {
 
 #include <inttypes.h>
 
+#include "m_fixed.h"
+
 #define UDMF_ML_BLOCKING           0x0000000000000001ull
 #define UDMF_ML_BLOCKMONSTERS      0x0000000000000002ull
 #define UDMF_ML_TWOSIDED           0x0000000000000004ull
@@ -142,8 +144,8 @@ typedef struct {
 } udmf_side_t;
 
 typedef struct {
-  const char* x;
-  const char* y;
+  fixed_t x;
+  fixed_t y;
 } udmf_vertex_t;
 
 #define UDMF_SECF_LIGHTFLOORABSOLUTE   0x0001
@@ -198,7 +200,7 @@ typedef struct {
   float rotationceiling;
   int lightfloor;
   int lightceiling;
-  const char* gravity;
+  fixed_t gravity;
   int damageamount;
   int damageinterval;
   int leakiness;
@@ -212,8 +214,10 @@ typedef struct {
   float ythrust;
   int thrustgroup;
   int thrustlocation;
-  char* frictionfactor;
-  char* movefactor;
+  fixed_t frictionfactor;
+  fixed_t movefactor;
+  dboolean has_frictionfactor;
+  dboolean has_movefactor;
   udmf_sector_flags_t flags;
 } udmf_sector_t;
 
@@ -241,9 +245,9 @@ typedef uint32_t udmf_thing_flags_t;
 
 typedef struct {
   int id;
-  const char* x;
-  const char* y;
-  const char* height;
+  fixed_t x;
+  fixed_t y;
+  fixed_t height;
   int angle;
   int type;
   int special;
@@ -253,8 +257,8 @@ typedef struct {
   int arg3;
   int arg4;
   char* arg0str;
-  const char* gravity;
-  const char* health;
+  fixed_t gravity;
+  fixed_t health;
   float scalex;
   float scaley;
   float scale;
@@ -285,6 +289,7 @@ extern udmf_t udmf;
 typedef void (*udmf_errorfunc)(const char *fmt, ...);	// this must not return!
 
 void dsda_ParseUDMF(const unsigned char* buffer, size_t length, udmf_errorfunc err);
+void dsda_BenchmarkUDMF(const unsigned char* buffer, size_t length, udmf_errorfunc err);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,277 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA World Hash
+//
+//  A 64 bit hash of the play simulation (mobjs, sectors, players and rng),
+//  taken at the end of every game tic. The stream can be written next to a
+//  demo and later used as a reference: playback stops at the first tic
+//  whose hash differs, instead of the desync showing up at the exit.
+//  The file is a 4 byte version followed by 16 byte frames (tic, map, hash),
+//  all little endian, so streams from different machines can be compared.
+//  The tic counts from the start of the demo, so a demo played in a batch
+//  session gives the same stream as a demo played on its own.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "m_random.h"
+#include "p_mobj.h"
+#include "p_tick.h"
+#include "r_state.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "world_hash.h"
+
+#define DSDA_WORLD_HASH_VERSION 3
+#define DSDA_WORLD_HASH_FRAME_SIZE 16
+
+typedef struct {
+  int32_t tic;
+  int32_t map;
+  uint64_t hash;
+} dsda_world_hash_frame_t;
+
+static FILE* world_hash_export;
+static FILE* world_hash_check;
+
+static void dsda_EncodeLittleEndian(byte* buffer, uint64_t value, int size) {
+  int i;
+
+  for (i = 0; i < size; ++i)
+    buffer[i] = (byte) (value >> (8 * i));
+}
+
+static uint64_t dsda_DecodeLittleEndian(const byte* buffer, int size) {
+  int i;
+  uint64_t value = 0;
+
+  for (i = 0; i < size; ++i)
+    value |= (uint64_t) buffer[i] << (8 * i);
+
+  return value;
+}
+
+static void dsda_WriteWorldHashFrame(const dsda_world_hash_frame_t* frame) {
+  byte buffer[DSDA_WORLD_HASH_FRAME_SIZE];
+
+  dsda_EncodeLittleEndian(buffer, (uint32_t) frame->tic, 4);
+  dsda_EncodeLittleEndian(buffer + 4, (uint32_t) frame->map, 4);
+  dsda_EncodeLittleEndian(buffer + 8, frame->hash, 8);
+
+  fwrite(buffer, sizeof(buffer), 1, world_hash_export);
+}
+
+static dboolean dsda_ReadWorldHashFrame(dsda_world_hash_frame_t* frame) {
+  byte buffer[DSDA_WORLD_HASH_FRAME_SIZE];
+
+  if (fread(buffer, sizeof(buffer), 1, world_hash_check) != 1)
+    return false;
+
+  frame->tic = (int32_t) (uint32_t) dsda_DecodeLittleEndian(buffer, 4);
+  frame->map = (int32_t) (uint32_t) dsda_DecodeLittleEndian(buffer + 4, 4);
+  frame->hash = dsda_DecodeLittleEndian(buffer + 8, 8);
+
+  return true;
+}
+
+static FILE* dsda_OpenWorldHashFile(const char* name, const char* mode) {
+  FILE* file;
+  char* filename;
+
+  filename = Z_Malloc(strlen(name) + 4 + 1);
+  AddDefaultExtension(strcpy(filename, name), ".wsh");
+
+  file = M_OpenFile(filename, mode);
+
+  Z_Free(filename);
+
+  return file;
+}
+
+void dsda_InitWorldHashExport(const char* name) {
+  byte version[4];
+
+  world_hash_export = dsda_OpenWorldHashFile(name, "wb");
+
+  if (world_hash_export == NULL)
+    I_Error("dsda_InitWorldHashExport: failed to open %s", name);
+
+  dsda_EncodeLittleEndian(version, DSDA_WORLD_HASH_VERSION, sizeof(version));
+  fwrite(version, sizeof(version), 1, world_hash_export);
+}
+
+void dsda_InitWorldHashCheck(const char* name) {
+  byte version[4];
+
+  world_hash_check = dsda_OpenWorldHashFile(name, "rb");
+
+  if (world_hash_check == NULL)
+    I_Error("dsda_InitWorldHashCheck: failed to open %s", name);
+
+  if (
+    fread(version, sizeof(version), 1, world_hash_check) != 1 ||
+    dsda_DecodeLittleEndian(version, sizeof(version)) != DSDA_WORLD_HASH_VERSION
+  )
+    I_Error("dsda_InitWorldHashCheck: unsupported world hash version %s", name);
+}
+
+void dsda_CloseWorldHash(void) {
+  if (world_hash_export) {
+    fclose(world_hash_export);
+    world_hash_export = NULL;
+  }
+
+  if (world_hash_check) {
+    fclose(world_hash_check);
+    world_hash_check = NULL;
+  }
+}
+
+// 64 bit FNV-1a on 32 bit words, with an extra shift so that
+// the high bits feed back into the low ones
+static uint64_t dsda_HashInt(uint64_t hash, int value) {
+  hash ^= (uint32_t) value;
+  hash *= 0x100000001b3ull;
+  hash ^= hash >> 29;
+
+  return hash;
+}
+
+static uint64_t dsda_HashMobj(uint64_t hash, const mobj_t* mo) {
+  hash = dsda_HashInt(hash, mo->type);
+  hash = dsda_HashInt(hash, mo->x);
+  hash = dsda_HashInt(hash, mo->y);
+  hash = dsda_HashInt(hash, mo->z);
+  hash = dsda_HashInt(hash, mo->momx);
+  hash = dsda_HashInt(hash, mo->momy);
+  hash = dsda_HashInt(hash, mo->momz);
+  hash = dsda_HashInt(hash, mo->angle);
+  hash = dsda_HashInt(hash, mo->health);
+  hash = dsda_HashInt(hash, (int) mo->flags);
+  hash = dsda_HashInt(hash, (int) (mo->flags >> 32));
+  hash = dsda_HashInt(hash, (int) mo->flags2);
+  hash = dsda_HashInt(hash, (int) (mo->flags2 >> 32));
+  hash = dsda_HashInt(hash, mo->state ? (int) (mo->state - states) : -1);
+  hash = dsda_HashInt(hash, mo->tics);
+  hash = dsda_HashInt(hash, mo->movedir);
+  hash = dsda_HashInt(hash, mo->movecount);
+  hash = dsda_HashInt(hash, mo->reactiontime);
+  hash = dsda_HashInt(hash, mo->threshold);
+  hash = dsda_HashInt(hash, mo->target ? mo->target->type : -1);
+
+  return hash;
+}
+
+static uint64_t dsda_HashSector(uint64_t hash, const sector_t* sec) {
+  hash = dsda_HashInt(hash, sec->floorheight);
+  hash = dsda_HashInt(hash, sec->ceilingheight);
+  hash = dsda_HashInt(hash, sec->lightlevel);
+  hash = dsda_HashInt(hash, sec->special);
+  hash = dsda_HashInt(hash, sec->floorpic);
+  hash = dsda_HashInt(hash, sec->ceilingpic);
+
+  return hash;
+}
+
+static uint64_t dsda_HashPlayer(uint64_t hash, const player_t* player) {
+  int i;
+
+  hash = dsda_HashInt(hash, player->playerstate);
+  hash = dsda_HashInt(hash, player->health);
+  hash = dsda_HashInt(hash, player->readyweapon);
+  hash = dsda_HashInt(hash, player->pendingweapon);
+  hash = dsda_HashInt(hash, player->viewz);
+  hash = dsda_HashInt(hash, player->killcount);
+  hash = dsda_HashInt(hash, player->itemcount);
+  hash = dsda_HashInt(hash, player->secretcount);
+
+  for (i = 0; i < NUMARMOR; ++i)
+    hash = dsda_HashInt(hash, player->armorpoints[i]);
+
+  for (i = 0; i < NUMPOWERS; ++i)
+    hash = dsda_HashInt(hash, player->powers[i]);
+
+  for (i = 0; i < NUMAMMO; ++i)
+    hash = dsda_HashInt(hash, player->ammo[i]);
+
+  return hash;
+}
+
+uint64_t dsda_WorldHash(void) {
+  int i;
+  uint64_t hash;
+  thinker_t* th;
+
+  hash = 0xcbf29ce484222325ull;
+
+  for (i = 0; i < NUMPRCLASS; ++i)
+    hash = dsda_HashInt(hash, rng.seed[i]);
+
+  hash = dsda_HashInt(hash, rng.rndindex);
+  hash = dsda_HashInt(hash, rng.prndindex);
+
+  for (i = 0; i < g_maxplayers; ++i)
+    if (playeringame[i])
+      hash = dsda_HashPlayer(hash, &players[i]);
+
+  for (i = 0; i < numsectors; ++i)
+    hash = dsda_HashSector(hash, &sectors[i]);
+
+  for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    if (th->function == P_MobjThinker || th->function == P_BlasterMobjThinker)
+      hash = dsda_HashMobj(hash, (mobj_t*) th);
+
+  return hash;
+}
+
+void dsda_WorldHashTic(void) {
+  dsda_world_hash_frame_t frame;
+
+  if (!world_hash_export && !world_hash_check)
+    return;
+
+  frame.tic = true_logictic;
+  frame.map = gamemap;
+  frame.hash = dsda_WorldHash();
+
+  if (world_hash_export)
+    dsda_WriteWorldHashFrame(&frame);
+
+  if (world_hash_check) {
+    dsda_world_hash_frame_t reference;
+
+    if (!dsda_ReadWorldHashFrame(&reference)) {
+      lprintf(LO_WARN, "dsda_WorldHashTic: reference ends at tic %d\n", frame.tic);
+
+      fclose(world_hash_check);
+      world_hash_check = NULL;
+
+      return;
+    }
+
+    if (
+      reference.tic != frame.tic ||
+      reference.map != frame.map ||
+      reference.hash != frame.hash
+    )
+      I_Error("dsda_WorldHashTic: desync at tic %d (map %d, level time %d)",
+              frame.tic, gamemap, leveltime);
+  }
+}
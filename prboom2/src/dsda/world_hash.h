@@ -0,0 +1,29 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA World Hash
+//
+
+#ifndef __DSDA_WORLD_HASH__
+#define __DSDA_WORLD_HASH__
+
+#include <stdint.h>
+
+void dsda_InitWorldHashExport(const char* name);
+void dsda_InitWorldHashCheck(const char* name);
+void dsda_CloseWorldHash(void);
+uint64_t dsda_WorldHash(void);
+void dsda_WorldHashTic(void);
+
+#endif
@@ -16,6 +16,8 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zip.h>
 
 #include "i_system.h"
@@ -25,121 +27,318 @@
 
 #include "dsda/utility.h"
 
-static char **temp_dirs;
+#include "zipfile.h"
+
+static dsda_zip_entry_t **zip_entries;
+static int zip_entry_count;
 
 /* Allow a maximum of 1GB to be uncompressed to prevent zip-bombs */
 #define UNZIPPED_BYTES_LIMIT 1000000000ULL
 
 static zip_uint64_t total_bytes_read;
 
-#define CHUNK_SIZE 4 * 1024U
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_EOCD_SEARCH_SIZE (ZIP_EOCD_SIZE + 0xffff)
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_LOCATOR_SIZE 20
+#define ZIP64_EOCD_SIGNATURE 0x06064b50
+#define ZIP64_EOCD_SIZE 56
+#define ZIP64_EXTRA_ID 0x0001
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_LOCAL_SIZE 30
+
+#define ZIP_FLAG_ENCRYPTED 0x0001
+#define ZIP_METHOD_STORE 0
+
+static unsigned int dsda_ZipShort(const byte* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned int dsda_ZipLong(const byte* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static uint64_t dsda_ZipLongLong(const byte* p) {
+  return dsda_ZipLong(p) | ((uint64_t) dsda_ZipLong(p + 4) << 32);
+}
+
+static void dsda_ReadZipData(FILE* file, const char* zipped_file_name,
+                             uint64_t offset, void* dest, size_t size) {
+  if (offset > INT_MAX ||
+      fseek(file, (long) offset, SEEK_SET) ||
+      fread(dest, 1, size, file) != size)
+    I_Error("dsda_OpenZipFile: %s is not a supported zip file.", zipped_file_name);
+}
+
+// Locates the central directory through the (zip64) end of central directory record
+static void dsda_FindCentralDirectory(FILE* file, const char* zipped_file_name,
+                                      uint64_t* count, uint64_t* offset, uint64_t* size) {
+  byte* tail;
+  byte* eocd;
+  long file_size;
+  size_t tail_size;
+
+  if (fseek(file, 0, SEEK_END) || (file_size = ftell(file)) < ZIP_EOCD_SIZE)
+    I_Error("dsda_OpenZipFile: %s is not a zip file.", zipped_file_name);
+
+  tail_size = MIN(file_size, ZIP_EOCD_SEARCH_SIZE);
+  tail = Z_Malloc(tail_size);
+  dsda_ReadZipData(file, zipped_file_name, file_size - tail_size, tail, tail_size);
+
+  // The record is followed by a variable length comment
+  for (eocd = tail + tail_size - ZIP_EOCD_SIZE; eocd >= tail; --eocd)
+    if (dsda_ZipLong(eocd) == ZIP_EOCD_SIGNATURE)
+      break;
+
+  if (eocd < tail)
+    I_Error("dsda_OpenZipFile: %s is not a zip file.", zipped_file_name);
+
+  *count = dsda_ZipShort(eocd + 10);
+  *size = dsda_ZipLong(eocd + 12);
+  *offset = dsda_ZipLong(eocd + 16);
+
+  if (
+    eocd - tail >= ZIP64_LOCATOR_SIZE &&
+    dsda_ZipLong(eocd - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIGNATURE
+  ) {
+    byte eocd64[ZIP64_EOCD_SIZE];
+
+    dsda_ReadZipData(file, zipped_file_name,
+                     dsda_ZipLongLong(eocd - ZIP64_LOCATOR_SIZE + 8), eocd64, sizeof(eocd64));
+    if (dsda_ZipLong(eocd64) != ZIP64_EOCD_SIGNATURE)
+      I_Error("dsda_OpenZipFile: %s is not a supported zip file.", zipped_file_name);
+
+    *count = dsda_ZipLongLong(eocd64 + 32);
+    *size = dsda_ZipLongLong(eocd64 + 40);
+    *offset = dsda_ZipLongLong(eocd64 + 48);
+  }
+
+  Z_Free(tail);
 
-static void dsda_WriteContentToFile(zip_file_t *input_file, FILE *dest_file, zip_uint64_t data_size) {
-  byte buffer[CHUNK_SIZE];
+  if (*offset + *size > (uint64_t) file_size)
+    I_Error("dsda_OpenZipFile: %s is not a supported zip file.", zipped_file_name);
+}
 
-  while (data_size != 0) {
-    zip_uint64_t chunk_size;
-    zip_int64_t bytes_read;
+// Sizes and offsets that don't fit the central directory record live in the zip64 extra field
+static void dsda_ReadZip64Extra(const byte* extra, const byte* extra_end,
+                                uint64_t* size, uint64_t* compressed_size, uint64_t* offset) {
+  while (extra + 4 <= extra_end) {
+    const byte* field = extra + 4;
+    const byte* field_end = field + dsda_ZipShort(extra + 2);
 
-    chunk_size = MIN(data_size, CHUNK_SIZE);
-    bytes_read = zip_fread(input_file, buffer, chunk_size);
-    if (bytes_read == -1)
-      I_Error("dsda_WriteContentToFile: Unable to read data from archive.");
+    if (field_end > extra_end)
+      break;
 
-    if (fwrite(buffer, sizeof(char), bytes_read, dest_file) != bytes_read)
-      I_Error("dsda_WriteContentToFile: Failed to write data to file.");
+    if (dsda_ZipShort(extra) == ZIP64_EXTRA_ID) {
+      if (*size == 0xffffffff && field + 8 <= field_end) {
+        *size = dsda_ZipLongLong(field);
+        field += 8;
+      }
 
-    data_size -= bytes_read;
-    total_bytes_read += bytes_read;
-    if (total_bytes_read >= UNZIPPED_BYTES_LIMIT)
-      I_Error("dsda_WriteContentToFile: Too much data to decompress.");
+      if (*compressed_size == 0xffffffff && field + 8 <= field_end) {
+        *compressed_size = dsda_ZipLongLong(field);
+        field += 8;
+      }
+
+      if (*offset == 0xffffffff && field + 8 <= field_end)
+        *offset = dsda_ZipLongLong(field);
+
+      break;
+    }
+
+    extra = field_end;
   }
 }
 
-static void dsda_WriteZippedFilesToDest(zip_t *archive, const char *destination_directory) {
-  zip_int64_t i;
+static int dsda_CompareZipEntries(const void* a, const void* b) {
+  const dsda_zip_entry_t* entry_a = *(const dsda_zip_entry_t* const*) a;
+  const dsda_zip_entry_t* entry_b = *(const dsda_zip_entry_t* const*) b;
+  int result;
+
+  result = strcasecmp(entry_a->name, entry_b->name);
+  if (result)
+    return result;
 
-  for (i = 0; i < zip_get_num_entries(archive, ZIP_FL_UNCHANGED); i++) {
-    dsda_string_t full_path;
-    zip_file_t *zipped_file;
-    zip_stat_t stat;
-    FILE *dest_file;
-    const char *file_name = dsda_BaseName(zip_get_name(archive, i, ZIP_FL_UNCHANGED));
+  return entry_a->index - entry_b->index;
+}
+
+dsda_zip_entry_t** dsda_OpenZipFile(const char* zipped_file_name) {
+  FILE* file;
+  byte* directory;
+  const byte* p;
+  const byte* directory_end;
+  uint64_t count, offset, size;
+  uint64_t i;
+  char* archive;
+  dsda_zip_entry_t** entries;
+  int entry_count;
+  int unique_count;
+  int j;
+
+  file = M_OpenFile(zipped_file_name, "rb");
+  if (!file)
+    I_Error("dsda_OpenZipFile: Unable to open %s.", zipped_file_name);
+
+  dsda_FindCentralDirectory(file, zipped_file_name, &count, &offset, &size);
+
+  if (size > INT_MAX || count > size / ZIP_CENTRAL_SIZE)
+    I_Error("dsda_OpenZipFile: %s is not a supported zip file.", zipped_file_name);
+
+  directory = Z_Malloc(size);
+  dsda_ReadZipData(file, zipped_file_name, offset, directory, size);
+  directory_end = directory + size;
+
+  archive = Z_Strdup(zipped_file_name);
+  entries = Z_Malloc((count + 1) * sizeof(*entries));
+  entry_count = 0;
+
+  for (i = 0, p = directory; i < count; ++i) {
+    unsigned int flags, method, name_length, extra_length, comment_length;
+    uint64_t entry_size, compressed_size, local_offset;
+    dsda_zip_entry_t* entry;
+    dsda_string_t path;
+    dsda_string_t member;
+    const char* file_name;
+
+    if (p + ZIP_CENTRAL_SIZE > directory_end || dsda_ZipLong(p) != ZIP_CENTRAL_SIGNATURE)
+      I_Error("dsda_OpenZipFile: %s has a corrupt central directory.", zipped_file_name);
+
+    flags = dsda_ZipShort(p + 8);
+    method = dsda_ZipShort(p + 10);
+    compressed_size = dsda_ZipLong(p + 20);
+    entry_size = dsda_ZipLong(p + 24);
+    name_length = dsda_ZipShort(p + 28);
+    extra_length = dsda_ZipShort(p + 30);
+    comment_length = dsda_ZipShort(p + 32);
+    local_offset = dsda_ZipLong(p + 42);
+
+    if (p + ZIP_CENTRAL_SIZE + name_length + extra_length + comment_length > directory_end)
+      I_Error("dsda_OpenZipFile: %s has a corrupt central directory.", zipped_file_name);
+
+    dsda_ReadZip64Extra(p + ZIP_CENTRAL_SIZE + name_length,
+                        p + ZIP_CENTRAL_SIZE + name_length + extra_length,
+                        &entry_size, &compressed_size, &local_offset);
+
+    dsda_StringPrintF(&path, "%.*s", (int) name_length, (const char*) p + ZIP_CENTRAL_SIZE);
+    file_name = dsda_BaseName(path.string);
+
+    p += ZIP_CENTRAL_SIZE + name_length + extra_length + comment_length;
 
     /* Intermediate directories have a trailing '/', so their base name is empty */
     if (*file_name == '\0') {
+      dsda_FreeString(&path);
       continue;
     }
 
-    dsda_StringPrintF(&full_path, "%s/%s", destination_directory, file_name);
+    if (entry_size > INT_MAX)
+      I_Error("dsda_OpenZipFile: %s in %s is too large.", file_name, zipped_file_name);
+
+    entry = Z_Calloc(1, sizeof(*entry));
+    entry->archive = archive;
+    entry->index = (int) i;
+    entry->size = (int) entry_size;
+    entry->stored = (method == ZIP_METHOD_STORE && !(flags & ZIP_FLAG_ENCRYPTED));
+    dsda_StringPrintF(&member, "%s/%s", zipped_file_name, file_name);
+    entry->name = member.string;
 
-    zip_stat_index(archive, i, ZIP_FL_UNCHANGED, &stat);
-    if ((stat.valid & ZIP_STAT_SIZE) == 0)
-      I_Error("dsda_WriteZippedFilesToDest: Failed to read size of zipped file %s.", file_name);
+    // Stored data can be read in place, after the local header
+    if (entry->stored) {
+      byte local[ZIP_LOCAL_SIZE];
+      uint64_t data_offset;
 
-    zipped_file = zip_fopen_index(archive, i, ZIP_FL_UNCHANGED);
-    if (zipped_file == NULL)
-      I_Error("dsda_WriteZippedFilesToDest: Failed to open zipped file %s.", file_name);
+      dsda_ReadZipData(file, zipped_file_name, local_offset, local, sizeof(local));
+      if (dsda_ZipLong(local) != ZIP_LOCAL_SIGNATURE)
+        I_Error("dsda_OpenZipFile: %s has a corrupt entry %s.", zipped_file_name, file_name);
 
-    dest_file = M_OpenFile(full_path.string, "wb");
-    if (dest_file == NULL)
-      I_Error("dsda_WriteZippedFilesToDest: Failed to open destination file %s.", full_path.string);
+      data_offset = local_offset + ZIP_LOCAL_SIZE +
+                    dsda_ZipShort(local + 26) + dsda_ZipShort(local + 28);
+      if (data_offset + entry_size > INT_MAX)
+        I_Error("dsda_OpenZipFile: %s is too large.", zipped_file_name);
 
-    dsda_WriteContentToFile(zipped_file, dest_file, stat.size);
+      entry->offset = (int) data_offset;
+    }
 
-    zip_fclose(zipped_file);
-    fclose(dest_file);
-    dsda_FreeString(&full_path);
+    entries[entry_count++] = entry;
+    dsda_FreeString(&path);
   }
-}
 
-static void dsda_UnzipFileToDestination(const char *zipped_file_name, const char *destination_directory) {
-  int error_code;
-  zip_t *archive_handle;
+  fclose(file);
+  Z_Free(directory);
 
-  total_bytes_read = 0;
-  archive_handle = zip_open(zipped_file_name, ZIP_RDONLY, &error_code);
-  if (archive_handle == NULL) {
-    zip_error_t error;
-    zip_error_init_with_code(&error, error_code);
-    I_Error("dsda_UnzipFileToDestination: Unable to open %s: %s.\n", zipped_file_name, zip_error_strerror(&error));
+  // Members were extracted by base name, so later duplicates win.
+  // Same case insensitive order as the old I_Glob listing.
+  qsort(entries, entry_count, sizeof(*entries), dsda_CompareZipEntries);
+
+  unique_count = 0;
+  for (j = 0; j < entry_count; ++j) {
+    if (j + 1 < entry_count && !strcasecmp(entries[j]->name, entries[j + 1]->name)) {
+      Z_Free(entries[j]->name);
+      Z_Free(entries[j]);
+      continue;
+    }
+
+    entries[unique_count++] = entries[j];
   }
+  entries[unique_count] = NULL;
 
-  dsda_WriteZippedFilesToDest(archive_handle, destination_directory);
+  zip_entries = Z_Realloc(zip_entries, (zip_entry_count + unique_count) * sizeof(*zip_entries));
+  memcpy(zip_entries + zip_entry_count, entries, unique_count * sizeof(*zip_entries));
+  zip_entry_count += unique_count;
 
-  zip_close(archive_handle);
+  return entries;
 }
 
-const char* dsda_UnzipFile(const char *zipped_file_name) {
-  dsda_string_t temporary_directory;
-  static unsigned int file_counter = 0;
+dsda_zip_entry_t* dsda_ZipEntry(const char* name) {
+  int i;
+
+  // Later archives override earlier ones
+  for (i = zip_entry_count - 1; i >= 0; --i)
+    if (!strcmp(zip_entries[i]->name, name))
+      return zip_entries[i];
+
+  return NULL;
+}
 
-  dsda_StringPrintF(&temporary_directory, "%s/%u-%s", I_GetTempDir(), file_counter, dsda_BaseName(zipped_file_name));
-  if (M_IsDir(temporary_directory.string))
-    if (!M_RemoveFilesAtPath(temporary_directory.string))
-      I_Error("dsda_UnzipFile: unable to clear tempdir %s\n", temporary_directory.string);
-  M_MakeDir(temporary_directory.string, true);
+const byte* dsda_ZipEntryData(dsda_zip_entry_t* entry) {
+  int error_code;
+  zip_t* archive_handle;
+  zip_file_t* zipped_file;
+  zip_int64_t bytes_read;
+  zip_uint64_t data_size;
 
-  dsda_UnzipFileToDestination(zipped_file_name, temporary_directory.string);
+  if (entry->data)
+    return entry->data;
 
-  temp_dirs = Z_Realloc(temp_dirs, (file_counter + 2) * sizeof(*temp_dirs));
-  temp_dirs[file_counter] = temporary_directory.string;
-  temp_dirs[file_counter + 1] = NULL;
-  file_counter++;
+  total_bytes_read += entry->size;
+  if (total_bytes_read >= UNZIPPED_BYTES_LIMIT)
+    I_Error("dsda_ZipEntryData: Too much data to decompress.");
 
-  return temporary_directory.string;
-}
+  archive_handle = zip_open(entry->archive, ZIP_RDONLY, &error_code);
+  if (archive_handle == NULL) {
+    zip_error_t error;
+    zip_error_init_with_code(&error, error_code);
+    I_Error("dsda_ZipEntryData: Unable to open %s: %s.\n", entry->archive, zip_error_strerror(&error));
+  }
 
-void dsda_CleanZipTempDirs(void) {
-  int i;
+  zipped_file = zip_fopen_index(archive_handle, entry->index, ZIP_FL_UNCHANGED);
+  if (zipped_file == NULL)
+    I_Error("dsda_ZipEntryData: Failed to open zipped file %s.", entry->name);
 
-  if(temp_dirs == NULL)
-    return;
+  // Terminated so that text lumps can be parsed in place
+  entry->data = Z_Malloc(entry->size + 1);
+  entry->data[entry->size] = '\0';
 
-  for (i = 0; temp_dirs[i] != NULL; i++) {
-    M_RemoveFilesAtPath(temp_dirs[i]);
-    M_remove(temp_dirs[i]);
-    Z_Free(temp_dirs[i]);
+  for (data_size = 0; data_size < entry->size; data_size += bytes_read) {
+    bytes_read = zip_fread(zipped_file, entry->data + data_size, entry->size - data_size);
+    if (bytes_read <= 0)
+      I_Error("dsda_ZipEntryData: Unable to read %s from archive.", entry->name);
   }
-  Z_Free(temp_dirs);
+
+  zip_fclose(zipped_file);
+  zip_close(archive_handle);
+
+  return entry->data;
 }
@@ -18,8 +18,26 @@
 #ifndef __DSDA_ZIPFILE__
 #define __DSDA_ZIPFILE__
 
-const char* dsda_UnzipFile(const char *zipped_file_name);
+#include "doomtype.h"
 
-void dsda_CleanZipTempDirs(void);
+typedef struct dsda_zip_entry_s {
+  char* name;        // "<archive>/<member base name>"
+  const char* archive;
+  int index;         // position in the central directory
+  int size;
+  int offset;        // of the member data in the archive, if stored
+  dboolean stored;
+  byte* data;        // filled in by dsda_ZipEntryData
+} dsda_zip_entry_t;
+
+// Compressed entries are inflated into memory instead of read from the archive
+#define dsda_ZipEntryInMemory(entry) ((entry) && !(entry)->stored)
+
+// Indexes the central directory of an archive.
+// Returns its entries sorted by name, NULL-terminated (caller frees the list).
+dsda_zip_entry_t** dsda_OpenZipFile(const char* zipped_file_name);
+
+dsda_zip_entry_t* dsda_ZipEntry(const char* name);
+const byte* dsda_ZipEntryData(dsda_zip_entry_t* entry);
 
 #endif /* __DSDA_ZIPFILE__ */
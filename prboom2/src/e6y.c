@@ -85,6 +85,7 @@
 #include "m_file.h"
 
 #include "dsda/args.h"
+#include "dsda/batch.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
 #include "dsda/playback.h"
@@ -156,7 +157,8 @@ void ParamsMatchingCheck()
   dboolean playbacking_attempt =
     dsda_Flag(dsda_arg_playdemo) ||
     dsda_Flag(dsda_arg_timedemo) ||
-    dsda_Flag(dsda_arg_fastdemo);
+    dsda_Flag(dsda_arg_fastdemo) ||
+    dsda_Flag(dsda_arg_batch);
 
   if (recording_attempt && playbacking_attempt)
     I_Error("Params are not matching: Can not being played back and recorded at the same time.");
@@ -512,7 +514,7 @@ void e6y_WriteStats(void)
   tmpdata_t *all;
   size_t allkills_len=0, allitems_len=0, allsecrets_len=0;
 
-  f = M_OpenFile("levelstat.txt", "wb");
+  f = M_OpenFile(dsda_BatchOutputFile("levelstat.txt"), "wb");
 
   if (f == NULL)
   {
@@ -88,6 +88,7 @@
 #include "dsda.h"
 #include "dsda/aim.h"
 #include "dsda/args.h"
+#include "dsda/batch.h"
 #include "dsda/brute_force.h"
 #include "dsda/build.h"
 #include "dsda/configuration.h"
@@ -1224,12 +1225,6 @@ static void G_DoLoadLevel (void)
     if (allow_incompatibility)
       G_PlayerReborn(0);
 
-  // initialize the msecnode_t freelist.                     phares 3/25/98
-  // any nodes in the freelist are gone by now, cleared
-  // by Z_FreeTag() when the previous level ended or player
-  // died.
-  P_FreeSecNodeList();
-
   if (map_format.sndseq)
     SN_StopAllSequences();
 
@@ -3942,6 +3937,8 @@ static int LoadDemo(const char *name, const byte **buffer, int *length)
 
 void G_DoPlayDemo(void)
 {
+  dsda_StartBatchDemo();
+
   if (LoadDemo(defdemoname, &demobuffer, &demolength))
   {
     G_StartDemoPlayback(demobuffer, demolength, PLAYBACK_NORMAL);
@@ -3985,6 +3982,9 @@ dboolean G_CheckDemoStatus (void)
     return false;  // killough
   }
 
+  if (dsda_NextBatchDemo())
+    return true;
+
   if (timingdemo)
   {
     int endtime = dsda_GetTickRealTime();
@@ -51,10 +51,14 @@
 #include "gl_intern.h"
 #include "gl_struct.h"
 #include "p_maputl.h"
+#include "p_setup.h"
 #include "r_main.h"
 #include "am_map.h"
 #include "lprintf.h"
 
+#include "dsda/level_cache.h"
+#include "dsda/time.h"
+
 static FILE *levelinfo;
 
 static int gld_max_vertexes = 0;
@@ -852,6 +856,154 @@ static void gld_MarkSectorsForClamp(void)
   }
 }
 
+//
+// Flat triangulation cache
+//
+// The loops, vertexes and the closed / isolated flags they depend on
+// only change with the map geometry, so they are kept in the level cache
+//
+
+static void gld_ReadCachedLoops(GLLoopDef **loops, int *loopcount)
+{
+  const int *count;
+  const GLLoopDef *data;
+
+  count = dsda_ReadLevelCache(sizeof(*count));
+  if (!count || *count <= 0)
+    return;
+
+  data = dsda_ReadLevelCache(*count * sizeof(**loops));
+  if (!data)
+    return;
+
+  *loops = Z_Malloc(*count * sizeof(**loops));
+  memcpy(*loops, data, *count * sizeof(**loops));
+  *loopcount = *count;
+}
+
+static void gld_WriteCachedLoops(const GLLoopDef *loops, int loopcount)
+{
+  dsda_WriteLevelCache(&loopcount, sizeof(loopcount));
+  dsda_WriteLevelCache(loops, loopcount * sizeof(*loops));
+}
+
+// The triangulation follows the vertexes, which the geometry stage may move
+static int gld_FlatCacheVariant(void)
+{
+  return (P_GeometryCacheVariant() << 1) | use_gl_nodes;
+}
+
+static void gld_FlatCacheCounts(int *counts)
+{
+  counts[0] = numvertexes;
+  counts[1] = numsegs;
+  counts[2] = numlines;
+  counts[3] = numsectors;
+  counts[4] = numsubsectors;
+  counts[5] = numnodes;
+}
+
+static dboolean gld_LoadCachedFlats(void)
+{
+  int i;
+  int counts[6];
+  const int *count;
+  const void *data;
+
+  gld_FlatCacheCounts(counts);
+
+  if (!dsda_OpenLevelCache(dsda_level_cache_gl, gld_FlatCacheVariant(), counts, arrlen(counts)))
+    return false;
+
+  count = dsda_ReadLevelCache(sizeof(*count));
+  if (count && *count >= 0 && (data = dsda_ReadLevelCache(*count * sizeof(flats_vbo[0]))))
+  {
+    gld_AddGlobalVertexes(*count);
+    memcpy(flats_vbo, data, *count * sizeof(flats_vbo[0]));
+    gld_num_vertexes = *count;
+  }
+
+  for (i = 0; i < numsectors; i++)
+  {
+    const unsigned int *flags = dsda_ReadLevelCache(2 * sizeof(*flags));
+
+    if (!flags)
+      break;
+
+    sectors[i].flags = (sectors[i].flags & ~SECTOR_IS_CLOSED) | (flags[0] & SECTOR_IS_CLOSED);
+    sectorloops[i].flags = flags[1];
+    gld_ReadCachedLoops(&sectorloops[i].loops, &sectorloops[i].loopcount);
+  }
+
+  for (i = 0; i < numsubsectors; i++)
+    gld_ReadCachedLoops(&subsectorloops[i].loops, &subsectorloops[i].loopcount);
+
+  for (i = 0; i < numlines; i++)
+  {
+    const byte *isolated = dsda_ReadLevelCache(sizeof(*isolated));
+
+    if (!isolated)
+      break;
+
+    if (*isolated)
+      lines[i].r_flags |= RF_ISOLATED;
+  }
+
+  if (dsda_CloseLevelCache())
+    return true;
+
+  // Start over from a clean slate
+  for (i = 0; i < numsectors; i++)
+    Z_Free(sectorloops[i].loops);
+  memset(sectorloops, 0, sizeof(GLSector)*numsectors);
+
+  for (i = 0; i < numsubsectors; i++)
+    Z_Free(subsectorloops[i].loops);
+  memset(subsectorloops, 0, sizeof(GLMapSubsector)*numsubsectors);
+
+  for (i = 0; i < numlines; i++)
+    lines[i].r_flags &= ~RF_ISOLATED;
+
+  gld_num_vertexes = 0;
+
+  return false;
+}
+
+static void gld_CacheFlats(unsigned long long build_time)
+{
+  int i;
+  int counts[6];
+
+  gld_FlatCacheCounts(counts);
+
+  dsda_BeginLevelCache(dsda_level_cache_gl, gld_FlatCacheVariant(), counts, arrlen(counts));
+
+  dsda_WriteLevelCache(&gld_num_vertexes, sizeof(gld_num_vertexes));
+  dsda_WriteLevelCache(flats_vbo, gld_num_vertexes * sizeof(flats_vbo[0]));
+
+  for (i = 0; i < numsectors; i++)
+  {
+    unsigned int flags[2];
+
+    flags[0] = sectors[i].flags & SECTOR_IS_CLOSED;
+    flags[1] = sectorloops[i].flags;
+    dsda_WriteLevelCache(flags, sizeof(flags));
+    gld_WriteCachedLoops(sectorloops[i].loops, sectorloops[i].loopcount);
+  }
+
+  for (i = 0; i < numsubsectors; i++)
+    gld_WriteCachedLoops(subsectorloops[i].loops, subsectorloops[i].loopcount);
+
+  for (i = 0; i < numlines; i++)
+  {
+    byte isolated = !!(lines[i].r_flags & RF_ISOLATED);
+
+    dsda_WriteLevelCache(&isolated, sizeof(isolated));
+  }
+
+  dsda_EndLevelCache(build_time);
+}
+
 static void gld_PreprocessSectors(void)
 {
   char *vertexcheck = NULL;
@@ -860,6 +1012,7 @@ static void gld_PreprocessSectors(void)
   int v2num;
   int i;
   int j;
+  unsigned long long start;
 
   if (numsectors)
   {
@@ -900,6 +1053,11 @@ static void gld_PreprocessSectors(void)
     gld_AddGlobalVertexes(numvertexes*2);
   }
 
+  if (gld_LoadCachedFlats())
+    return;
+
+  start = dsda_MonotonicTime();
+
   if (numvertexes)
   {
     vertexcheck=Z_Malloc(numvertexes*sizeof(vertexcheck[0]));
@@ -998,6 +1156,8 @@ static void gld_PreprocessSectors(void)
 
   //e6y: for seamless rendering
   gld_MarkSectorsForClamp();
+
+  gld_CacheFlats(dsda_MonotonicTime() - start);
 }
 
 static void gld_PreprocessSegs(void)
@@ -1105,6 +1265,8 @@ void gld_PreprocessLevel(void)
   gld_InitVertexData();
 
   gl_preprocessed = true;
+
+  dsda_ReportLevelCache();
 }
 
 /*****************************
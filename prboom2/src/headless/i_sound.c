@@ -0,0 +1,136 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Null sound and music backend for the headless build
+//
+//  Nothing is opened and nothing is mixed. The sfx lump lookup is kept,
+//  since level precaching goes through it.
+//
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "i_sound.h"
+#include "w_wad.h"
+
+#include "dsda/configuration.h"
+
+int snd_samplerate;
+
+const char *midiplayers[midi_player_last + 1] = {
+  "fluidsynth", "opl", "portmidi", NULL };
+
+void I_InitSoundParams(void)
+{
+  if (!snd_samplerate)
+    snd_samplerate = dsda_IntConfig(dsda_config_snd_samplerate);
+}
+
+void I_InitSound(void)
+{
+  nosfxparm = true;
+  nomusicparm = true;
+}
+
+void I_ShutdownSound(void)
+{
+}
+
+void I_SetChannels(void)
+{
+}
+
+int I_GetSfxLumpNum(sfxinfo_t *sfx)
+{
+  if (sfx->link)
+    sfx = sfx->link;
+
+  if (!sfx->name)
+    return LUMP_NOT_FOUND;
+
+  return W_CheckNumForName(sfx->name);
+}
+
+int I_StartSound(int id, int channel, sfx_params_t *params)
+{
+  return -1;
+}
+
+void I_StopSound(int handle)
+{
+}
+
+dboolean I_SoundIsPlaying(int handle)
+{
+  return false;
+}
+
+dboolean I_AnySoundStillPlaying(void)
+{
+  return false;
+}
+
+void I_UpdateSoundParams(int handle, sfx_params_t *params)
+{
+}
+
+void I_SetSoundCap(void)
+{
+}
+
+unsigned char *I_GrabSound(int len)
+{
+  return NULL;
+}
+
+void I_InitMusic(void)
+{
+}
+
+void I_ShutdownMusic(void)
+{
+}
+
+void I_ResetMusicVolume(void)
+{
+  snd_MusicVolume = dsda_IntConfig(dsda_config_music_volume);
+}
+
+void I_PauseSong(int handle)
+{
+}
+
+void I_ResumeSong(int handle)
+{
+}
+
+int I_RegisterSong(const void *data, size_t len)
+{
+  return 0;
+}
+
+void I_PlaySong(int handle, int looping)
+{
+}
+
+void I_StopSong(int handle)
+{
+}
+
+void I_UnRegisterSong(int handle)
+{
+}
+
+void M_ChangeMIDIPlayer(void)
+{
+}
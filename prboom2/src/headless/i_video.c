@@ -0,0 +1,169 @@
+//
+// Copyright(C) 2024 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Null video and input backend for the headless build
+//
+//  No window, renderer or GL context is created and SDL is started
+//  without any subsystem. The drawers are always off, so the screens
+//  only have to exist for the status bar and automap setup.
+//
+
+#include "SDL.h"
+
+#include "am_map.h"
+#include "doomstat.h"
+#include "f_wipe.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "lprintf.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "r_things.h"
+#include "st_stuff.h"
+#include "v_video.h"
+
+dboolean window_focused = true;
+int desired_fullscreen;
+int exclusive_fullscreen;
+SDL_Surface *screen;
+SDL_Window *sdl_window;
+SDL_Renderer *sdl_renderer;
+
+const char *screen_resolutions_list[] = { "320x200", NULL };
+
+static dboolean video_initialized;
+
+dboolean I_WindowFocused(void)
+{
+  return true;
+}
+
+void I_StartTic(void)
+{
+}
+
+void I_StartFrame(void)
+{
+}
+
+void I_InitMouse(void)
+{
+}
+
+void UpdateGrab(void)
+{
+}
+
+void I_QueueFrameCapture(void)
+{
+}
+
+void I_QueueScreenshot(void)
+{
+}
+
+void I_HandleCapture(void)
+{
+}
+
+void I_FinishUpdate(void)
+{
+}
+
+void I_SetPalette(int pal)
+{
+}
+
+void I_SetWindowCaption(void)
+{
+}
+
+void I_SetWindowIcon(void)
+{
+}
+
+void I_ShutdownGraphics(void)
+{
+}
+
+static void I_ShutdownSDL(void)
+{
+  SDL_Quit();
+}
+
+void I_PreInitGraphics(void)
+{
+  if (SDL_Init(0) < 0)
+    I_Error("Could not initialize SDL [%s]", SDL_GetError());
+
+  I_AtExit(I_ShutdownSDL, true, "I_ShutdownSDL", exit_priority_normal);
+}
+
+void I_InitScreenResolution(void)
+{
+  int i;
+
+  // Nothing is ever presented, so drawing is skipped no matter what -nodraw says
+  nodrawers = true;
+
+  V_InitMode(VID_MODESW);
+
+  SCREENWIDTH = 320;
+  SCREENHEIGHT = 200;
+  SCREENPITCH = ((SCREENWIDTH + 15) & ~15) + 32;
+
+  V_FreeScreens();
+
+  for (i = 0; i < 3; i++)
+  {
+    screens[i].width = SCREENWIDTH;
+    screens[i].height = SCREENHEIGHT;
+    screens[i].pitch = SCREENPITCH;
+  }
+
+  screens[4].width = SCREENWIDTH;
+  screens[4].height = SCREENHEIGHT;
+  screens[4].pitch = SCREENPITCH;
+
+  R_InitMeltRes();
+  R_InitSpritesRes();
+  R_InitBuffersRes();
+  R_InitPlanesRes();
+  R_InitVisplanesRes();
+
+  lprintf(LO_DEBUG, "I_InitScreenResolution: Using resolution %dx%d\n", SCREENWIDTH, SCREENHEIGHT);
+}
+
+void I_InitGraphics(void)
+{
+  if (!video_initialized)
+    I_UpdateVideoMode();
+}
+
+void I_UpdateVideoMode(void)
+{
+  if (video_initialized)
+    I_InitScreenResolution();
+
+  video_initialized = true;
+
+  V_AllocScreens();
+  R_InitBuffer(SCREENWIDTH, SCREENHEIGHT);
+  R_ExecuteSetViewSize();
+  V_SetPalette(0);
+
+  ST_SetResolution();
+  AM_SetResolution();
+}
@@ -361,6 +361,7 @@ void A_SetShootable(mobj_t * actor)
 {
     actor->flags2 &= ~MF2_NONSHOOTABLE;
     actor->flags |= MF_SHOOTABLE;
+    P_UpdateTargetLink(actor);
 }
 
 void A_UnSetShootable(mobj_t * actor)
@@ -855,6 +856,7 @@ void A_BellReset2(mobj_t * actor)
     actor->flags |= MF_SHOOTABLE;
     actor->flags &= ~MF_CORPSE;
     actor->health = 5;
+    P_UpdateTargetLink(actor);
 }
 
 void A_FlameCheck(mobj_t * actor)
@@ -952,6 +954,7 @@ void A_TreeDeath(mobj_t * actor)
         actor->flags |= MF_SHOOTABLE;
         actor->flags &= ~(MF_CORPSE + MF_DROPOFF);
         actor->health = 35;
+        P_UpdateTargetLink(actor);
         return;
     }
     else
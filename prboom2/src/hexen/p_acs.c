@@ -26,6 +26,7 @@
 #include "p_tick.h"
 #include "p_spec.h"
 #include "p_inter.h"
+#include "p_map.h"
 
 #include "hexen/p_things.h"
 #include "hexen/po_man.h"
@@ -1760,6 +1761,7 @@ static int CmdSetLineBlocking(void)
     {
         line->flags = (line->flags & ~ML_BLOCKING) | blocking;
     }
+    P_InvalidateSightCache();   // any line flag change, as in Line_SetBlocking
     return SCRIPT_CONTINUE;
 }
 
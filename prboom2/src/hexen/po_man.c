@@ -788,6 +788,7 @@ dboolean PO_MovePolyobj(int num, int x, int y)
     }
 
     UnLinkPolyobj(po);
+    P_InvalidateSightCache();
 
     segList = po->segs;
     prevPts = po->prevPts;
@@ -906,6 +907,7 @@ dboolean PO_RotatePolyobj(int num, angle_t angle)
     an = (po->angle + angle) >> ANGLETOFINESHIFT;
 
     UnLinkPolyobj(po);
+    P_InvalidateSightCache();
 
     segList = po->segs;
     originalPts = po->originalPts;
@@ -1513,8 +1515,8 @@ void PO_LoadUDMFThings(int lump)
         if (mt->type >= map_format.dn_polyspawn_start &&
             mt->type <= map_format.dn_polyspawn_end)
         {                       // Polyobj StartSpot Pt.
-            polyobjs[polyIndex].startSpot.x = dsda_StringToFixed(mt->x);
-            polyobjs[polyIndex].startSpot.y = dsda_StringToFixed(mt->y);
+            polyobjs[polyIndex].startSpot.x = mt->x;
+            polyobjs[polyIndex].startSpot.y = mt->y;
             SpawnPolyobj(polyIndex, mt->angle,
                          (mt->type != map_format.dn_polyspawn_start),
                          (mt->type == map_format.dn_polyspawn_hurt));
@@ -1527,8 +1529,8 @@ void PO_LoadUDMFThings(int lump)
         if (mt->type == map_format.dn_polyanchor)
         {                       // Polyobj Anchor Pt.
             TranslateToStartSpot(mt->angle,
-                                 dsda_StringToFixed(mt->x),
-                                 dsda_StringToFixed(mt->y));
+                                 mt->x,
+                                 mt->y);
         }
     }
 
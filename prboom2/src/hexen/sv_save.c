@@ -1447,7 +1447,7 @@ static void UnarchiveMobjs(void)
     MobjList = Z_Malloc(MobjCount * sizeof(mobj_t *));
     for (i = 0; i < MobjCount; i++)
     {
-        MobjList[i] = Z_MallocLevel(sizeof(mobj_t));
+        MobjList[i] = Z_MallocPool(ZONE_POOL_MOBJ, sizeof(mobj_t));
         memset(MobjList[i], 0, sizeof(mobj_t));
     }
     for (i = 0; i < MobjCount; i++)
@@ -36,6 +36,8 @@
 #include <windows.h>
 #include <io.h>
 #include <direct.h>
+#else
+#include <sys/mman.h>
 #endif
 
 #ifdef HAVE_CONFIG_H
@@ -438,6 +440,62 @@ int M_ReadFile(char const *name, byte **buffer)
   return -1;
 }
 
+/*
+ * M_MapFile
+ *
+ * Maps a whole file read-only, returning NULL if it can't be mapped
+ */
+
+const void *M_MapFile(char const *name, size_t *length)
+{
+  int fd;
+  off_t size;
+  void *data = NULL;
+
+  fd = M_OpenRB(name);
+  if (fd < 0)
+    return NULL;
+
+  size = lseek(fd, 0, SEEK_END);
+
+  if (size > 0)
+  {
+#ifdef _WIN32
+    HANDLE hnd_map;
+
+    hnd_map = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hnd_map)
+    {
+      // The view keeps the mapping alive
+      data = MapViewOfFile(hnd_map, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(hnd_map);
+    }
+#else
+    data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+      data = NULL;
+#endif
+  }
+
+  close(fd);
+
+  *length = data ? size : 0;
+
+  return data;
+}
+
+void M_UnmapFile(const void *data, size_t length)
+{
+  if (!data)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+#else
+  munmap((void *)data, length);
+#endif
+}
+
 // Same as above, but add null terminator
 int M_ReadFileToString(char const *name, char **buffer) {
   FILE *fp;
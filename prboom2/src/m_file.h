@@ -49,6 +49,8 @@ dboolean M_FileExists(const char *name);
 dboolean M_WriteFile (char const* name, const void* source, size_t length);
 int M_ReadFile (char const* name,byte** buffer);
 int M_ReadFileToString(char const *name, char **buffer);
+const void *M_MapFile(char const *name, size_t *length);
+void M_UnmapFile(const void *data, size_t length);
 dboolean M_RemoveFilesAtPath(const char *path);
 
 int M_remove(const char *path);
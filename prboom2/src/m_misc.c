@@ -150,6 +150,7 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_usegamma),
   MIGRATED_SETTING(dsda_config_fps_limit),
   MIGRATED_SETTING(dsda_config_background_fps_limit),
+  MIGRATED_SETTING(dsda_config_render_threads),
   MIGRATED_SETTING(dsda_config_sdl_video_window_pos),
   MIGRATED_SETTING(dsda_config_palette_ondamage),
   MIGRATED_SETTING(dsda_config_palette_onbonus),
@@ -275,6 +276,7 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_auto_key_frame_interval),
   MIGRATED_SETTING(dsda_config_auto_key_frame_depth),
   MIGRATED_SETTING(dsda_config_auto_key_frame_timeout),
+  MIGRATED_SETTING(dsda_config_auto_key_frame_memory),
   MIGRATED_SETTING(dsda_config_auto_save),
   MIGRATED_SETTING(dsda_config_exhud),
   MIGRATED_SETTING(dsda_config_ex_text_scale_x),
@@ -315,6 +317,9 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_weaponbob),
   MIGRATED_SETTING(dsda_config_quake_intensity),
   MIGRATED_SETTING(dsda_config_organize_failed_demos),
+  MIGRATED_SETTING(dsda_config_generate_reject),
+  MIGRATED_SETTING(dsda_config_lump_cache_size),
+  MIGRATED_SETTING(dsda_config_sight_cache),
 
   SETTING_HEADING("Scripts"),
   MIGRATED_SETTING(dsda_config_script_0),
@@ -527,7 +527,7 @@ int EV_DoDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_MallocLevel (sizeof(*door));
+    door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
@@ -752,7 +752,7 @@ int EV_VerticalDoor
   }
 
   // new door thinker
-  door = Z_MallocLevel (sizeof(*door));
+  door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
   sec->ceilingdata = door; //jff 2/22/98
@@ -824,7 +824,7 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
   vldoor_t* door;
 
-  door = Z_MallocLevel ( sizeof(*door));
+  door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
 
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
@@ -856,7 +856,7 @@ void P_SpawnDoorRaiseIn5Mins
 {
   vldoor_t* door;
 
-  door = Z_MallocLevel ( sizeof(*door));
+  door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
 
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
@@ -969,7 +969,7 @@ void Heretic_EV_VerticalDoor(line_t * line, mobj_t * thing)
     //
     // new door thinker
     //
-    door = Z_MallocLevel(sizeof(*door));
+    door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
     memset(door, 0, sizeof(*door));
     P_AddThinker(&door->thinker);
     sec->ceilingdata = door;
@@ -1011,7 +1011,7 @@ static void P_SpawnZDoomDoor(sector_t *sec, vldoor_e type, line_t *line, fixed_t
 {
   vldoor_t *door;
 
-  door = Z_MallocLevel(sizeof(*door));
+  door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
   memset(door, 0, sizeof(*door));
   P_AddThinker(&door->thinker);
   sec->ceilingdata = door;
@@ -1173,7 +1173,7 @@ int Hexen_EV_DoDoor(line_t * line, byte * args, vldoor_e type)
         }
         // Add new door thinker
         retcode = 1;
-        door = Z_MallocLevel(sizeof(*door));
+        door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
         memset(door, 0, sizeof(*door));
         P_AddThinker(&door->thinker);
         sec->ceilingdata = door;
@@ -1226,7 +1226,7 @@ dboolean Hexen_EV_VerticalDoor(line_t * line, mobj_t * thing)
     //
     // new door thinker
     //
-    door = Z_MallocLevel(sizeof(*door));
+    door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
     memset(door, 0, sizeof(*door));
     P_AddThinker(&door->thinker);
     sec->ceilingdata = door;
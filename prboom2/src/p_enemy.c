@@ -87,46 +87,152 @@ void P_ZBumpCheck(mobj_t *);                                        // phares
 // but some can be made preaware
 //
 
+//
+// Sound flood
+//
+// Each sector keeps its two-sided lines in a compact list, together with
+// the sector on the far side as seen from it. Whether a line is open still
+// depends on the current plane heights, so that is checked during the flood.
+// The list and the flood stack are set up once per level.
+//
+
+typedef struct
+{
+  line_t *line;
+  sector_t *other;
+} sound_line_t;
+
+typedef struct
+{
+  sector_t *sec;
+  int soundblocks;
+  int next;
+} sound_frame_t;
+
+static sound_line_t *sound_lines;
+static int *sound_line_start;
+static sound_frame_t *sound_stack;
+
+void P_InitSoundFlood(void)
+{
+  int i, j, count;
+
+  count = 0;
+  for (i = 0; i < numsectors; i++)
+    for (j = 0; j < sectors[i].linecount; j++)
+      if (sectors[i].lines[j]->flags & ML_TWOSIDED)
+        count++;
+
+  sound_lines = Z_MallocLevel(count * sizeof(*sound_lines));
+  sound_line_start = Z_MallocLevel((numsectors + 1) * sizeof(*sound_line_start));
+
+  // A sector is pushed at most twice per flood:
+  // once to soundtraversed 2 and once more to 1.
+  sound_stack = Z_MallocLevel(2 * numsectors * sizeof(*sound_stack));
+
+  count = 0;
+  for (i = 0; i < numsectors; i++)
+  {
+    sector_t *sec = &sectors[i];
+
+    sound_line_start[i] = count;
+
+    for (j = 0; j < sec->linecount; j++)
+    {
+      line_t *check = sec->lines[j];
+
+      if (!(check->flags & ML_TWOSIDED))
+        continue;
+
+      sound_lines[count].line = check;
+      sound_lines[count].other = check->sidenum[1] == NO_INDEX ? NULL :
+        sides[check->sidenum[sides[check->sidenum[0]].sector==sec]].sector;
+      count++;
+    }
+  }
+
+  sound_line_start[numsectors] = count;
+}
+
 //
 // Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
+// Traverse adjacent sectors,
 // sound blocking lines cut off traversal.
 //
 // killough 5/5/98: reformatted, cleaned up
+//
+// This visits sectors in the same depth-first order as the old recursive
+// version, but keeps its own stack and doesn't call P_LineOpening per line.
+// The line opening left behind by the last line checked is restored at the end.
+//
 
-static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget)
+static dboolean P_PushSoundSector(sound_frame_t **top, sector_t *sec,
+                                  int soundblocks, mobj_t *soundtarget)
 {
-  int i;
-
   // wake up all monsters in this sector
   if (sec->validcount == validcount && sec->soundtraversed <= soundblocks+1)
-    return;             // already flooded
+    return false;       // already flooded
 
   sec->validcount = validcount;
   sec->soundtraversed = soundblocks+1;
   P_SetTarget(&sec->soundtarget, soundtarget);
 
-  for (i=0; i<sec->linecount; i++)
+  (*top)->sec = sec;
+  (*top)->soundblocks = soundblocks;
+  (*top)->next = sound_line_start[sec->iSectorID];
+  ++*top;
+
+  return true;
+}
+
+static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget)
+{
+  sound_frame_t *top = sound_stack;
+  line_t *last_line = NULL;
+  line_t *last_open_line = NULL;
+
+  P_PushSoundSector(&top, sec, soundblocks, soundtarget);
+
+  while (top > sound_stack)
   {
-    sector_t *other;
-    line_t *check = sec->lines[i];
+    sound_frame_t *frame = top - 1;
+    const sound_line_t *sound_line;
+    const sector_t *front, *back;
+    fixed_t opentop, openbottom;
 
-    if (!(check->flags & ML_TWOSIDED))
+    if (frame->next == sound_line_start[frame->sec->iSectorID + 1])
+    {
+      --top;
       continue;
+    }
 
-    P_LineOpening(check, NULL);
+    sound_line = &sound_lines[frame->next++];
+    last_line = sound_line->line;
 
-    if (line_opening.range <= 0)
-      continue;       // closed door
+    if (!sound_line->other)
+      continue;       // two-sided flag without a back side
+
+    last_open_line = last_line;
+
+    front = last_line->frontsector;
+    back = last_line->backsector;
+    opentop = MIN(front->ceilingheight, back->ceilingheight);
+    openbottom = MAX(front->floorheight, back->floorheight);
 
-    other=sides[check->sidenum[sides[check->sidenum[0]].sector==sec]].sector;
+    if (opentop - openbottom <= 0)
+      continue;       // closed door
 
-    if (!(check->flags & ML_SOUNDBLOCK))
-      P_RecursiveSound(other, soundblocks, soundtarget);
+    if (!(last_line->flags & ML_SOUNDBLOCK))
+      P_PushSoundSector(&top, sound_line->other, frame->soundblocks, soundtarget);
     else
-      if (!soundblocks)
-        P_RecursiveSound(other, 1, soundtarget);
+      if (!frame->soundblocks)
+        P_PushSoundSector(&top, sound_line->other, 1, soundtarget);
   }
+
+  if (last_open_line)
+    P_LineOpening(last_open_line, NULL);
+  if (last_line != last_open_line)
+    P_LineOpening(last_line, NULL);
 }
 
 //
@@ -998,21 +1104,21 @@ static dboolean P_LookForMonsters(mobj_t *actor, dboolean allaround)
 
     // Search first in the immediate vicinity.
 
-    if (!P_BlockThingsIterator(x, y, PIT_FindTarget))
+    if (!P_BlockTargetsIterator(x, y, PIT_FindTarget))
       return true;
 
     for (d = 1; d < 5; d++)
     {
       int i = 1 - d;
       do
-        if (!P_BlockThingsIterator(x + i, y - d, PIT_FindTarget) ||
-            !P_BlockThingsIterator(x + i, y + d, PIT_FindTarget))
+        if (!P_BlockTargetsIterator(x + i, y - d, PIT_FindTarget) ||
+            !P_BlockTargetsIterator(x + i, y + d, PIT_FindTarget))
           return true;
       while (++i < d);
 
       do
-        if (!P_BlockThingsIterator(x - d, y + i, PIT_FindTarget) ||
-            !P_BlockThingsIterator(x + d, y + i, PIT_FindTarget))
+        if (!P_BlockTargetsIterator(x - d, y + i, PIT_FindTarget) ||
+            !P_BlockTargetsIterator(x + d, y + i, PIT_FindTarget))
           return true;
       while (--i + d >= 0);
     }
@@ -1919,6 +2025,7 @@ dboolean P_RaiseThing(mobj_t *corpse, mobj_t *raiser)
   P_SetTarget(&corpse->lastenemy, NULL);
 
   P_UpdateThinker(&corpse->thinker);
+  P_UpdateTargetLink(corpse);
 
   return true;
 }
@@ -2004,6 +2111,7 @@ static dboolean P_HealCorpse(mobj_t* actor, int radius, statenum_t healstate, sf
 
           /* killough 8/29/98: add to appropriate thread */
           P_UpdateThinker(&corpsehit->thinker);
+          P_UpdateTargetLink(corpsehit);
 
           return true;
         }
@@ -3618,6 +3726,8 @@ void A_AddFlags(mobj_t* actor)
 
   actor->flags  |= flags;
   actor->flags2 |= flags2;
+
+  P_UpdateTargetLink(actor);
 }
 
 //
@@ -3858,6 +3968,7 @@ dboolean P_UpdateChicken(mobj_t * actor, int tics)
         mo->angle = oldChicken.angle;
         mo->flags = oldChicken.flags;
         mo->health = oldChicken.health;
+        P_UpdateTargetLink(mo);
         P_SetTarget(&mo->target, oldChicken.target);
         mo->special1.i = 5 * 35;  // Next try in 5 seconds
         mo->special2.i = moType;
@@ -5336,6 +5447,7 @@ dboolean P_UpdateMorphedMonster(mobj_t * actor, int tics)
         mo->angle = oldMonster.angle;
         mo->flags = oldMonster.flags;
         mo->health = oldMonster.health;
+        P_UpdateTargetLink(mo);
         P_SetTarget(&mo->target, oldMonster.target);
         mo->special = oldMonster.special;
         mo->special1.i = 5 * 35;  // Next try in 5 seconds
@@ -6833,6 +6945,7 @@ void A_WraithRaiseInit(mobj_t * actor)
     actor->flags2 &= ~MF2_NONSHOOTABLE;
     actor->flags |= MF_SHOOTABLE | MF_SOLID;
     actor->floorclip = actor->info->height;
+    P_UpdateTargetLink(actor);
 }
 
 void A_WraithRaise(mobj_t * actor)
@@ -7195,6 +7308,7 @@ void A_FreezeDeath(mobj_t * actor)
     int r = P_Random(pr_hexen);
     actor->tics = 75 + r + P_Random(pr_hexen);
     actor->flags |= MF_SOLID | MF_SHOOTABLE | MF_NOBLOOD;
+    P_UpdateTargetLink(actor);
     actor->flags2 |= MF2_PUSHABLE | MF2_TELESTOMP | MF2_PASSMOBJ | MF2_SLIDE;
     actor->height <<= 2;
     S_StartMobjSound(actor, hexen_sfx_freeze_death);
@@ -39,6 +39,7 @@
 #include "p_mobj.h"
 
 void P_NoiseAlert (mobj_t *target, mobj_t *emmiter);
+void P_InitSoundFlood(void);
 void P_SpawnBrainTargets(void); /* killough 3/26/98: spawn icon landings */
 dboolean P_CheckBossDeath(mobj_t *mo);
 
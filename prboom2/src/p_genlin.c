@@ -107,7 +107,7 @@ int EV_DoGenFloor
 
     // new floor thinker
     rtn = 1;
-    floor = Z_MallocLevel (sizeof(*floor));
+    floor = Z_MallocPool(ZONE_POOL_FLOOR, sizeof(*floor));
     memset(floor, 0, sizeof(*floor));
     P_AddThinker (&floor->thinker);
     sec->floordata = floor;
@@ -283,7 +283,7 @@ int EV_DoGenCeiling
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_MallocLevel (sizeof(*ceiling));
+    ceiling = Z_MallocPool(ZONE_POOL_CEILING, sizeof(*ceiling));
     memset(ceiling, 0, sizeof(*ceiling));
     P_AddThinker (&ceiling->thinker);
     sec->ceilingdata = ceiling; //jff 2/22/98
@@ -462,7 +462,7 @@ int EV_DoGenLift
 
     // Setup the plat thinker
     rtn = 1;
-    plat = Z_MallocLevel( sizeof(*plat));
+    plat = Z_MallocPool(ZONE_POOL_PLAT, sizeof(*plat));
     memset(plat, 0, sizeof(*plat));
     P_AddThinker(&plat->thinker);
 
@@ -603,7 +603,7 @@ int EV_DoGenStairs
 
     // new floor thinker
     rtn = 1;
-    floor = Z_MallocLevel (sizeof(*floor));
+    floor = Z_MallocPool(ZONE_POOL_FLOOR, sizeof(*floor));
     memset(floor, 0, sizeof(*floor));
     P_AddThinker (&floor->thinker);
     sec->floordata = floor;
@@ -704,7 +704,7 @@ int EV_DoGenStairs
 
         sec = tsec;
         oldsecnum = newsecnum;
-        floor = Z_MallocLevel (sizeof(*floor));
+        floor = Z_MallocPool(ZONE_POOL_FLOOR, sizeof(*floor));
 
         memset(floor, 0, sizeof(*floor));
         P_AddThinker (&floor->thinker);
@@ -769,7 +769,7 @@ int EV_DoGenCrusher
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_MallocLevel (sizeof(*ceiling));
+    ceiling = Z_MallocPool(ZONE_POOL_CEILING, sizeof(*ceiling));
     memset(ceiling, 0, sizeof(*ceiling));
     P_AddThinker (&ceiling->thinker);
     sec->ceilingdata = ceiling; //jff 2/22/98
@@ -850,7 +850,7 @@ int EV_DoGenLockedDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_MallocLevel (sizeof(*door));
+    door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
@@ -939,7 +939,7 @@ int EV_DoGenDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_MallocLevel (sizeof(*door));
+    door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
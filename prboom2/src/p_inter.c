@@ -41,6 +41,7 @@
 #include "sounds.h"
 #include "d_deh.h"  // Ty 03/22/98 - externalized strings
 #include "p_tick.h"
+#include "p_maputl.h"
 #include "lprintf.h"
 
 #include "p_inter.h"
@@ -828,6 +829,9 @@ static void P_KillMobj(mobj_t *source, mobj_t *target)
   target->flags |= MF_CORPSE|MF_DROPOFF;
   target->height >>= 2;
 
+  // corpses can't be targets until they are raised
+  P_UpdateTargetLink(target);
+
   // heretic
   target->flags2 &= ~MF2_PASSMOBJ;
 
@@ -1344,7 +1344,7 @@ dboolean P_CheckPosition (mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockLinesIterator (bx,by,PIT_CheckLine))
+      if (!P_BlockLinesIteratorBox (bx,by,tmbbox,PIT_CheckLine))
         return false; // doesn't fit
 
   return true;
@@ -1802,7 +1802,7 @@ void P_ApplyTorque(mobj_t *mo)
 
   for (bx = xl ; bx <= xh ; bx++)
     for (by = yl ; by <= yh ; by++)
-      P_BlockLinesIterator(bx, by, PIT_ApplyTorque);
+      P_BlockLinesIteratorBox(bx, by, tmbbox, PIT_ApplyTorque);
 
   /* If any momentum, mark object as 'falling' using engine-internal flags */
   if (mo->momx | mo->momy)
@@ -3088,6 +3088,9 @@ dboolean P_ChangeSector(sector_t* sector, int crunch)
   int   x;
   int   y;
 
+  // the sector heights were just changed
+  P_InvalidateSightCache();
+
   nofit = false;
   crushchange = crunch;
 
@@ -3146,6 +3149,9 @@ dboolean P_CheckSector(sector_t* sector, int crunch)
   if (comp[comp_floors]) /* use the old routine for old demos though */
     return P_ChangeSector(sector,crunch);
 
+  // the sector heights were just changed
+  P_InvalidateSightCache();
+
   nofit = false;
   crushchange = crunch;
 
@@ -3180,78 +3186,21 @@ dboolean P_CheckSector(sector_t* sector, int crunch)
 }
 
 
-#define USE_BLOCK_MEMORY_ALLOCATOR
-#ifdef USE_BLOCK_MEMORY_ALLOCATOR
 // CPhipps -
-// Use block memory allocator here
-
-#include "z_bmalloc.h"
-
-IMPLEMENT_BLOCK_MEMORY_ALLOC_ZONE(secnodezone, sizeof(msecnode_t), 256, "SecNodes");
-
-//
-// P_FreeSecNodeList
-//
-void P_FreeSecNodeList(void)
-{
-  DECLARE_BLOCK_MEMORY_ALLOC_ZONE(secnodezone);
-  NULL_BLOCK_MEMORY_ALLOC_ZONE(secnodezone);
-}
+// Sector nodes come from a level pool, which keeps the freelist for us
+// and is emptied along with the rest of the level memory.
 
 msecnode_t* P_GetSecnode(void)
 {
-  return (msecnode_t*)Z_BMalloc(&secnodezone);
+  return (msecnode_t*)Z_MallocPool(ZONE_POOL_SECNODE, sizeof(msecnode_t));
 }
 
 // P_PutSecnode() returns a node to the freelist.
 
 inline static void P_PutSecnode(msecnode_t* node)
 {
-  Z_BFree(&secnodezone, node);
-}
-#else // USE_BLOCK_MEMORY_ALLOCATOR
-// phares 3/21/98
-//
-// Maintain a freelist of msecnode_t's to reduce memory allocs and frees.
-
-msecnode_t *headsecnode = NULL;
-
-//
-// P_FreeSecNodeList
-//
-void P_FreeSecNodeList(void)
-{
-   headsecnode = NULL; // this is all thats needed to fix the bug
-}
-
-//
-// P_GetSecnode
-//
-// Retrieves a node from the freelist. The calling routine should make sure it
-// sets all fields properly.
-//
-// killough 11/98: reformatted
-//
-msecnode_t *P_GetSecnode(void)
-{
-  msecnode_t *node;
-
-  return headsecnode ?
-    node = headsecnode, headsecnode = node->m_snext, node :
-  (msecnode_t *)(Z_MallocLevel(sizeof *node));
-}
-
-//
-// P_PutSecnode
-//
-// Returns a node to the freelist.
-//
-static void P_PutSecnode(msecnode_t *node)
-{
-  node->m_snext = headsecnode;
-  headsecnode = node;
+  Z_Free(node);
 }
-#endif // USE_BLOCK_MEMORY_ALLOCATOR
 
 // phares 3/16/98
 //
@@ -72,6 +72,9 @@ dboolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y,dboolean boss);
 void    P_UnqualifiedMove(mobj_t *thing, fixed_t x, fixed_t y);
 void    P_SlideMove(mobj_t *mo);
 dboolean P_CheckSight(mobj_t *t1, mobj_t *t2);
+void P_StartSightCacheTic(void);
+void P_InvalidateSightCache(void);
+void P_GetSightCacheStats(int *hits, int *lookups);
 dboolean P_CheckFov(mobj_t *t1, mobj_t *t2, angle_t fov);
 void    P_UseLines(player_t *player);
 
@@ -102,7 +105,6 @@ mobj_t *P_FindMobjInSector(mobj_in_sector_t *data);
 dboolean P_ChangeSector(sector_t *sector, int crunch);
 dboolean P_CheckSector(sector_t *sector, int crunch);
 void    P_DelSeclist(msecnode_t*);                          // phares 3/16/98
-void    P_FreeSecNodeList(void);                            // sf
 void    P_CreateSecNodeList(mobj_t*,fixed_t,fixed_t);       // phares 3/14/98
 dboolean Check_Sides(mobj_t *, int, int);                    // phares
 
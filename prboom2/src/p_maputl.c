@@ -34,6 +34,8 @@
  *
  *-----------------------------------------------------------------------------*/
 
+#include <limits.h>
+
 #include "doomstat.h"
 #include "doomtype.h"
 #include "m_bbox.h"
@@ -47,6 +49,15 @@
 #include "e6y.h"//e6y
 
 #include "dsda/map_format.h"
+#include "dsda/profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define P_LINE_BOXES_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define P_LINE_BOXES_NEON
+#include <arm_neon.h>
+#endif
 
 //
 // P_AproxDistance
@@ -305,6 +316,112 @@ void P_LineOpening(const line_t *linedef, const mobj_t *actor)
   line_opening.range = line_opening.top - line_opening.bottom;
 }
 
+//
+// TARGET LINKS
+//
+// Each block also keeps the things that could be picked by a target search,
+// threaded through tnext / tprev in the same relative order as blocklinks.
+// A thing stays linked as long as it might pass the searches' own checks:
+// it is shootable, or it is a monster that isn't a dead corpse. Anything
+// that can turn a thing back into a target calls P_UpdateTargetLink.
+//
+
+static dboolean P_IsPossibleTarget(const mobj_t *thing)
+{
+  return (thing->flags & MF_SHOOTABLE) ||
+         ((thing->flags & MF_COUNTKILL || thing->type == MT_SKULL) &&
+          !(thing->flags & MF_CORPSE && thing->health <= 0));
+}
+
+static void P_LinkTarget(mobj_t *thing, mobj_t **link)
+{
+  mobj_t *tnext = *link;
+
+  if ((thing->tnext = tnext))
+    tnext->tprev = &thing->tnext;
+  thing->tprev = link;
+  *link = thing;
+}
+
+static void P_UnlinkTarget(mobj_t *thing)
+{
+  mobj_t *tnext, **tprev = thing->tprev;
+
+  if (tprev)
+  {
+    if ((*tprev = tnext = thing->tnext))
+      tnext->tprev = tprev;
+    thing->tnext = NULL;
+    thing->tprev = NULL;
+  }
+}
+
+//
+// P_UpdateTargetLink
+// Called when a thing already in the blockmap may have become
+// a possible target (or stopped being one) without moving.
+//
+
+void P_UpdateTargetLink(mobj_t *thing)
+{
+  mobj_t **bprev;
+
+  if (!P_IsPossibleTarget(thing))
+  {
+    P_UnlinkTarget(thing);
+    return;
+  }
+
+  bprev = thing->bprev;
+  if (thing->tprev || !bprev || *bprev != thing)
+    return;
+
+  // Link after the nearest earlier thing in the block that is linked,
+  // or at the head of the block if there is none.
+  while (bprev < blocklinks || bprev >= blocklinks + blocklinks_count)
+  {
+    mobj_t *prev = (mobj_t *)((char *) bprev - offsetof(mobj_t, bnext));
+
+    if (prev->tprev)
+    {
+      P_LinkTarget(thing, &prev->tnext);
+      return;
+    }
+
+    bprev = prev->bprev;
+  }
+
+  P_LinkTarget(thing, &targetlinks[bprev - blocklinks]);
+}
+
+//
+// P_RebuildTargetLinks
+// Recreates the target links from the blocklinks order,
+// after the blocklinks were restored from a save.
+// The things' own links must already be cleared.
+//
+
+void P_RebuildTargetLinks(void)
+{
+  int i;
+
+  for (i = 0; i < blocklinks_count; ++i)
+  {
+    mobj_t *mobj;
+    mobj_t **tprev;
+
+    targetlinks[i] = NULL;
+
+    tprev = &targetlinks[i];
+    for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+      if (P_IsPossibleTarget(mobj))
+      {
+        P_LinkTarget(mobj, tprev);
+        tprev = &mobj->tnext;
+      }
+  }
+}
+
 //
 // THING POSITION SETTING
 //
@@ -366,6 +483,8 @@ void P_UnsetThingPosition (mobj_t *thing)
       mobj_t *bnext, **bprev = thing->bprev;
       if (bprev && (*bprev = bnext = thing->bnext))  // unlink from block map
         bnext->bprev = bprev;
+
+      P_UnlinkTarget(thing);
     }
 }
 
@@ -429,6 +548,9 @@ void P_SetThingPosition(mobj_t *thing)
           bnext->bprev = &thing->bnext;
         thing->bprev = link;
         *link = thing;
+
+        if (P_IsPossibleTarget(thing))
+          P_LinkTarget(thing, &targetlinks[blocky*bmapwidth+blockx]);
       }
       else        // thing is off the map
         thing->bnext = NULL, thing->bprev = NULL;
@@ -602,6 +724,217 @@ dboolean P_BlockLinesIterator2(int x, int y, dboolean func(line_t*))
   return true;  // everything was checked
 }
 
+//
+// Blockmap line boxes
+//
+// The line bounding boxes are copied into arrays that run parallel to
+// blockmaplump, so the boxes of one block's lines sit next to each other.
+// P_BlockLinesIteratorBox tests them four at a time against the caller's box
+// and only calls back for lines that can touch it. Polyobject lines move, so
+// their entries always pass and the callback decides as before.
+//
+
+typedef struct
+{
+  fixed_t *left;
+  fixed_t *right;
+  fixed_t *bottom;
+  fixed_t *top;
+} line_boxes_t;
+
+static line_boxes_t line_boxes;
+
+void P_ClearBlockLineBoxes(void)
+{
+  memset(&line_boxes, 0, sizeof(line_boxes));
+}
+
+void P_InitBlockLineBoxes(void)
+{
+  int i, size;
+  byte *moving;
+
+  size = 0;
+  for (i = 0; i < bmapwidth * bmapheight; ++i)
+  {
+    const int *list = blockmaplump + blockmap[i];
+
+    while (*list != -1)
+      list++;
+
+    size = MAX(size, list - blockmaplump + 1);
+  }
+
+  moving = Z_Calloc(numlines, sizeof(*moving));
+  if (map_format.polyobjs)
+    for (i = 0; i < po_NumPolyobjs; ++i)
+    {
+      int j;
+
+      for (j = 0; j < polyobjs[i].numsegs; ++j)
+        moving[polyobjs[i].segs[j]->linedef->iLineID] = true;
+    }
+
+  // Padded so the last block's group of four can be read in one go
+  line_boxes.left = Z_MallocLevel(4 * (size + 4) * sizeof(fixed_t));
+  line_boxes.right = line_boxes.left + size + 4;
+  line_boxes.bottom = line_boxes.right + size + 4;
+  line_boxes.top = line_boxes.bottom + size + 4;
+
+  for (i = 0; i < size + 4; ++i)
+  {
+    int num = i < size ? blockmaplump[i] : -1;
+
+    if (num < 0 || num >= numlines || moving[num])
+    {
+      line_boxes.left[i] = INT_MIN;
+      line_boxes.right[i] = INT_MAX;
+      line_boxes.bottom[i] = INT_MIN;
+      line_boxes.top[i] = INT_MAX;
+    }
+    else
+    {
+      line_boxes.left[i] = lines[num].bbox[BOXLEFT];
+      line_boxes.right[i] = lines[num].bbox[BOXRIGHT];
+      line_boxes.bottom[i] = lines[num].bbox[BOXBOTTOM];
+      line_boxes.top[i] = lines[num].bbox[BOXTOP];
+    }
+  }
+
+  Z_Free(moving);
+}
+
+// Bit n is set if the box overlaps the box of entry i + n
+static int P_LineBoxMask(const fixed_t *bbox, int i)
+{
+#if defined(P_LINE_BOXES_SSE2)
+  __m128i left = _mm_loadu_si128((const __m128i *) (line_boxes.left + i));
+  __m128i right = _mm_loadu_si128((const __m128i *) (line_boxes.right + i));
+  __m128i bottom = _mm_loadu_si128((const __m128i *) (line_boxes.bottom + i));
+  __m128i top = _mm_loadu_si128((const __m128i *) (line_boxes.top + i));
+  __m128i x = _mm_and_si128(_mm_cmpgt_epi32(_mm_set1_epi32(bbox[BOXRIGHT]), left),
+                            _mm_cmplt_epi32(_mm_set1_epi32(bbox[BOXLEFT]), right));
+  __m128i y = _mm_and_si128(_mm_cmpgt_epi32(_mm_set1_epi32(bbox[BOXTOP]), bottom),
+                            _mm_cmplt_epi32(_mm_set1_epi32(bbox[BOXBOTTOM]), top));
+
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(x, y)));
+#elif defined(P_LINE_BOXES_NEON)
+  static const uint32_t bits[4] = { 1, 2, 4, 8 };
+  uint32x4_t x = vandq_u32(vcgtq_s32(vdupq_n_s32(bbox[BOXRIGHT]), vld1q_s32(line_boxes.left + i)),
+                           vcltq_s32(vdupq_n_s32(bbox[BOXLEFT]), vld1q_s32(line_boxes.right + i)));
+  uint32x4_t y = vandq_u32(vcgtq_s32(vdupq_n_s32(bbox[BOXTOP]), vld1q_s32(line_boxes.bottom + i)),
+                           vcltq_s32(vdupq_n_s32(bbox[BOXBOTTOM]), vld1q_s32(line_boxes.top + i)));
+
+  return vaddvq_u32(vandq_u32(vandq_u32(x, y), vld1q_u32(bits)));
+#else
+  int n, mask = 0;
+
+  for (n = 0; n < 4; ++n)
+    if (bbox[BOXRIGHT] > line_boxes.left[i + n] &&
+        bbox[BOXLEFT] < line_boxes.right[i + n] &&
+        bbox[BOXTOP] > line_boxes.bottom[i + n] &&
+        bbox[BOXBOTTOM] < line_boxes.top[i + n])
+      mask |= 1 << n;
+
+  return mask;
+#endif
+}
+
+//
+// P_BlockLinesIteratorBox
+// Same as P_BlockLinesIterator, but lines whose bounding box doesn't
+// overlap bbox are marked as checked without calling func.
+// Only for callbacks that return true right away for such lines.
+//
+
+dboolean P_BlockLinesIteratorBox(int x, int y, const fixed_t *bbox, dboolean func(line_t*))
+{
+  int        offset;
+  const int  *list;
+  int        mask, pending;
+
+  if (!line_boxes.left)
+    return P_BlockLinesIterator(x, y, func);
+
+  if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+    return true;
+  offset = y*bmapwidth+x;
+
+  if (map_format.polyobjs)
+  {
+    int i;
+    seg_t **tempSeg;
+    polyblock_t *polyLink;
+    extern polyblock_t **PolyBlockMap;
+
+    polyLink = PolyBlockMap[offset];
+    while (polyLink)
+    {
+      if (polyLink->polyobj)
+      {
+        if (polyLink->polyobj->validcount != validcount)
+        {
+          polyLink->polyobj->validcount = validcount;
+          tempSeg = polyLink->polyobj->segs;
+          for (i = 0; i < polyLink->polyobj->numsegs; i++, tempSeg++)
+          {
+            if ((*tempSeg)->linedef->validcount == validcount)
+            {
+              continue;
+            }
+            (*tempSeg)->linedef->validcount = validcount;
+            if (!func((*tempSeg)->linedef))
+            {
+              return false;
+            }
+          }
+        }
+      }
+      polyLink = polyLink->next;
+    }
+  }
+
+  offset = *(blockmap+offset);
+  list = blockmaplump+offset;
+
+  // same start as P_BlockLinesIterator
+  if ((!demo_compatibility && !mbf21) || (mbf21 && skipblstart))
+    list++;
+
+  mask = pending = 0;
+  for ( ; *list != -1 ; list++)
+    {
+      line_t *ld;
+      dboolean touch;
+
+      if (!pending)
+      {
+        mask = P_LineBoxMask(bbox, list - blockmaplump);
+        pending = 4;
+      }
+      touch = mask & 1;
+      mask >>= 1;
+      pending--;
+
+#ifdef RANGECHECK
+      if(*list < 0 || *list >= numlines)
+        I_Error("P_BlockLinesIteratorBox: index >= numlines");
+#endif
+      ld = &lines[*list];
+      if (ld->validcount == validcount)
+        continue;       // line has already been checked
+      ld->validcount = validcount;
+      if (!touch)
+        continue;
+      if (!func(ld))
+        return false;
+
+      // func may have moved the box (e.g. a nested P_CheckPosition)
+      pending = 0;
+    }
+  return true;  // everything was checked
+}
+
 //
 // P_BlockThingsIterator
 //
@@ -617,6 +950,21 @@ dboolean P_BlockThingsIterator(int x, int y, dboolean func(mobj_t*))
   return true;
 }
 
+//
+// P_BlockTargetsIterator
+// Like P_BlockThingsIterator, but skips things that can't be targets
+//
+
+dboolean P_BlockTargetsIterator(int x, int y, dboolean func(mobj_t*))
+{
+  mobj_t *mobj;
+  if (!(x<0 || y<0 || x>=bmapwidth || y>=bmapheight))
+    for (mobj = targetlinks[y*bmapwidth+x]; mobj; mobj = mobj->tnext)
+      if (!func(mobj))
+        return false;
+  return true;
+}
+
 //
 // INTERCEPT ROUTINES
 //
@@ -782,8 +1130,8 @@ dboolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
 //
 // killough 5/3/98: reformatted, cleaned up
 
-dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
-                       int flags, dboolean trav(intercept_t *))
+static dboolean P_TraversePath(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                               int flags, dboolean trav(intercept_t *))
 {
   fixed_t xt1, yt1;
   fixed_t xt2, yt2;
@@ -928,6 +1276,18 @@ dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   return P_TraverseIntercepts(trav, FRACUNIT);
 }
 
+dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                       int flags, dboolean trav(intercept_t *))
+{
+  dboolean result;
+
+  DSDA_PROFILE_BEGIN(dsda_profile_path_traverse);
+  result = P_TraversePath(x1, y1, x2, y2, flags, trav);
+  DSDA_PROFILE_END(dsda_profile_path_traverse);
+
+  return result;
+}
+
 //
 // RoughBlockCheck
 // [XA] adapted from Hexen -- used by P_RoughTargetSearch
@@ -941,27 +1301,27 @@ static mobj_t *RoughBlockCheck(mobj_t *mo, int index, angle_t fov)
 
   if (hexen) return Hexen_RoughBlockCheck(mo, index);
 
-  link = blocklinks[index];
+  link = targetlinks[index];
   while (link)
   {
     // skip non-shootable actors
     if (!(link->flags & MF_SHOOTABLE))
     {
-      link = link->bnext;
+      link = link->tnext;
       continue;
     }
 
     // skip dormant actors
     if (link->flags2 & MF2_DORMANT)
     {
-        link = link->bnext;
+        link = link->tnext;
         continue;
     }
 
     // skip the projectile's owner
     if (link == mo->target)
     {
-      link = link->bnext;
+      link = link->tnext;
       continue;
     }
 
@@ -971,21 +1331,21 @@ static mobj_t *RoughBlockCheck(mobj_t *mo, int index, angle_t fov)
       mo->target->target != link &&
       !(deathmatch && link->player && mo->target->player))
     {
-      link = link->bnext;
+      link = link->tnext;
       continue;
     }
 
     // skip actors outside of specified FOV
     if (fov > 0 && !P_CheckFov(mo, link, fov))
     {
-      link = link->bnext;
+      link = link->tnext;
       continue;
     }
 
     // skip actors not in line of sight
     if (!P_CheckSight(mo, link))
     {
-      link = link->bnext;
+      link = link->tnext;
       continue;
     }
 
@@ -1190,7 +1550,7 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
     mobj_t *master;
     angle_t angle;
 
-    link = blocklinks[index];
+    link = targetlinks[index];
     while (link)
     {
         if (mo->player)         // Minotaur looking around player
@@ -1200,23 +1560,23 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
             {
                 if (!(link->flags & MF_SHOOTABLE))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (link->flags2 & MF2_DORMANT)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if ((link->type == HEXEN_MT_MINOTAUR) &&
                     (link->special1.m == mo))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (netgame && !deathmatch && link->player)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (P_CheckSight(mo, link))
@@ -1224,7 +1584,7 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
                     return link;
                 }
             }
-            link = link->bnext;
+            link = link->tnext;
         }
         else if (mo->type == HEXEN_MT_MINOTAUR)       // looking around minotaur
         {
@@ -1234,23 +1594,23 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
             {
                 if (!(link->flags & MF_SHOOTABLE))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (link->flags2 & MF2_DORMANT)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if ((link->type == HEXEN_MT_MINOTAUR) &&
                     (link->special1.m == mo->special1.m))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (netgame && !deathmatch && link->player)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (P_CheckSight(mo, link))
@@ -1258,7 +1618,7 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
                     return link;
                 }
             }
-            link = link->bnext;
+            link = link->tnext;
         }
         else if (mo->type == HEXEN_MT_MSTAFF_FX2)     // bloodscourge
         {
@@ -1268,12 +1628,12 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
             {
                 if (!(link->flags & MF_SHOOTABLE))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (netgame && !deathmatch && link->player)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 else if (P_CheckSight(mo, link))
@@ -1288,7 +1648,7 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
                     }
                 }
             }
-            link = link->bnext;
+            link = link->tnext;
         }
         else                    // spirits
         {
@@ -1298,17 +1658,17 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
             {
                 if (!(link->flags & MF_SHOOTABLE))
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (netgame && !deathmatch && link->player)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 if (link == mo->target)
                 {
-                    link = link->bnext;
+                    link = link->tnext;
                     continue;
                 }
                 else if (P_CheckSight(mo, link))
@@ -1316,7 +1676,7 @@ static mobj_t *Hexen_RoughBlockCheck(mobj_t * mo, int index)
                     return link;
                 }
             }
-            link = link->bnext;
+            link = link->tnext;
         }
     }
     return NULL;
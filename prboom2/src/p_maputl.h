@@ -102,7 +102,13 @@ void    P_UnsetThingPosition(mobj_t *thing);
 void    P_SetThingPosition(mobj_t *thing);
 dboolean P_BlockLinesIterator (int x, int y, dboolean func(line_t *));
 dboolean P_BlockLinesIterator2(int x, int y, dboolean func(line_t *));
+dboolean P_BlockLinesIteratorBox(int x, int y, const fixed_t *bbox, dboolean func(line_t *));
+void    P_ClearBlockLineBoxes(void);
+void    P_InitBlockLineBoxes(void);
 dboolean P_BlockThingsIterator(int x, int y, dboolean func(mobj_t *));
+dboolean P_BlockTargetsIterator(int x, int y, dboolean func(mobj_t *));
+void    P_UpdateTargetLink(mobj_t *thing);
+void    P_RebuildTargetLinks(void);
 dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
                        int flags, dboolean trav(intercept_t *));
 
@@ -1697,7 +1697,7 @@ mobj_t* P_SpawnMobj(fixed_t x,fixed_t y,fixed_t z,mobjtype_t type)
   state_t*    st;
   mobjinfo_t* info;
 
-  mobj = Z_MallocLevel (sizeof(*mobj));
+  mobj = Z_MallocPool(ZONE_POOL_MOBJ, sizeof(*mobj));
   memset (mobj, 0, sizeof (*mobj));
   info = &mobjinfo[type];
   mobj->type = type;
@@ -2694,6 +2694,9 @@ spawnit:
     dsda_SpawnAmbientSource(mobj);
   }
 
+  // the spawn health and flags may have been changed above
+  P_UpdateTargetLink(mobj);
+
   return mobj;
 }
 
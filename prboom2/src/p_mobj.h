@@ -298,6 +298,10 @@ typedef struct mobj_s
     struct mobj_s*      bnext;
     struct mobj_s**     bprev; // killough 8/11/98: change to ptr-to-ptr
 
+    // Links among the possible targets in the same block.
+    struct mobj_s*      tnext;
+    struct mobj_s**     tprev;
+
     struct subsector_s* subsector;
 
     // The closest interval over all contacted Sectors.
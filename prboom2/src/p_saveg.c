@@ -606,6 +606,9 @@ void P_UnArchiveBlockLinks(mobj_t** mobj_p, int mobj_count)
 
   size = bmapwidth * bmapheight;
 
+  for (i = 1; i <= mobj_count; ++i)
+    mobj_p[i]->tnext = NULL, mobj_p[i]->tprev = NULL;
+
   for (i = 0; i < size; ++i)
   {
     int j;
@@ -636,6 +639,8 @@ void P_UnArchiveBlockLinks(mobj_t** mobj_p, int mobj_count)
       }
     }
   }
+
+  P_RebuildTargetLinks();
 }
 
 static dboolean P_IsPolyObjThinker(thinker_t *th)
@@ -1238,7 +1243,7 @@ void P_UnArchiveThinkers(void) {
     switch (tc) {
       case tc_ceiling:
         {
-          ceiling_t *ceiling = Z_MallocLevel (sizeof(*ceiling));
+          ceiling_t *ceiling = Z_MallocPool(ZONE_POOL_CEILING, sizeof(*ceiling));
           P_LOAD_P(ceiling);
           ceiling->sector = &sectors[(size_t)ceiling->sector];
           ceiling->sector->ceilingdata = ceiling; //jff 2/22/98
@@ -1253,7 +1258,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_door:
         {
-          vldoor_t *door = Z_MallocLevel (sizeof(*door));
+          vldoor_t *door = Z_MallocPool(ZONE_POOL_DOOR, sizeof(*door));
           P_LOAD_P(door);
           door->sector = &sectors[(size_t)door->sector];
 
@@ -1268,7 +1273,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_floor:
         {
-          floormove_t *floor = Z_MallocLevel (sizeof(*floor));
+          floormove_t *floor = Z_MallocPool(ZONE_POOL_FLOOR, sizeof(*floor));
           P_LOAD_P(floor);
           floor->sector = &sectors[(size_t)floor->sector];
           floor->sector->floordata = floor; //jff 2/22/98
@@ -1279,7 +1284,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_plat:
         {
-          plat_t *plat = Z_MallocLevel (sizeof(*plat));
+          plat_t *plat = Z_MallocPool(ZONE_POOL_PLAT, sizeof(*plat));
           P_LOAD_P(plat);
           plat->sector = &sectors[(size_t)plat->sector];
           plat->sector->floordata = plat; //jff 2/22/98
@@ -1600,7 +1605,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_mobj:
         {
-          mobj_t *mobj = Z_MallocLevel(sizeof(mobj_t));
+          mobj_t *mobj = Z_MallocPool(ZONE_POOL_MOBJ, sizeof(mobj_t));
 
           // killough 2/14/98 -- insert pointers to thinkers into table, in order:
           mobj_count++;
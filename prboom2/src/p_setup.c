@@ -63,13 +63,18 @@
 #include "dsda/compatibility.h"
 #include "dsda/destructible.h"
 #include "dsda/id_list.h"
+#include "dsda/level_cache.h"
 #include "dsda/line_special.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
+#include "dsda/node_builder.h"
 #include "dsda/preferences.h"
+#include "dsda/reject.h"
 #include "dsda/scroll.h"
 #include "dsda/settings.h"
 #include "dsda/skip.h"
+#include "dsda/thread_pool.h"
+#include "dsda/time.h"
 #include "dsda/tranmap.h"
 #include "dsda/udmf.h"
 #include "dsda/utility.h"
@@ -124,6 +129,7 @@ typedef enum {
   ZDOOM_ZGL2_NODES,
   ZDOOM_XGL3_NODES,
   ZDOOM_ZGL3_NODES,
+  BUILT_GL_NODES,
 } nodes_version_t;
 
 int firstglvertex = 0;
@@ -165,6 +171,7 @@ int       *blockmaplump;          // was short -- killough
 fixed_t   bmaporgx, bmaporgy;     // origin of block map
 
 mobj_t    **blocklinks;           // for thing chains
+mobj_t    **targetlinks;          // possible targets, in blocklinks order
 int       blocklinks_count;
 
 // MAES: extensions to support 512x512 blockmaps.
@@ -267,10 +274,12 @@ static dboolean CheckForIdentifier(int lumpnum, const byte *id, size_t length)
 
   if (W_SafeLumpLength(lumpnum) >= length)
   {
-    const char *data = W_LumpByNum(lumpnum);
+    const char *data = W_BorrowLumpNum(lumpnum);
 
     if (!memcmp(data, id, length))
       result = true;
+
+    W_ReturnLumpNum(lumpnum);
   }
 
   return result;
@@ -340,6 +349,18 @@ static void P_GetNodesVersion(void)
       nodesVersion = DEEP_BSP_V4_NODES;
       lprintf(LO_DEBUG,"P_GetNodesVersion: using v4 DeePBSP nodes\n");
     }
+    // A trivial map has no nodes and a single subsector (see P_LoadNodes)
+    else if (udmf_map ||
+             !W_SafeLumpLength(level_components.segs) ||
+             !W_SafeLumpLength(level_components.ssectors) ||
+             (
+               W_SafeLumpLength(level_components.nodes) < (int) sizeof(mapnode_t) &&
+               W_SafeLumpLength(level_components.ssectors) / (int) sizeof(mapsubsector_t) != 1
+             ))
+    {
+      nodesVersion = BUILT_GL_NODES;
+      lprintf(LO_DEBUG,"P_GetNodesVersion: no usable nodes, using internal node builder\n");
+    }
     else
     {
       lprintf(LO_DEBUG,"P_GetNodesVersion: using normal BSP nodes\n");
@@ -378,7 +399,7 @@ static void P_LoadVertexes(int lump)
 
   // Load data into cache.
   // cph 2006/07/29 - cast to mapvertex_t here, making the loop below much neater
-  ml = (const mapvertex_t*) W_LumpByNum(lump);
+  ml = (const mapvertex_t*) W_BorrowLumpNum(lump);
 
   // Copy and convert vertex coordinates,
   // internal representation as fixed.
@@ -388,6 +409,8 @@ static void P_LoadVertexes(int lump)
     vertexes[i].y = LittleShort(ml->y)<<FRACBITS;
     ml++;
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadUDMFVertexes(int lump)
@@ -399,8 +422,8 @@ static void P_LoadUDMFVertexes(int lump)
 
   for (i = 0; i < numvertexes; ++i)
   {
-    vertexes[i].x = dsda_StringToFixed(udmf.vertices[i].x);
-    vertexes[i].y = dsda_StringToFixed(udmf.vertices[i].y);
+    vertexes[i].x = udmf.vertices[i].x;
+    vertexes[i].y = udmf.vertices[i].y;
   }
 }
 
@@ -449,7 +472,7 @@ static void P_LoadSegs (int lump)
 
   numsegs = W_LumpLength(lump) / sizeof(mapseg_t);
   segs = calloc_IfSameLevel(segs, numsegs, sizeof(seg_t));
-  data = (const mapseg_t *)W_LumpByNum(lump); // cph - wad lump handling updated
+  data = (const mapseg_t *)W_BorrowLumpNum(lump); // cph - wad lump handling updated
 
   if ((!data) || (!numsegs))
     I_Error("P_LoadSegs: no segs in level");
@@ -578,6 +601,8 @@ static void P_LoadSegs (int lump)
       // of DV.wad, map 5
       li->offset = GetOffset(li->v1, (ml->side ? ldef->v2 : ldef->v1));
     }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadSegs_V4(int lump)
@@ -587,7 +612,7 @@ static void P_LoadSegs_V4(int lump)
 
   numsegs = W_LumpLength(lump) / sizeof(mapseg_v4_t);
   segs = calloc_IfSameLevel(segs, numsegs, sizeof(seg_t));
-  data = (const mapseg_v4_t *)W_LumpByNum(lump);
+  data = (const mapseg_v4_t *)W_BorrowLumpNum(lump);
 
   if ((!data) || (!numsegs))
     I_Error("P_LoadSegs_V4: no segs in level");
@@ -696,6 +721,8 @@ static void P_LoadSegs_V4(int lump)
     // of DV.wad, map 5
     li->offset = GetOffset(li->v1, (ml->side ? ldef->v2 : ldef->v1));
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 //
@@ -711,7 +738,7 @@ static void P_LoadSubsectors (int lump)
 
   numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
   subsectors = calloc_IfSameLevel(subsectors, numsubsectors, sizeof(subsector_t));
-  data = (const mapsubsector_t *)W_LumpByNum(lump);
+  data = (const mapsubsector_t *)W_BorrowLumpNum(lump);
 
   if ((!data) || (!numsubsectors))
     I_Error("P_LoadSubsectors: no subsectors in level");
@@ -722,6 +749,8 @@ static void P_LoadSubsectors (int lump)
     subsectors[i].numlines  = (unsigned short)LittleShort(data[i].numsegs );
     subsectors[i].firstline = (unsigned short)LittleShort(data[i].firstseg);
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadSubsectors_V4(int lump)
@@ -732,7 +761,7 @@ static void P_LoadSubsectors_V4(int lump)
 
   numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_v4_t);
   subsectors = calloc_IfSameLevel(subsectors, numsubsectors, sizeof(subsector_t));
-  data = (const mapsubsector_v4_t *)W_LumpByNum(lump);
+  data = (const mapsubsector_v4_t *)W_BorrowLumpNum(lump);
 
   if ((!data) || (!numsubsectors))
     I_Error("P_LoadSubsectors_V4: no subsectors in level");
@@ -743,6 +772,8 @@ static void P_LoadSubsectors_V4(int lump)
     subsectors[i].numlines = (unsigned short)LittleShort(data[i].numsegs);
     subsectors[i].firstline = LittleLong(data[i].firstseg);
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 //
@@ -802,7 +833,7 @@ static void P_LoadSectors (int lump)
 
   numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
   sectors = calloc_IfSameLevel(sectors, numsectors, sizeof(sector_t));
-  data = W_LumpByNum (lump); // cph - wad lump handling updated
+  data = W_BorrowLumpNum(lump); // cph - wad lump handling updated
 
   dsda_ResetSectorIDList(numsectors);
 
@@ -824,6 +855,8 @@ static void P_LoadSectors (int lump)
 
     dsda_AddSectorID(ss->tag, i);
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadUDMFSectors(int lump)
@@ -862,16 +895,16 @@ static void P_LoadUDMFSectors(int lump)
     ss->ceiling_rotation = dsda_DegreesToAngle(ms->rotationceiling);
     ss->ceiling_xscale = dsda_FloatToFixed(ms->xscaleceiling);
     ss->ceiling_yscale = dsda_FloatToFixed(ms->yscaleceiling);
-    ss->gravity = dsda_StringToFixed(ms->gravity);
+    ss->gravity = ms->gravity;
 
-    if (ms->frictionfactor)
+    if (ms->has_frictionfactor)
     {
-      P_ResolveFrictionFactor(dsda_StringToFixed(ms->frictionfactor), ss);
+      P_ResolveFrictionFactor(ms->frictionfactor, ss);
     }
 
-    if (ms->movefactor)
+    if (ms->has_movefactor)
     {
-      ss->movefactor = dsda_StringToFixed(ms->movefactor);
+      ss->movefactor = ms->movefactor;
       ss->flags |= SECF_FRICTION;
     }
 
@@ -967,7 +1000,7 @@ static void P_LoadNodes (int lump)
 
   numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
   nodes = malloc_IfSameLevel(nodes, numnodes * sizeof(node_t));
-  data = W_LumpByNum (lump); // cph - wad lump handling updated
+  data = W_BorrowLumpNum(lump); // cph - wad lump handling updated
 
   if ((!data) || (!numnodes))
   {
@@ -1020,6 +1053,8 @@ static void P_LoadNodes (int lump)
             no->bbox[j][k] = LittleShort(mn->bbox[j][k])<<FRACBITS;
         }
     }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadNodes_V4(int lump)
@@ -1029,7 +1064,7 @@ static void P_LoadNodes_V4(int lump)
 
   numnodes = (W_LumpLength (lump) - 8) / sizeof(mapnode_v4_t);
   nodes = malloc_IfSameLevel(nodes, numnodes * sizeof(node_t));
-  data = W_LumpByNum (lump); // cph - wad lump handling updated
+  data = W_BorrowLumpNum(lump); // cph - wad lump handling updated
 
   // skip header
   data = data + 8;
@@ -1064,6 +1099,8 @@ static void P_LoadNodes_V4(int lump)
             no->bbox[j][k] = LittleShort(mn->bbox[j][k])<<FRACBITS;
         }
     }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void CheckZNodesOverflow(int *size, int count)
@@ -1324,12 +1361,10 @@ static void P_LoadGLZSegs(const byte *data, int type)
 
 // MB 2020-03-01: Fix endianess for 32-bit ZDoom nodes
 // https://zdoom.org/wiki/Node#ZDoom_extended_nodes
-static void P_LoadZNodes(int lump, int glnodes)
+static void P_LoadZNodesData(const byte *data, int len, int glnodes)
 {
-  const byte *data;
   size_t node_size;
   unsigned int i;
-  int len;
 
   unsigned int orgVerts, newVerts;
   unsigned int numSubs, currSeg;
@@ -1338,9 +1373,6 @@ static void P_LoadZNodes(int lump, int glnodes)
   vertex_t *newvertarray = NULL;
   byte *output = NULL;
 
-  data = W_LumpByNum(lump);
-  len =  W_LumpLength(lump);
-
   // skip header
   CheckZNodesOverflow(&len, 4);
   data += 4;
@@ -1527,6 +1559,44 @@ static void P_LoadZNodes(int lump, int glnodes)
     Z_Free(output);
 }
 
+static void P_LoadZNodes(int lump, int glnodes)
+{
+  P_LoadZNodesData(W_BorrowLumpNum(lump), W_LumpLength(lump), glnodes);
+  W_ReturnLumpNum(lump);
+}
+
+//
+// P_BuildNodes
+//
+// Maps without usable nodes get GL nodes from the internal builder,
+// cached by the lumps that describe the geometry
+//
+
+static void P_BuildNodes(void)
+{
+  byte *data;
+  int len;
+  int lumps[3];
+  int lump_count;
+
+  if (udmf_map)
+  {
+    lumps[0] = level_components.label + ML_TEXTMAP;
+    lump_count = 1;
+  }
+  else
+  {
+    lumps[0] = level_components.vertexes;
+    lumps[1] = level_components.linedefs;
+    lumps[2] = level_components.sidedefs;
+    lump_count = 3;
+  }
+
+  data = dsda_BuildNodes(lumps, lump_count, &len);
+  P_LoadZNodesData(data, len, 3);
+  Z_Free(data);
+}
+
 static int no_overlapped_sprites;
 #define GETXY(mobj) ((mobj)->x + ((mobj)->y >> 16))
 static int C_DECL dicmp_sprite_by_pos(const void *a, const void *b)
@@ -1628,7 +1698,7 @@ static void P_LoadThings(int lump)
   const doom_mapthing_t *doom_data;
 
   numthings = W_LumpLength (lump) / map_format.mapthing_size;
-  data = W_LumpByNum(lump);
+  data = W_BorrowLumpNum(lump);
   hexen_data = (const hexen_mapthing_t*) data;
   doom_data = (const doom_mapthing_t*) data;
   mobjcount = 0;
@@ -1697,6 +1767,8 @@ static void P_LoadThings(int lump)
   }
 
   P_PostProcessThings(mobjcount, mobjlist);
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadUDMFThings(int lump)
@@ -1715,9 +1787,9 @@ static void P_LoadUDMFThings(int lump)
     const udmf_thing_t *dmt = &udmf.things[i];
 
     mt.tid = dmt->id;
-    mt.x = dsda_StringToFixed(dmt->x);
-    mt.y = dsda_StringToFixed(dmt->y);
-    mt.height = dsda_StringToFixed(dmt->height);
+    mt.x = dmt->x;
+    mt.y = dmt->y;
+    mt.height = dmt->height;
     mt.angle = dmt->angle;
     mt.type = dmt->type;
     mt.options = 0;
@@ -1727,8 +1799,8 @@ static void P_LoadUDMFThings(int lump)
     mt.special_args[2] = dmt->arg2;
     mt.special_args[3] = dmt->arg3;
     mt.special_args[4] = dmt->arg4;
-    mt.gravity = dsda_StringToFixed(dmt->gravity);
-    mt.health = dsda_StringToFixed(dmt->health);
+    mt.gravity = dmt->gravity;
+    mt.health = dmt->health;
     mt.alpha = dmt->alpha;
 
     if (mt.special == zl_sector_set_colormap || mt.special == zl_map_set_colormap)
@@ -2029,7 +2101,7 @@ static void P_LoadLineDefs (int lump)
 
   numlines = W_LumpLength (lump) / map_format.maplinedef_size;
   lines = calloc_IfSameLevel(lines, numlines, sizeof(line_t));
-  data = W_LumpByNum (lump); // cph - wad lump handling updated
+  data = W_BorrowLumpNum(lump); // cph - wad lump handling updated
 
   dsda_ResetLineIDList(numlines);
 
@@ -2082,6 +2154,8 @@ static void P_LoadLineDefs (int lump)
 
     dsda_AddLineID(ld->tag, i);
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadUDMFLineDefs(int lump)
@@ -2449,7 +2523,7 @@ void P_PostProcessZDoomSidedefSpecial(side_t *sd, const mapsidedef_t *msd, secto
 
 static void P_LoadSideDefs(int lump)
 {
-  const byte *data = W_LumpByNum(lump); // cph - const*, wad lump handling updated
+  const byte *data = W_BorrowLumpNum(lump); // cph - const*, wad lump handling updated
   int  i;
 
   for (i=0; i<numsides; i++)
@@ -2479,6 +2553,8 @@ static void P_LoadSideDefs(int lump)
 
     map_format.post_process_sidedef_special(sd, msd, sec, i);
   }
+
+  W_ReturnLumpNum(lump);
 }
 
 static void P_LoadUDMFSideDefs(int lump)
@@ -2562,34 +2638,78 @@ static void P_LoadUDMFSideDefs(int lump)
 typedef struct linelist_t        // type used to list lines in each block
 {
   long num;
-  struct linelist_t *next;
+  int next;                      // index of the next entry, -1 ends the list
 } linelist_t;
 
+//
+// The blockmap is built on a worker thread from a copy of the line
+// coordinates, so it can't use the zone allocator or the level arrays.
+// List entries come from one growing pool instead of separate blocks.
+//
+
+typedef struct
+{
+  // inputs
+  fixed_t *vertexes;             // x, y for each vertex
+  int numvertexes;
+  fixed_t *lines;                // x1, y1, x2, y2 for each linedef
+  int numlines;
+
+  // outputs
+  int *blockmaplump;             // malloc'd, NULL if out of memory
+  int count;
+  unsigned long long build_time;
+
+  linelist_t *pool;
+  int pool_count;
+  int pool_size;
+  dboolean failed;
+} blockmap_job_t;
+
 //
 // Subroutine to add a line number to a block list
 // It simply returns if the line is already in the block
 //
+// Blocks are marked done with a stamp per linedef, so the marks
+// don't need clearing between lines
+//
 
 static void AddBlockLine
 (
-  linelist_t **lists,
+  blockmap_job_t *job,
+  int *lists,
   int *count,
   int *done,
   int blockno,
-  long lineno
+  long lineno,
+  int stamp
 )
 {
   linelist_t *l;
 
-  if (done[blockno])
+  if (done[blockno] == stamp)
     return;
 
-  l = Z_Malloc(sizeof(linelist_t));
+  if (job->pool_count == job->pool_size)
+  {
+    linelist_t *pool;
+
+    job->pool_size = job->pool_size ? job->pool_size * 2 : 4096;
+    pool = realloc(job->pool, job->pool_size * sizeof(*pool));
+    if (!pool)
+    {
+      job->failed = true;
+      return;
+    }
+    job->pool = pool;
+  }
+
+  l = &job->pool[job->pool_count];
   l->num = lineno;
   l->next = lists[blockno];
-  lists[blockno] = l;
+  lists[blockno] = job->pool_count++;
   count[blockno]++;
-  done[blockno] = 1;
+  done[blockno] = stamp;
 }
 
 blockmap_t original_blockmap;
@@ -2618,11 +2738,11 @@ void P_RestoreOriginalBlockMap(void)
 // adds the line to all block lists touching the intersection.
 //
 
-static void P_CreateBlockMap(void)
+static void P_CreateBlockMap(blockmap_job_t *job)
 {
   int xorg,yorg;                 // blockmap origin (lower left)
   int nrows,ncols;               // blockmap dimensions
-  linelist_t **blocklists=NULL;  // array of pointers to lists of lines
+  int *blocklists=NULL;          // array of pool indexes of lists of lines
   int *blockcount=NULL;          // array of counters of line lists
   int *blockdone=NULL;           // array keeping track of blocks/line
   int NBlocks;                   // number of cells = nrows*ncols
@@ -2637,21 +2757,21 @@ static void P_CreateBlockMap(void)
 
   // This fixes MBF's code, which has a bug where maxx/maxy
   // are wrong if the 0th node has the largest x or y
-  if (numvertexes)
+  if (job->numvertexes)
   {
-    map_minx = map_maxx = vertexes[0].x;
-    map_miny = map_maxy = vertexes[0].y;
+    map_minx = map_maxx = job->vertexes[0];
+    map_miny = map_maxy = job->vertexes[1];
   }
 
-  for (i=0;i<numvertexes;i++)
+  for (i=0;i<job->numvertexes;i++)
   {
     fixed_t t;
 
-    if ((t=vertexes[i].x) < map_minx)
+    if ((t=job->vertexes[2*i]) < map_minx)
       map_minx = t;
     else if (t > map_maxx)
       map_maxx = t;
-    if ((t=vertexes[i].y) < map_miny)
+    if ((t=job->vertexes[2*i+1]) < map_miny)
       map_miny = t;
     else if (t > map_maxy)
       map_maxy = t;
@@ -2674,30 +2794,30 @@ static void P_CreateBlockMap(void)
   // finally make an array in which we can mark blocks done per line
 
   // CPhipps - calloc's
-  blocklists = Z_Calloc(NBlocks,sizeof(linelist_t *));
-  blockcount = Z_Calloc(NBlocks,sizeof(int));
-  blockdone = Z_Malloc(NBlocks*sizeof(int));
+  blocklists = malloc(NBlocks*sizeof(*blocklists));
+  blockcount = calloc(NBlocks,sizeof(int));
+  blockdone = calloc(NBlocks,sizeof(int));
+  if (NBlocks > 0 && (!blocklists || !blockcount || !blockdone))
+    job->failed = true;
 
   // initialize each blocklist, and enter the trailing -1 in all blocklists
   // note the linked list of lines grows backwards
 
-  for (i=0;i<NBlocks;i++)
+  for (i=0;!job->failed && i<NBlocks;i++)
   {
-    blocklists[i] = Z_Malloc(sizeof(linelist_t));
-    blocklists[i]->num = -1;
-    blocklists[i]->next = NULL;
-    blockcount[i]++;
+    blocklists[i] = -1;
+    AddBlockLine(job,blocklists,blockcount,blockdone,i,-1,-1);
   }
 
   // For each linedef in the wad, determine all blockmap blocks it touches,
   // and add the linedef number to the blocklists for those blocks
 
-  for (i=0;i<numlines;i++)
+  for (i=0;!job->failed && i<job->numlines;i++)
   {
-    int x1 = lines[i].v1->x>>FRACBITS;         // lines[i] map coords
-    int y1 = lines[i].v1->y>>FRACBITS;
-    int x2 = lines[i].v2->x>>FRACBITS;
-    int y2 = lines[i].v2->y>>FRACBITS;
+    int x1 = job->lines[4*i]>>FRACBITS;        // lines[i] map coords
+    int y1 = job->lines[4*i+1]>>FRACBITS;
+    int x2 = job->lines[4*i+2]>>FRACBITS;
+    int y2 = job->lines[4*i+3]>>FRACBITS;
     int dx = x2-x1;
     int dy = y2-y1;
     int vert = !dx;                            // lines[i] slopetype
@@ -2710,18 +2830,16 @@ static void P_CreateBlockMap(void)
     int miny = y1>y2? y2 : y1;
     int maxy = y1>y2? y1 : y2;
 
-    // no blocks done for this linedef yet
-
-    memset(blockdone,0,NBlocks*sizeof(int));
+    // no blocks done for this linedef yet, since it has its own stamp
 
     // The line always belongs to the blocks containing its endpoints
 
     bx = (x1-xorg)>>blkshift;
     by = (y1-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(job,blocklists,blockcount,blockdone,by*ncols+bx,i,i+1);
     bx = (x2-xorg)>>blkshift;
     by = (y2-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(job,blocklists,blockcount,blockdone,by*ncols+bx,i,i+1);
 
 
     // For each column, see where the line along its left edge, which
@@ -2749,7 +2867,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j,i);
+        AddBlockLine(job,blocklists,blockcount,blockdone,ncols*yb+j,i,i+1);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -2760,23 +2878,23 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (yb>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(yb-1)+j,i,i+1);
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*yb+j-1,i,i+1);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (yb>0 && j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i,i+1);
           }
           else if (horiz) //   - - block x-,y
           {
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*yb+j-1,i,i+1);
           }
         }
         else if (j>0 && minx<x) // else not at corner: x-,y
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+          AddBlockLine(job,blocklists,blockcount,blockdone,ncols*yb+j-1,i,i+1);
       }
     }
 
@@ -2805,7 +2923,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb,i);
+        AddBlockLine(job,blocklists,blockcount,blockdone,ncols*j+xb,i,i+1);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -2816,23 +2934,23 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(j-1)+xb,i,i+1);
             if (xb>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb-1,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*j+xb-1,i,i+1);
           }
           else if (vert)  //   | - block x,y-
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(j-1)+xb,i,i+1);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (xb>0 && j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i);
+              AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i,i+1);
           }
         }
         else if (j>0 && miny<y) // else not on a corner: x,y-
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+          AddBlockLine(job,blocklists,blockcount,blockdone,ncols*(j-1)+xb,i,i+1);
       }
     }
   }
@@ -2840,48 +2958,172 @@ static void P_CreateBlockMap(void)
   // Add initial 0 to all blocklists
   // count the total number of lines (and 0's and -1's)
 
-  memset(blockdone,0,NBlocks*sizeof(int));
-  for (i=0,linetotal=0;i<NBlocks;i++)
+  for (i=0,linetotal=0;!job->failed && i<NBlocks;i++)
   {
-    AddBlockLine(blocklists,blockcount,blockdone,i,0);
+    AddBlockLine(job,blocklists,blockcount,blockdone,i,0,job->numlines+1);
     linetotal += blockcount[i];
   }
 
   // Create the blockmap lump
 
-  blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * (4 + NBlocks + linetotal));
-  // blockmap header
+  if (!job->failed)
+  {
+    job->count = 4 + NBlocks + linetotal;
+    job->blockmaplump = malloc(sizeof(*job->blockmaplump) * job->count);
+  }
 
-  blockmaplump[0] = bmaporgx = xorg << FRACBITS;
-  blockmaplump[1] = bmaporgy = yorg << FRACBITS;
-  blockmaplump[2] = bmapwidth  = ncols;
-  blockmaplump[3] = bmapheight = nrows;
+  if (job->blockmaplump)
+  {
+    int *blockmaplump = job->blockmaplump;
 
-  // offsets to lists and block lists
+    // blockmap header
 
-  for (i=0;i<NBlocks;i++)
-  {
-    linelist_t *bl = blocklists[i];
-    long offs = blockmaplump[4+i] =   // set offset to block's list
-      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
+    blockmaplump[0] = xorg << FRACBITS;
+    blockmaplump[1] = yorg << FRACBITS;
+    blockmaplump[2] = ncols;
+    blockmaplump[3] = nrows;
 
-    // add the lines in each block's list to the blockmaplump
-    // delete each list node as we go
+    // offsets to lists and block lists
 
-    while (bl)
+    for (i=0;i<NBlocks;i++)
     {
-      linelist_t *tmp = bl->next;
-      blockmaplump[offs++] = bl->num;
-      Z_Free(bl);
-      bl = tmp;
+      int bl = blocklists[i];
+      long offs = blockmaplump[4+i] =   // set offset to block's list
+        (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
+
+      // add the lines in each block's list to the blockmaplump
+
+      while (bl >= 0)
+      {
+        blockmaplump[offs++] = job->pool[bl].num;
+        bl = job->pool[bl].next;
+      }
     }
   }
 
   // free all temporary storage
 
-  Z_Free (blocklists);
-  Z_Free (blockcount);
-  Z_Free (blockdone);
+  free (blocklists);
+  free (blockcount);
+  free (blockdone);
+  free (job->pool);
+  job->pool = NULL;
+}
+
+//
+// Blockmap construction runs on the thread pool while the nodes load,
+// since nothing before P_GroupLines needs it. A blockmap created for
+// the same map geometry before is reused from the level cache instead.
+//
+
+static blockmap_job_t blockmap_job;
+static dsda_task_group_t blockmap_tasks;
+static dboolean blockmap_pending;
+
+// The cache key is taken before the nodes load, which may add vertexes,
+// and the same key is used when the blockmap is written
+static int blockmap_cache_counts[3];
+
+static void P_CreateBlockMapTask(void *data)
+{
+  blockmap_job_t *job = data;
+  unsigned long long start;
+
+  start = dsda_MonotonicTime();
+  P_CreateBlockMap(job);
+  job->build_time = dsda_MonotonicTime() - start;
+}
+
+static void P_StartCreateBlockMap(void)
+{
+  int i;
+  blockmap_job_t *job = &blockmap_job;
+
+  blockmap_cache_counts[0] = numvertexes;
+  blockmap_cache_counts[1] = numlines;
+  blockmap_cache_counts[2] = numsectors;
+
+  if (dsda_OpenLevelCache(dsda_level_cache_blockmap, nodesVersion,
+                          blockmap_cache_counts, arrlen(blockmap_cache_counts)))
+  {
+    const int *count;
+    const int *data = NULL;
+
+    count = dsda_ReadLevelCache(sizeof(*count));
+    if (count && *count >= 4)
+      data = dsda_ReadLevelCache(*count * sizeof(*data));
+
+    if (data && dsda_LevelCacheComplete())
+    {
+      blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * *count);
+      memcpy(blockmaplump, data, sizeof(*blockmaplump) * *count);
+
+      bmaporgx = blockmaplump[0];
+      bmaporgy = blockmaplump[1];
+      bmapwidth = blockmaplump[2];
+      bmapheight = blockmaplump[3];
+    }
+
+    if (dsda_CloseLevelCache())
+      return;
+  }
+
+  // The nodes may reallocate the vertexes while this runs
+  memset(job, 0, sizeof(*job));
+
+  job->numvertexes = numvertexes;
+  job->vertexes = Z_Malloc(2 * numvertexes * sizeof(*job->vertexes));
+  for (i = 0; i < numvertexes; i++)
+  {
+    job->vertexes[2 * i] = vertexes[i].x;
+    job->vertexes[2 * i + 1] = vertexes[i].y;
+  }
+
+  job->numlines = numlines;
+  job->lines = Z_Malloc(4 * numlines * sizeof(*job->lines));
+  for (i = 0; i < numlines; i++)
+  {
+    job->lines[4 * i] = lines[i].v1->x;
+    job->lines[4 * i + 1] = lines[i].v1->y;
+    job->lines[4 * i + 2] = lines[i].v2->x;
+    job->lines[4 * i + 3] = lines[i].v2->y;
+  }
+
+  blockmap_pending = true;
+  dsda_QueueTask(&blockmap_tasks, P_CreateBlockMapTask, job);
+}
+
+static void P_FinishCreateBlockMap(void)
+{
+  blockmap_job_t *job = &blockmap_job;
+
+  if (!blockmap_pending)
+    return;
+
+  dsda_WaitTasks(&blockmap_tasks);
+  blockmap_pending = false;
+
+  Z_Free(job->vertexes);
+  Z_Free(job->lines);
+
+  if (!job->blockmaplump)
+    I_Error("P_CreateBlockMap: not enough memory");
+
+  blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * job->count);
+  memcpy(blockmaplump, job->blockmaplump, sizeof(*blockmaplump) * job->count);
+  free(job->blockmaplump);
+  job->blockmaplump = NULL;
+
+  bmaporgx = blockmaplump[0];
+  bmaporgy = blockmaplump[1];
+  bmapwidth = blockmaplump[2];
+  bmapheight = blockmaplump[3];
+
+  dsda_BeginLevelCache(dsda_level_cache_blockmap, nodesVersion,
+                       blockmap_cache_counts, arrlen(blockmap_cache_counts));
+  dsda_WriteLevelCache(&job->count, sizeof(job->count));
+  dsda_WriteLevelCache(blockmaplump, sizeof(*blockmaplump) * job->count);
+  dsda_EndLevelCache(job->build_time);
 }
 
 // jff 10/6/98
@@ -2981,13 +3223,13 @@ static void P_LoadBlockMap (int lump)
     (count /= 2) >= 0x10000 //e6y
   )
   {
-    P_CreateBlockMap();
+    P_StartCreateBlockMap();
   }
   else
   {
     long i;
     // cph - const*, wad lump handling updated
-    const short *wadblockmaplump = W_LumpByNum(lump);
+    const short *wadblockmaplump = W_BorrowLumpNum(lump);
     blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * count);
 
     // killough 3/1/98: Expand wad blockmap into larger internal one,
@@ -3011,6 +3253,8 @@ static void P_LoadBlockMap (int lump)
     bmapwidth = blockmaplump[2];
     bmapheight = blockmaplump[3];
 
+    W_ReturnLumpNum(lump);
+
     // haleyjd 03/04/10: check for blockmap problems
     // http://www.doomworld.com/idgames/index.php?id=12935
     if (!P_VerifyBlockMap(count))
@@ -3019,12 +3263,24 @@ static void P_LoadBlockMap (int lump)
       lprintf(LO_INFO, "P_LoadBlockMap: use \"-blockmap\" command line switch for rebuilding\n");
     }
   }
+}
+
+//
+// P_FinishLoadBlockMap
+//
+// Waits for a blockmap being built and sets up the block links
+//
+
+static void P_FinishLoadBlockMap(void)
+{
+  P_FinishCreateBlockMap();
 
   RememberOriginalBlockMap();
 
   // clear out mobj chains - CPhipps - use calloc
   blocklinks_count = bmapwidth * bmapheight;
   blocklinks = calloc_IfSameLevel(blocklinks, blocklinks_count, sizeof(*blocklinks));
+  targetlinks = calloc_IfSameLevel(targetlinks, blocklinks_count, sizeof(*targetlinks));
   blockmap = blockmaplump+4;
 
   // MAES: set blockmapxneg and blockmapyneg
@@ -3169,15 +3425,49 @@ static int P_GroupLines (void)
 // P_LoadReject - load the reject table
 //
 
+// Only an empty table is replaced, since a real one may be hand tuned
+static dboolean P_UseGeneratedReject(unsigned int length)
+{
+  unsigned int i;
+
+  if (!dsda_IntConfig(dsda_config_generate_reject))
+    return false;
+
+  if (demorecording || demoplayback || netgame)
+  {
+    lprintf(LO_DEBUG, "P_LoadReject: generated REJECT is not used in demos or netgames\n");
+    return false;
+  }
+
+  for (i = 0; i < length; i++)
+    if (rejectmatrix[i])
+      return false;
+
+  return true;
+}
+
 static void P_LoadReject(int lump)
 {
   unsigned int length;
+  int totallines;
 
   length = W_SafeLumpLength(lump);
   rejectmatrix = W_SafeLumpByNum(lump);
+  totallines = P_GroupLines();
+
+  if (P_UseGeneratedReject(length))
+  {
+    byte *reject = dsda_GenerateReject();
+
+    if (reject)
+    {
+      rejectmatrix = reject;
+      return;
+    }
+  }
 
   //e6y: check for overflow
-  RejectOverrun(length, &rejectmatrix, P_GroupLines());
+  RejectOverrun(length, &rejectmatrix, totallines);
 }
 
 //
@@ -3226,13 +3516,25 @@ static void P_LoadReject(int lump)
 // Firelines (TM) is a Rezistered Trademark of MBF Productions
 //
 
+// Correction of desync on dv04-423.lmp/dv.wad
+// http://www.doomworld.com/vb/showthread.php?s=&postid=627257#post627257
+static int P_ApplySlimeTrailsForRealVertexes(void)
+{
+  return compatibility_level>=lxdoom_1_compatibility || prboom_comp[PC_REMOVE_SLIME_TRAILS].state;
+}
+
+// Everything besides the map lumps that changes the cached geometry:
+// the node format (see -force_old_zdoom_nodes) and slime trail removal
+int P_GeometryCacheVariant(void)
+{
+  return (nodesVersion << 1) | P_ApplySlimeTrailsForRealVertexes();
+}
+
 static void P_RemoveSlimeTrails(void)         // killough 10/98
 {
   byte *hit = Z_Calloc(1, numvertexes);         // Hitlist for vertices
   int i;
-  // Correction of desync on dv04-423.lmp/dv.wad
-  // http://www.doomworld.com/vb/showthread.php?s=&postid=627257#post627257
-  int apply_for_real_vertexes = (compatibility_level>=lxdoom_1_compatibility || prboom_comp[PC_REMOVE_SLIME_TRAILS].state);
+  int apply_for_real_vertexes = P_ApplySlimeTrailsForRealVertexes();
 
   for (i=0; i<numvertexes; i++)
   {
@@ -3288,10 +3590,25 @@ static void P_RemoveSlimeTrails(void)         // killough 10/98
   Z_Free(hit);
 }
 
-static void R_CalcSegsLength(void)
+//
+// Seg lengths are independent per seg, so large maps split them
+// across the thread pool
+//
+
+#define SEG_LENGTH_TASK_SIZE 4096
+
+typedef struct
 {
+  int start;
+  int end;
+} seg_range_t;
+
+static void R_CalcSegsLengthRange(void *data)
+{
+  const seg_range_t *range = data;
   int i;
-  for (i=0; i<numsegs; i++)
+
+  for (i=range->start; i<range->end; i++)
   {
     double length;
     seg_t *li = segs+i;
@@ -3304,6 +3621,128 @@ static void R_CalcSegsLength(void)
   }
 }
 
+static void R_CalcSegsLength(void)
+{
+  int i;
+  int task_count;
+  seg_range_t *ranges;
+  dsda_task_group_t group = { 0 };
+
+  task_count = (numsegs + SEG_LENGTH_TASK_SIZE - 1) / SEG_LENGTH_TASK_SIZE;
+  task_count = MIN(task_count, dsda_ThreadPoolSize() + 1);
+
+  if (task_count <= 1)
+  {
+    seg_range_t range = { 0, numsegs };
+
+    R_CalcSegsLengthRange(&range);
+    return;
+  }
+
+  ranges = Z_Malloc(task_count * sizeof(*ranges));
+
+  for (i = 0; i < task_count; i++)
+  {
+    ranges[i].start = (int) ((int64_t) numsegs * i / task_count);
+    ranges[i].end = (int) ((int64_t) numsegs * (i + 1) / task_count);
+    dsda_QueueTask(&group, R_CalcSegsLengthRange, &ranges[i]);
+  }
+
+  dsda_WaitTasks(&group);
+
+  Z_Free(ranges);
+}
+
+//
+// P_PrepareGeometry
+//
+// Slime trail removal and seg lengths depend only on the map geometry,
+// so the results are cached per map and compatibility behaviour
+//
+
+typedef struct
+{
+  fixed_t x, y;
+  fixed_t px, py;
+} cached_vertex_t;
+
+typedef struct
+{
+  uint32_t halflength;
+  angle_t pangle;
+} cached_seg_t;
+
+static void P_PrepareGeometry(void)
+{
+  int i;
+  int variant;
+  unsigned long long start;
+  int counts[] = { numvertexes, numsegs };
+
+  variant = P_GeometryCacheVariant();
+
+  if (dsda_OpenLevelCache(dsda_level_cache_geometry, variant, counts, arrlen(counts)))
+  {
+    const cached_vertex_t *cv;
+    const cached_seg_t *cs;
+
+    cv = dsda_ReadLevelCache(numvertexes * sizeof(*cv));
+    cs = dsda_ReadLevelCache(numsegs * sizeof(*cs));
+
+    // Nothing is touched unless the whole section checks out
+    if (cv && cs && dsda_LevelCacheComplete())
+    {
+      for (i = 0; i < numvertexes; i++)
+      {
+        vertexes[i].x = cv[i].x;
+        vertexes[i].y = cv[i].y;
+        vertexes[i].px = cv[i].px;
+        vertexes[i].py = cv[i].py;
+      }
+
+      for (i = 0; i < numsegs; i++)
+      {
+        segs[i].halflength = cs[i].halflength;
+        segs[i].pangle = cs[i].pangle;
+      }
+    }
+
+    if (dsda_CloseLevelCache())
+      return;
+  }
+
+  start = dsda_MonotonicTime();
+
+  P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+
+  // should be after P_RemoveSlimeTrails, because it changes vertexes
+  R_CalcSegsLength();
+
+  dsda_BeginLevelCache(dsda_level_cache_geometry, variant, counts, arrlen(counts));
+
+  for (i = 0; i < numvertexes; i++)
+  {
+    cached_vertex_t cv;
+
+    cv.x = vertexes[i].x;
+    cv.y = vertexes[i].y;
+    cv.px = vertexes[i].px;
+    cv.py = vertexes[i].py;
+    dsda_WriteLevelCache(&cv, sizeof(cv));
+  }
+
+  for (i = 0; i < numsegs; i++)
+  {
+    cached_seg_t cs;
+
+    cs.halflength = segs[i].halflength;
+    cs.pangle = segs[i].pangle;
+    dsda_WriteLevelCache(&cs, sizeof(cs));
+  }
+
+  dsda_EndLevelCache(dsda_MonotonicTime() - start);
+}
+
 //
 // P_CheckLumpsForSameSource
 //
@@ -3348,6 +3787,9 @@ static dboolean P_CheckForUDMF(int lumpnum)
   {
     if (!strncasecmp(lumpinfo[i].name, "TEXTMAP", 8))
     {
+      if (dsda_Flag(dsda_arg_bench_udmf))
+        dsda_BenchmarkUDMF(W_LumpByNum(i), W_LumpLength(i), I_Error);
+
       dsda_ParseUDMF(W_LumpByNum(i), W_LumpLength(i), I_Error);
       return true;
     }
@@ -3485,9 +3927,6 @@ static void P_UpdateUDMFLevelComponents(int lumpnum)
     else if (!strncasecmp(name, "REJECT", 8))
       level_components.reject = i;
   }
-
-  if (level_components.znodes == LUMP_NOT_FOUND)
-    I_Error("P_SetupLevel: Level wad structure is incomplete. There is no ZNODES lump.");
 }
 
 void PO_LoadThings(int lump);
@@ -3641,6 +4080,116 @@ void P_MustRebuildBlockmap(void)
   must_rebuild_blockmap = true;
 }
 
+//
+// P_InitLevelCache
+//
+// Derived level data is cached by the contents of every map lump
+//
+
+static void P_InitLevelCache(void)
+{
+  int lumps[] = {
+    level_components.things,
+    level_components.linedefs,
+    level_components.sidedefs,
+    level_components.vertexes,
+    level_components.segs,
+    level_components.ssectors,
+    level_components.nodes,
+    level_components.sectors,
+    level_components.blockmap,
+    has_behavior ? level_components.behavior : LUMP_NOT_FOUND,
+    level_components.znodes,
+    udmf_map ? level_components.label + ML_TEXTMAP : LUMP_NOT_FOUND,
+  };
+
+  dsda_InitLevelCache(lumps, arrlen(lumps));
+}
+
+//
+// Level setup timing
+//
+// Each stage is charged the time since the previous stage ended,
+// so waiting on a background job counts towards the stage that waits
+//
+
+typedef enum
+{
+  setup_stage_prepare,
+  setup_stage_vertexes,
+  setup_stage_sectors,
+  setup_stage_sidedefs,
+  setup_stage_linedefs,
+  setup_stage_blockmap,
+  setup_stage_nodes,
+  setup_stage_reject,
+  setup_stage_geometry,
+  setup_stage_things,
+  setup_stage_precache,
+  setup_stage_specials,
+  setup_stage_gl,
+  setup_stage_finish,
+  SETUP_STAGE_COUNT
+} setup_stage_t;
+
+static const char *setup_stage_names[SETUP_STAGE_COUNT] =
+{
+  [setup_stage_prepare] = "prepare",
+  [setup_stage_vertexes] = "vertexes",
+  [setup_stage_sectors] = "sectors",
+  [setup_stage_sidedefs] = "sidedefs",
+  [setup_stage_linedefs] = "linedefs",
+  [setup_stage_blockmap] = "blockmap",
+  [setup_stage_nodes] = "nodes",
+  [setup_stage_reject] = "reject",
+  [setup_stage_geometry] = "geometry",
+  [setup_stage_things] = "things",
+  [setup_stage_precache] = "precache",
+  [setup_stage_specials] = "specials",
+  [setup_stage_gl] = "gl",
+  [setup_stage_finish] = "finish",
+};
+
+static unsigned long long setup_stage_time[SETUP_STAGE_COUNT];
+static unsigned long long setup_stage_start;
+
+static void P_StartSetupTiming(void)
+{
+  memset(setup_stage_time, 0, sizeof(setup_stage_time));
+  blockmap_job.build_time = 0;
+  setup_stage_start = dsda_MonotonicTime();
+}
+
+static void P_EndSetupStage(setup_stage_t stage)
+{
+  unsigned long long now;
+
+  now = dsda_MonotonicTime();
+  setup_stage_time[stage] += now - setup_stage_start;
+  setup_stage_start = now;
+}
+
+static void P_PrintSetupTiming(const char *lumpname)
+{
+  int i;
+  unsigned long long total = 0;
+
+  if (!dsda_Flag(dsda_arg_setupstats))
+    return;
+
+  for (i = 0; i < SETUP_STAGE_COUNT; i++)
+    total += setup_stage_time[i];
+
+  lprintf(LO_INFO, "P_SetupLevel: %s set up in %.2f ms\n", lumpname, total / 1000.0);
+
+  for (i = 0; i < SETUP_STAGE_COUNT; i++)
+    lprintf(LO_INFO, "  %-10s %8.2f ms\n", setup_stage_names[i], setup_stage_time[i] / 1000.0);
+
+  if (blockmap_job.build_time)
+    lprintf(LO_INFO, "  (blockmap built in %.2f ms alongside the nodes)\n",
+            blockmap_job.build_time / 1000.0);
+}
+
 //
 // P_SetupLevel
 //
@@ -3651,6 +4200,9 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   int   i;
   char  lumpname[9];
   int   lumpnum;
+  dboolean reload_blockmap;
+
+  P_StartSetupTiming();
 
   //e6y
   totallive = 0;
@@ -3660,6 +4212,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   dsda_WatchBeforeLevelSetup();
 
   R_StopAllInterpolations();
+  P_InvalidateSightCache();
+  P_ClearBlockLineBoxes();
 
   totallive = totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
   wminfo.partime = 180;
@@ -3707,6 +4261,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   // figgi 10/19/00 -- check for gl lumps and load them
   P_GetNodesVersion();
 
+  P_InitLevelCache();
+
   samelevel = !inconsistent_nodes &&
               map == current_map &&
               episode == current_episode &&
@@ -3730,6 +4286,7 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
     Z_Free(map_subsectors);
 
     Z_Free(blocklinks);
+    Z_Free(targetlinks);
     Z_Free(blockmaplump);
 
     Z_Free(lines);
@@ -3740,13 +4297,21 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
 
   dsda_ResetHealthGroups();
 
+  P_EndSetupStage(setup_stage_prepare);
+
   map_loader.load_vertexes(level_components.vertexes);
+  P_EndSetupStage(setup_stage_vertexes);
   map_loader.load_sectors(level_components.sectors);
+  P_EndSetupStage(setup_stage_sectors);
   map_loader.allocate_sidedefs(level_components.sidedefs);
+  P_EndSetupStage(setup_stage_sidedefs);
   map_loader.load_linedefs(level_components.linedefs);
+  P_EndSetupStage(setup_stage_linedefs);
   map_loader.load_sidedefs(level_components.sidedefs);
+  P_EndSetupStage(setup_stage_sidedefs);
 
   P_PostProcessLineDefs();
+  P_EndSetupStage(setup_stage_linedefs);
 
   // e6y: speedup of level reloading
   // Do not reload BlockMap for same level,
@@ -3754,7 +4319,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   //
   // BlockMap should be reloaded after OVERFLOW_INTERCEPT,
   // because bmapwidth/bmapheight/bmaporgx/bmaporgy can be overwritten
-  if (!samelevel || must_rebuild_blockmap)
+  reload_blockmap = !samelevel || must_rebuild_blockmap;
+  if (reload_blockmap)
   {
     must_rebuild_blockmap = false;
     P_LoadBlockMap(level_components.blockmap);
@@ -3762,8 +4328,11 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   else
   {
     memset(blocklinks, 0, bmapwidth*bmapheight*sizeof(*blocklinks));
+    memset(targetlinks, 0, bmapwidth*bmapheight*sizeof(*targetlinks));
   }
 
+  P_EndSetupStage(setup_stage_blockmap);
+
   switch (nodesVersion)
   {
     case ZDOOM_XNOD_NODES:
@@ -3790,6 +4359,11 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
 
       break;
 
+    case BUILT_GL_NODES:
+      P_BuildNodes();
+
+      break;
+
     case DEEP_BSP_V4_NODES:
       P_LoadSubsectors_V4(level_components.ssectors);
       P_LoadNodes_V4(level_components.nodes);
@@ -3806,6 +4380,15 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
       break;
   }
 
+  P_EndSetupStage(setup_stage_nodes);
+
+  if (reload_blockmap)
+  {
+    P_FinishLoadBlockMap();
+  }
+
+  P_EndSetupStage(setup_stage_blockmap);
+
   if (!samelevel)
   {
     P_InitSubsectorsLines();
@@ -3814,13 +4397,17 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   map_subsectors = calloc_IfSameLevel(map_subsectors,
     numsubsectors, sizeof(map_subsectors[0]));
 
+  P_EndSetupStage(setup_stage_nodes);
+
   // reject loading and underflow padding separated out into new function
   P_LoadReject(level_components.reject);
+  P_InitSoundFlood();
 
-  P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+  P_EndSetupStage(setup_stage_reject);
 
-  // should be after P_RemoveSlimeTrails, because it changes vertexes
-  R_CalcSegsLength();
+  P_PrepareGeometry();
+
+  P_EndSetupStage(setup_stage_geometry);
 
   {
     void A_ResetPlayerCorpseQueue(void);
@@ -3899,6 +4486,18 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   // clear special respawning que
   iquehead = iquetail = 0;
 
+  // polyobjects are in place now
+  P_InitBlockLineBoxes();
+
+  P_EndSetupStage(setup_stage_things);
+
+  // preload graphics
+  // with worker threads this only queues the work, so start it as early
+  // as possible and let it overlap the rest of the level setup
+  R_PrecacheLevel();
+
+  P_EndSetupStage(setup_stage_precache);
+
   // set up world state
   P_SpawnSpecials();
 
@@ -3910,8 +4509,7 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
 
   dsda_ApplyFadeTable();
 
-  // preload graphics
-  R_PrecacheLevel();
+  P_EndSetupStage(setup_stage_specials);
 
   if (V_IsOpenGLMode())
   {
@@ -3926,6 +4524,10 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
     }
   }
 
+  P_EndSetupStage(setup_stage_gl);
+
+  dsda_ReportLevelCache();
+
   //e6y
   if (!samelevel)
   {
@@ -3945,6 +4547,9 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   {
     AM_Start(false);
   }
+
+  P_EndSetupStage(setup_stage_finish);
+  P_PrintSetupTiming(lumpname);
 }
 
 //
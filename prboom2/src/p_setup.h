@@ -49,6 +49,8 @@ extern int      bmapheight;      /* in mapblocks */
 extern fixed_t  bmaporgx;
 extern fixed_t  bmaporgy;        /* origin of block map */
 extern mobj_t   **blocklinks;    /* for thing chains */
+extern mobj_t   **targetlinks;   /* possible targets, in blocklinks order */
+extern int      blocklinks_count;
 
 extern dboolean skipblstart; // MaxW: Skip initial blocklist short
 
@@ -68,6 +70,8 @@ extern blockmap_t original_blockmap;
 
 void P_RestoreOriginalBlockMap(void);
 
+int P_GeometryCacheVariant(void);
+
 typedef struct
 {
   void (*load_vertexes)(int lump);
@@ -42,7 +42,9 @@
 #include "g_overflow.h"
 #include "e6y.h" //e6y
 
+#include "dsda/configuration.h"
 #include "dsda/map_format.h"
+#include "dsda/profiler.h"
 
 /*
 ==============================================================================
@@ -893,6 +895,102 @@ static dboolean P_CrossBSPNode(int bspnum)
     return P_CrossBSPNode_PrBoom(bspnum);
 }
 
+//
+// Sight cache
+//
+// Within a tic the same pair is often checked more than once, e.g. the
+// melee and missile range checks in A_Chase. BSP traversal results are kept
+// in a direct-mapped table keyed by the exact positions involved, so a hit
+// returns exactly what the traversal would have. Moving planes and polyobjects
+// and changing line flags bump the generation, which drops every entry.
+//
+
+#define SIGHT_CACHE_BITS 12
+#define SIGHT_CACHE_SIZE (1 << SIGHT_CACHE_BITS)
+
+typedef struct
+{
+  unsigned int generation;
+  const subsector_t *ss1, *ss2;
+  fixed_t x1, y1, z1, height1;
+  fixed_t x2, y2, z2, height2;
+  dboolean result;
+} sight_cache_entry_t;
+
+static sight_cache_entry_t sight_cache[SIGHT_CACHE_SIZE];
+static unsigned int sight_cache_generation = 1;
+static dboolean sight_cache_enabled;
+static int sight_cache_hits, sight_cache_lookups;
+static int last_tic_hits, last_tic_lookups;
+
+void P_InvalidateSightCache(void)
+{
+  if (!++sight_cache_generation)
+  {
+    memset(sight_cache, 0, sizeof(sight_cache));
+    sight_cache_generation = 1;
+  }
+}
+
+void P_StartSightCacheTic(void)
+{
+  last_tic_hits = sight_cache_hits;
+  last_tic_lookups = sight_cache_lookups;
+  sight_cache_hits = sight_cache_lookups = 0;
+
+  sight_cache_enabled = dsda_IntConfig(dsda_config_sight_cache);
+
+  P_InvalidateSightCache();
+}
+
+void P_GetSightCacheStats(int *hits, int *lookups)
+{
+  *hits = last_tic_hits;
+  *lookups = last_tic_lookups;
+}
+
+static sight_cache_entry_t *P_SightCacheEntry(const mobj_t *t1, const mobj_t *t2)
+{
+  unsigned int hash;
+
+  hash = (unsigned int) t1->x * 0x9e3779b1u +
+         (unsigned int) t1->y * 0x85ebca77u +
+         (unsigned int) t1->z * 0xc2b2ae3du +
+         (unsigned int) t2->x * 0x27d4eb2fu +
+         (unsigned int) t2->y * 0x165667b1u +
+         (unsigned int) t2->z * 0xd3a2646cu;
+
+  return &sight_cache[hash >> (32 - SIGHT_CACHE_BITS)];
+}
+
+static dboolean P_SightCacheMatch(const sight_cache_entry_t *entry,
+                                  const mobj_t *t1, const mobj_t *t2)
+{
+  return entry->generation == sight_cache_generation &&
+         entry->x1 == t1->x && entry->y1 == t1->y &&
+         entry->x2 == t2->x && entry->y2 == t2->y &&
+         entry->z1 == t1->z && entry->height1 == t1->height &&
+         entry->z2 == t2->z && entry->height2 == t2->height &&
+         entry->ss1 == t1->subsector && entry->ss2 == t2->subsector;
+}
+
+static void P_StoreSightCache(sight_cache_entry_t *entry,
+                              const mobj_t *t1, const mobj_t *t2, dboolean result)
+{
+  entry->generation = sight_cache_generation;
+  entry->ss1 = t1->subsector;
+  entry->ss2 = t2->subsector;
+  entry->x1 = t1->x;
+  entry->y1 = t1->y;
+  entry->z1 = t1->z;
+  entry->height1 = t1->height;
+  entry->x2 = t2->x;
+  entry->y2 = t2->y;
+  entry->z2 = t2->z;
+  entry->height2 = t2->height;
+  entry->result = result;
+}
+
 //
 // P_CheckSight
 // Returns true
@@ -905,6 +1003,8 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
 {
   const sector_t *s1, *s2;
   int pnum;
+  dboolean result;
+  sight_cache_entry_t *cache_entry = NULL;
 
   if (compatibility_level == doom_12_compatibility)
   {
@@ -950,6 +1050,19 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
 
   validcount++;
 
+  if (sight_cache_enabled)
+  {
+    ++sight_cache_lookups;
+
+    cache_entry = P_SightCacheEntry(t1, t2);
+    if (P_SightCacheMatch(cache_entry, t1, t2))
+    {
+      ++sight_cache_hits;
+
+      return cache_entry->result;
+    }
+  }
+
   los.topslope = (los.bottomslope = t2->z - (los.sightzstart =
                                              t1->z + t1->height -
                                              (t1->height>>2))) + t2->height;
@@ -985,7 +1098,14 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
   }
 
   // the head node is the last node output
-  return P_CrossBSPNode(numnodes-1);
+  DSDA_PROFILE_BEGIN(dsda_profile_check_sight);
+  result = P_CrossBSPNode(numnodes-1);
+  DSDA_PROFILE_END(dsda_profile_check_sight);
+
+  if (cache_entry)
+    P_StoreSightCache(cache_entry, t1, t2, result);
+
+  return result;
 }
 
 //
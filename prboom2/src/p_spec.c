@@ -6487,6 +6487,8 @@ dboolean P_ExecuteZDoomLineSpecial(int special, int * args, line_t * line, int s
           lines[*id_p].flags = (lines[*id_p].flags & ~clearflags) | setflags;
         }
 
+        P_InvalidateSightCache();
+
         buttonSuccess = 1;
       }
       break;
@@ -44,6 +44,7 @@
 
 #include "dsda.h"
 #include "dsda/pause.h"
+#include "dsda/profiler.h"
 
 int leveltime;
 
@@ -250,6 +251,8 @@ void P_SetTarget(mobj_t **mop, mobj_t *targ)
 
 static void P_RunThinkers (void)
 {
+  DSDA_PROFILE_BEGIN(dsda_profile_run_thinkers);
+
   for (currentthinker = thinkercap.next;
        currentthinker != &thinkercap;
        currentthinker = currentthinker->next)
@@ -263,6 +266,8 @@ static void P_RunThinkers (void)
 
   // Dedicated thinkers
   T_MAPMusic();
+
+  DSDA_PROFILE_END(dsda_profile_run_thinkers);
 }
 
 void P_CleanThinkers (void)
@@ -338,6 +343,8 @@ void P_Ticker (void)
 
   R_UpdateInterpolations ();
 
+  P_StartSightCacheTic();
+
   if (dsda_FrozenMode())
   {
     P_FrozenTicker();
@@ -1172,6 +1172,7 @@ dboolean P_UndoPlayerChicken(player_t * player)
         mo->player = player;
         mo->flags = oldFlags;
         mo->flags2 = oldFlags2;
+        P_UpdateTargetLink(mo);
         player->mo = mo;
         player->chickenTics = 2 * 35;
         return (false);
@@ -1857,6 +1858,7 @@ dboolean P_UndoPlayerMorph(player_t * player)
         mo->player = player;
         mo->flags = oldFlags;
         mo->flags2 = oldFlags2;
+        P_UpdateTargetLink(mo);
         player->mo = mo;
         player->morphTics = 2 * 35;
         return (false);
@@ -43,10 +43,13 @@
 #include "p_tick.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 #include "p_tick.h"
+#include "md5.h"
 
 #include "dsda/args.h"
 #include "dsda/configuration.h"
 #include "dsda/map_format.h"
+#include "dsda/startup_cache.h"
+#include "dsda/thread_pool.h"
 #include "dsda/utility.h"
 
 //
@@ -139,7 +142,7 @@ static int R_FilterValidPatch(int lump_num, const char *name)
   return lump_num;
 }
 
-static void R_InitTextures (void)
+static void R_BuildTextures (void)
 {
   const maptexture_t *mtexture;
   texture_t    *texture;
@@ -215,7 +218,6 @@ static void R_InitTextures (void)
   // clean up malloc-ing to use sizeof
 
   textures = Z_Malloc(numtextures*sizeof*textures);
-  textureheight = Z_Malloc(numtextures*sizeof*textureheight);
 
   for (i=0 ; i<numtextures ; i++, directory++)
     {
@@ -294,11 +296,6 @@ static void R_InitTextures (void)
               ++errors;
             }
         }
-
-      for (j=1; j*2 <= texture->width; j<<=1)
-        ;
-      texture->widthmask = j-1;
-      textureheight[i] = texture->height<<FRACBITS;
     }
 
   Z_Free(patchlookup);         // killough
@@ -312,6 +309,139 @@ static void R_InitTextures (void)
     I_Error("Texture errors: %d!\n%s seems to be incompatible with %s.\nAre you using the right IWAD?",
             errors, dsda_BaseName(info->wadfile->name), doomverstr);
   }
+}
+
+//
+// The texture definitions only depend on the loaded lumps,
+// so they are kept in the startup cache between runs.
+//
+
+typedef struct
+{
+  char name[8];
+  int width, height, patchcount;
+} texture_cache_t;
+
+static void R_TextureCacheInputs(dsda_cksum_t *cksum)
+{
+  static const char *names[] = { "PNAMES", "TEXTURE1", "TEXTURE2" };
+  struct MD5Context md5;
+  int i;
+
+  MD5Init(&md5);
+
+  for (i = 0; i < arrlen(names); i++)
+  {
+    int lump = W_CheckNumForName(names[i]);
+
+    MD5Update(&md5, (const byte *) &lump, sizeof(lump));
+    if (lump != LUMP_NOT_FOUND)
+      MD5Update(&md5, W_LumpByNum(lump), W_LumpLength(lump));
+  }
+
+  MD5Final(cksum->bytes, &md5);
+}
+
+static dboolean R_LoadTextureCache(const dsda_cksum_t *inputs)
+{
+  const int *count;
+  dboolean complete;
+  int i;
+
+  if (!dsda_OpenStartupCache(dsda_startup_cache_textures, inputs))
+    return false;
+
+  count = dsda_ReadStartupCache(sizeof(*count));
+  numtextures = count ? *count : 0;
+  textures = Z_Malloc(numtextures*sizeof*textures);
+
+  for (i = 0; i < numtextures; i++)
+  {
+    const texture_cache_t *cached;
+    const texpatch_t *patches;
+    texture_t *texture;
+
+    cached = dsda_ReadStartupCache(sizeof(*cached));
+    if (!cached || cached->patchcount < 0)
+      break;
+
+    patches = dsda_ReadStartupCache(cached->patchcount * sizeof(*patches));
+    if (!patches)
+      break;
+
+    texture = textures[i] =
+      Z_Malloc(sizeof(texture_t) + sizeof(texpatch_t)*(cached->patchcount-1));
+
+    memcpy(texture->name, cached->name, sizeof(texture->name));
+    texture->width = cached->width;
+    texture->height = cached->height;
+    texture->patchcount = cached->patchcount;
+    memcpy(texture->patches, patches, cached->patchcount * sizeof(*patches));
+  }
+
+  complete = dsda_CloseStartupCache() && count && i == numtextures;
+
+  if (!complete)
+  {
+    while (--i >= 0)
+      Z_Free(textures[i]);
+    Z_Free(textures);
+    textures = NULL;
+    numtextures = 0;
+  }
+
+  return complete;
+}
+
+static void R_SaveTextureCache(const dsda_cksum_t *inputs)
+{
+  int i;
+
+  dsda_BeginStartupCache(dsda_startup_cache_textures, inputs);
+  dsda_WriteStartupCache(&numtextures, sizeof(numtextures));
+
+  for (i = 0; i < numtextures; i++)
+  {
+    const texture_t *texture = textures[i];
+    texture_cache_t cached;
+
+    memset(&cached, 0, sizeof(cached));
+    memcpy(cached.name, texture->name, sizeof(cached.name));
+    cached.width = texture->width;
+    cached.height = texture->height;
+    cached.patchcount = texture->patchcount;
+
+    dsda_WriteStartupCache(&cached, sizeof(cached));
+    dsda_WriteStartupCache(texture->patches, texture->patchcount * sizeof(texpatch_t));
+  }
+
+  dsda_EndStartupCache();
+}
+
+static void R_InitTextures (void)
+{
+  dsda_cksum_t inputs;
+  int i, j;
+
+  R_TextureCacheInputs(&inputs);
+
+  if (!R_LoadTextureCache(&inputs))
+  {
+    R_BuildTextures();
+    R_SaveTextureCache(&inputs);
+  }
+
+  textureheight = Z_Malloc(numtextures*sizeof*textureheight);
+
+  for (i=0 ; i<numtextures ; i++)
+    {
+      texture_t *texture = textures[i];
+
+      for (j=1; j*2 <= texture->width; j<<=1)
+        ;
+      texture->widthmask = j-1;
+      textureheight[i] = texture->height<<FRACBITS;
+    }
 
   // Create translation table for global animation.
   // killough 4/9/98: make column offsets 32-bit;
@@ -421,6 +551,7 @@ int R_ColormapNumForName(const char *name)
 
 void R_InitData(void)
 {
+  dsda_InitStartupCache();
   lprintf(LO_DEBUG, "Textures ");
   R_InitTextures();
   lprintf(LO_DEBUG, "Flats ");
@@ -528,14 +659,45 @@ static inline void precache_lump(int l)
   W_LumpByNum(l);
 }
 
+// With worker threads available, patches and composites are built in the
+// background (see R_PrecachePatch) and flats are paged in by a worker.
+
+typedef struct {
+  const byte *data;
+  int size;
+} precache_flat_t;
+
+static dsda_task_group_t flat_precache_group;
+static precache_flat_t *precache_flats;
+static int precache_flat_count;
+
+static void R_TouchFlatsTask(void *data)
+{
+  int i, j;
+  volatile byte sum = 0;
+
+  for (i = 0; i < precache_flat_count; i++)
+    for (j = 0; j < precache_flats[i].size; j += 4096)
+      sum += precache_flats[i].data[j];
+}
+
 void R_PrecacheLevel(void)
 {
   register int i;
   register byte *hitlist;
+  dboolean threaded;
 
   if (timingdemo)
     return;
 
+  threaded = dsda_ThreadPoolSize() > 0;
+
+  if (threaded)
+  {
+    R_FinishPrecache();
+    dsda_WaitTasks(&flat_precache_group);
+  }
+
   {
     int size = numflats > num_sprites  ? numflats : num_sprites;
     hitlist = Z_Malloc(numtextures > size ? numtextures : size);
@@ -548,9 +710,30 @@ void R_PrecacheLevel(void)
   for (i = numsectors; --i >= 0; )
     hitlist[sectors[i].floorpic] = hitlist[sectors[i].ceilingpic] = 1;
 
+  if (threaded)
+  {
+    precache_flats = Z_Realloc(precache_flats, numflats * sizeof(*precache_flats));
+    precache_flat_count = 0;
+  }
+
   for (i = numflats; --i >= 0; )
     if (hitlist[i])
-      precache_lump(firstflat + i);
+    {
+      if (threaded)
+      {
+        precache_flat_t *flat = &precache_flats[precache_flat_count];
+
+        flat->data = W_LumpByNum(firstflat + i);
+        flat->size = W_LumpLength(firstflat + i);
+        if (flat->data)
+          precache_flat_count++;
+      }
+      else
+        precache_lump(firstflat + i);
+    }
+
+  if (threaded && precache_flat_count)
+    dsda_QueueTask(&flat_precache_group, R_TouchFlatsTask, NULL);
 
   // Precache textures.
 
@@ -581,10 +764,15 @@ void R_PrecacheLevel(void)
   for (i = numtextures; --i >= 0; )
     if (hitlist[i])
       {
-        texture_t *texture = textures[i];
-        int j = texture->patchcount;
-        while (--j >= 0)
-          precache_lump(texture->patches[j].patch);
+        if (threaded)
+          R_PrecacheComposite(i);
+        else
+        {
+          texture_t *texture = textures[i];
+          int j = texture->patchcount;
+          while (--j >= 0)
+            precache_lump(texture->patches[j].patch);
+        }
       }
 
   // Precache sprites.
@@ -606,11 +794,17 @@ void R_PrecacheLevel(void)
             short *sflump = sprites[i].spriteframes[j].lump;
             int k = 7;
             do
-              precache_lump(firstspritelump + sflump[k]);
+              if (threaded)
+                R_PrecachePatch(firstspritelump + sflump[k]);
+              else
+                precache_lump(firstspritelump + sflump[k]);
             while (--k >= 0);
           }
       }
   Z_Free(hitlist);
+
+  if (threaded)
+    R_StartPrecache();
 }
 
 // Proff - Added for OpenGL
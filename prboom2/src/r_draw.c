@@ -39,13 +39,20 @@
 #include "w_wad.h"
 #include "r_main.h"
 #include "r_draw.h"
+#include "r_drawsimd.h"
 #include "v_video.h"
 #include "st_stuff.h"
 #include "g_game.h"
 #include "am_map.h"
 #include "lprintf.h"
 
+#include "dsda/args.h"
+#include "dsda/configuration.h"
+#include "dsda/profiler.h"
+#include "dsda/render_stats.h"
 #include "dsda/stretch.h"
+#include "dsda/thread_pool.h"
+#include "dsda/time.h"
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -66,7 +73,7 @@ int  viewheight;
 //
 
 // CPhipps - made const*'s
-const byte *tranmap;          // translucency filter maps 256x256   // phares
+THREAD_LOCAL const byte *tranmap; // translucency filter maps 256x256   // phares
 const byte *main_tranmap;     // killough 4/11/98
 
 //
@@ -85,18 +92,34 @@ typedef enum
    COL_FLEXADD
 } columntype_e;
 
-static int    temp_x = 0;
-static int    tempyl[4], tempyh[4];
+// The column buffer is per thread so that sliced rendering can replay
+// the same columns on several threads at once (see R_FinishSlicedDraw).
+static THREAD_LOCAL int    temp_x = 0;
+static THREAD_LOCAL int    tempyl[4], tempyh[4];
 
 // e6y: resolution limitation is removed
-static byte           *tempbuf;
+static THREAD_LOCAL byte           *tempbuf;
 
-static int    startx = 0;
-static int    temptype = COL_NONE;
-static int    commontop, commonbot;
-static const byte *temptranmap = NULL;
+static THREAD_LOCAL int    startx = 0;
+static THREAD_LOCAL int    temptype = COL_NONE;
+static THREAD_LOCAL int    commontop, commonbot;
+static THREAD_LOCAL const byte *temptranmap = NULL;
 // SoM 7-28-04: Fix the fuzz problem.
-static const byte   *tempfuzzmap;
+static THREAD_LOCAL const byte   *tempfuzzmap;
+
+// Only columns in [drawclip_x1, drawclip_x2) reach the frame buffer.
+// Everything outside is still run through the column buffer bookkeeping
+// so that batching and fuzz progression match the unclipped frame.
+static THREAD_LOCAL int drawclip_x1 = 0;
+static THREAD_LOCAL int drawclip_x2 = INT_MAX;
+
+#define R_ColumnClipped(x) ((x) < drawclip_x1 || (x) >= drawclip_x2)
+
+// While set, drawing calls made by the scene renderer are queued
+// instead of executed (see R_BeginSlicedDraw).
+static dboolean draw_recording;
+
+static void R_RecordFlush(void);
 
 //
 // Spectre/Invisibility.
@@ -119,7 +142,7 @@ static const int fuzzoffset_org[FUZZTABLE] = {
 
 static int fuzzoffset[FUZZTABLE];
 
-static int fuzzpos = 0;
+static THREAD_LOCAL int fuzzpos = 0;
 
 // render pipelines
 #define RDC_STANDARD      1
@@ -169,9 +192,9 @@ static void R_QuadFlushError(void)
    I_Error("R_FlushQuadColumn called without being initialized.\n");
 }
 
-static void (*R_FlushWholeColumns)(void) = R_FlushWholeError;
-static void (*R_FlushHTColumns)(void)    = R_FlushHTError;
-static void (*R_FlushQuadColumn)(void) = R_QuadFlushError;
+static THREAD_LOCAL void (*R_FlushWholeColumns)(void) = R_FlushWholeError;
+static THREAD_LOCAL void (*R_FlushHTColumns)(void)    = R_FlushHTError;
+static THREAD_LOCAL void (*R_FlushQuadColumn)(void) = R_QuadFlushError;
 
 static void R_FlushColumns(void)
 {
@@ -194,6 +217,12 @@ static void R_FlushColumns(void)
 //
 void R_ResetColumnBuffer(void)
 {
+   if (draw_recording)
+   {
+      R_RecordFlush();
+      return;
+   }
+
    // haleyjd 10/06/05: this must not be done if temp_x == 0!
    if(temp_x)
       R_FlushColumns();
@@ -329,8 +358,351 @@ static R_DrawColumn_f drawcolumnfuncs[RDRAW_FILTER_MAXFILTERS][RDC_PIPELINE_MAXP
   },
 };
 
+//
+// Sliced drawing
+//
+// The scene is still traversed on the main thread, but every column, span
+// and column buffer flush is queued and sorted into per slice buckets. Each
+// slice then replays its bucket through the normal drawers on its own
+// thread, writing only the pixels in its range of screen columns.
+//
+// A column only reads and writes its own pixels, so a slice just needs its
+// own columns, as long as they are batched as in a single threaded frame:
+// a translucent batch uses the tranmap of its first column. The recorder
+// follows the column buffer batching and queues a flush to every slice with
+// columns in a batch when that batch ends. Fuzz columns are sent to every
+// slice, since fuzz progression depends on all of them. The result is
+// pixel-identical.
+//
+
+typedef enum {
+  DRAW_CMD_COLUMN,
+  DRAW_CMD_SPAN,
+  DRAW_CMD_FLUSH,
+} draw_cmd_type_t;
+
+typedef struct {
+  draw_cmd_type_t type;
+  R_DrawColumn_f colfunc;
+  const byte *tranmap;
+  union {
+    draw_column_vars_t column;
+    draw_span_vars_t span;
+  } vars;
+} draw_cmd_t;
+
+typedef struct {
+  int x1;
+  int x2;
+  byte *tempbuf;
+  int fuzzpos;
+  unsigned long long time;
+  int *cmds;
+  int cmd_count;
+  int cmd_capacity;
+} draw_slice_t;
+
+static draw_cmd_t *draw_cmds;
+static int draw_cmd_count;
+static int draw_cmd_capacity;
+
+static draw_slice_t draw_slices[DSDA_MAX_RENDER_SLICES];
+static int draw_slice_count;
+static int draw_slice_tempbuf_size;
+static int draw_start_fuzzpos;
+
+// The column buffer batch being recorded, as the drawers will see it
+static int record_startx;
+static int record_temp_x;
+static int record_temptype;
+static const byte *record_tranmap;
+static unsigned int record_slices;
+
+#define ALL_DRAW_SLICES ((1u << draw_slice_count) - 1)
+
+static int R_NewDrawCmd(draw_cmd_type_t type)
+{
+  if (draw_cmd_count == draw_cmd_capacity)
+  {
+    draw_cmd_capacity = draw_cmd_capacity ? draw_cmd_capacity * 2 : 4096;
+    draw_cmds = Z_Realloc(draw_cmds, draw_cmd_capacity * sizeof(*draw_cmds));
+  }
+
+  draw_cmds[draw_cmd_count].type = type;
+
+  return draw_cmd_count++;
+}
+
+static void R_QueueDrawCmd(unsigned int slices, int cmd)
+{
+  int i;
+
+  for (i = 0; i < draw_slice_count; ++i)
+    if (slices & (1u << i))
+    {
+      draw_slice_t *slice = &draw_slices[i];
+
+      if (slice->cmd_count == slice->cmd_capacity)
+      {
+        slice->cmd_capacity = slice->cmd_capacity ? slice->cmd_capacity * 2 : 4096;
+        slice->cmds = Z_Realloc(slice->cmds, slice->cmd_capacity * sizeof(*slice->cmds));
+      }
+
+      slice->cmds[slice->cmd_count++] = cmd;
+    }
+}
+
+// slice i covers [viewwidth * i / count, viewwidth * (i + 1) / count)
+static int R_DrawSliceAt(int x)
+{
+  return (draw_slice_count * (x + 1) - 1) / viewwidth;
+}
+
+static void R_RecordFlush(void)
+{
+  if (record_slices)
+    R_QueueDrawCmd(record_slices, R_NewDrawCmd(DRAW_CMD_FLUSH));
+
+  record_temp_x = 0;
+  record_slices = 0;
+}
+
+static void R_RecordColumn(R_DrawColumn_f colfunc, draw_column_vars_t *dcvars, int coltype)
+{
+  draw_cmd_t *cmd;
+  int cmd_index;
+
+  // mirror the fuzz drawer's border adjustment, which decides the batching
+  if (coltype == COL_FUZZ)
+  {
+    if (!dcvars->yl)
+      dcvars->yl = 1;
+
+    if (dcvars->yh == viewheight - 1)
+      dcvars->yh = viewheight - 2;
+  }
+
+  // the drawers skip empty columns without touching the column buffer
+  if (dcvars->yh < dcvars->yl)
+    return;
+
+  if (record_temp_x == 4 ||
+      (record_temp_x && (record_temptype != coltype ||
+                         record_temp_x + record_startx != dcvars->x)))
+    R_RecordFlush();
+
+  if (!record_temp_x)
+  {
+    record_startx = dcvars->x;
+    record_temptype = coltype;
+    record_tranmap = tranmap;
+  }
+  record_temp_x += 1;
+
+  cmd_index = R_NewDrawCmd(DRAW_CMD_COLUMN);
+  cmd = &draw_cmds[cmd_index];
+  cmd->colfunc = colfunc;
+  cmd->tranmap = record_tranmap;
+  cmd->vars.column = *dcvars;
+
+  if (coltype == COL_FUZZ)
+  {
+    record_slices = ALL_DRAW_SLICES;
+    R_QueueDrawCmd(record_slices, cmd_index);
+  }
+  else if (dcvars->x >= 0 && dcvars->x < viewwidth)
+  {
+    unsigned int slice = 1u << R_DrawSliceAt(dcvars->x);
+
+    record_slices |= slice;
+    R_QueueDrawCmd(slice, cmd_index);
+  }
+}
+
+static void R_RecordSpan(draw_span_vars_t *dsvars)
+{
+  int cmd_index;
+  int first, last;
+
+  if (dsvars->x2 < dsvars->x1 || dsvars->x2 < 0 || dsvars->x1 >= viewwidth)
+    return;
+
+  cmd_index = R_NewDrawCmd(DRAW_CMD_SPAN);
+  draw_cmds[cmd_index].vars.span = *dsvars;
+
+  first = R_DrawSliceAt(MAX(dsvars->x1, 0));
+  last = R_DrawSliceAt(MIN(dsvars->x2, viewwidth - 1));
+
+  for (; first <= last; ++first)
+    R_QueueDrawCmd(1u << first, cmd_index);
+}
+
+#define RECORD_COLUMN_FUNC(name, coltype) \
+  static void name ## _Record(draw_column_vars_t *dcvars) { R_RecordColumn(name, dcvars, coltype); }
+
+RECORD_COLUMN_FUNC(R_DrawColumn_PointUV, COL_OPAQUE)
+RECORD_COLUMN_FUNC(R_DrawTLColumn_PointUV, COL_TRANS)
+RECORD_COLUMN_FUNC(R_DrawTranslatedColumn_PointUV, COL_OPAQUE)
+RECORD_COLUMN_FUNC(R_DrawFuzzColumn_PointUV, COL_FUZZ)
+RECORD_COLUMN_FUNC(R_DrawColumn_PointUV_PointZ, COL_OPAQUE)
+RECORD_COLUMN_FUNC(R_DrawTLColumn_PointUV_PointZ, COL_TRANS)
+RECORD_COLUMN_FUNC(R_DrawTranslatedColumn_PointUV_PointZ, COL_OPAQUE)
+RECORD_COLUMN_FUNC(R_DrawFuzzColumn_PointUV_PointZ, COL_FUZZ)
+
+static R_DrawColumn_f recordcolumnfuncs[RDRAW_FILTER_MAXFILTERS][RDC_PIPELINE_MAXPIPELINES] = {
+  {
+    R_DrawColumn_PointUV_Record,
+    R_DrawTLColumn_PointUV_Record,
+    R_DrawTranslatedColumn_PointUV_Record,
+    R_DrawFuzzColumn_PointUV_Record,
+  },
+  {
+    R_DrawColumn_PointUV_PointZ_Record,
+    R_DrawTLColumn_PointUV_PointZ_Record,
+    R_DrawTranslatedColumn_PointUV_PointZ_Record,
+    R_DrawFuzzColumn_PointUV_PointZ_Record,
+  },
+};
+
+static int R_DrawSliceCount(void)
+{
+  dsda_arg_t *arg;
+  int count;
+
+#ifdef RANGECHECK
+  // The column drawers call I_Error on bad input, which is main thread only
+  return 1;
+#endif
+
+  arg = dsda_Arg(dsda_arg_render_threads);
+  count = arg->found ? arg->value.v_int : dsda_IntConfig(dsda_config_render_threads);
+
+  return BETWEEN(1, MIN(viewwidth, DSDA_MAX_RENDER_SLICES), count);
+}
+
+dboolean R_BeginSlicedDraw(void)
+{
+  int i;
+
+  draw_slice_count = R_DrawSliceCount();
+
+  if (draw_slice_count < 2)
+    return false;
+
+  for (i = 0; i < draw_slice_count; ++i)
+  {
+    draw_slice_t *slice = &draw_slices[i];
+
+    slice->x1 = viewwidth * i / draw_slice_count;
+    slice->x2 = viewwidth * (i + 1) / draw_slice_count;
+    slice->cmd_count = 0;
+  }
+
+  draw_cmd_count = 0;
+  record_temp_x = 0;
+  record_slices = 0;
+  draw_recording = true;
+
+  return true;
+}
+
+static void R_DrawSpanSlice(const draw_span_vars_t *dsvars);
+
+static void R_DrawSlice(void *data)
+{
+  draw_slice_t *slice = data;
+  byte *saved_tempbuf = tempbuf;
+  const byte *saved_tranmap = tranmap;
+  unsigned long long start_time;
+  int i;
+
+  start_time = dsda_MonotonicTime();
+  DSDA_PROFILE_BEGIN(dsda_profile_draw_slice);
+
+  tempbuf = slice->tempbuf;
+  drawclip_x1 = slice->x1;
+  drawclip_x2 = slice->x2;
+  fuzzpos = draw_start_fuzzpos;
+
+  for (i = 0; i < slice->cmd_count; ++i)
+  {
+    const draw_cmd_t *cmd = &draw_cmds[slice->cmds[i]];
+
+    switch (cmd->type)
+    {
+      case DRAW_CMD_COLUMN:
+        {
+          // fuzz columns are shared, so each slice works on a copy
+          draw_column_vars_t dcvars = cmd->vars.column;
+
+          tranmap = cmd->tranmap;
+          cmd->colfunc(&dcvars);
+        }
+        break;
+      case DRAW_CMD_SPAN:
+        R_DrawSpanSlice(&cmd->vars.span);
+        break;
+      case DRAW_CMD_FLUSH:
+        R_ResetColumnBuffer();
+        break;
+    }
+  }
+
+  R_ResetColumnBuffer();
+
+  slice->fuzzpos = fuzzpos;
+
+  tempbuf = saved_tempbuf;
+  tranmap = saved_tranmap;
+  drawclip_x1 = 0;
+  drawclip_x2 = INT_MAX;
+
+  DSDA_PROFILE_END(dsda_profile_draw_slice);
+  slice->time = dsda_MonotonicTime() - start_time;
+}
+
+void R_FinishSlicedDraw(void)
+{
+  dsda_task_group_t group = { 0 };
+  int i;
+
+  draw_recording = false;
+
+  if (draw_slice_tempbuf_size != SCREENHEIGHT * 4)
+  {
+    draw_slice_tempbuf_size = SCREENHEIGHT * 4;
+
+    for (i = 0; i < DSDA_MAX_RENDER_SLICES; ++i)
+    {
+      Z_Free(draw_slices[i].tempbuf);
+      draw_slices[i].tempbuf = NULL;
+    }
+  }
+
+  draw_start_fuzzpos = fuzzpos;
+
+  for (i = 0; i < draw_slice_count; ++i)
+  {
+    draw_slice_t *slice = &draw_slices[i];
+
+    if (!slice->tempbuf)
+      slice->tempbuf = Z_Calloc(1, draw_slice_tempbuf_size);
+
+    dsda_QueueTask(&group, R_DrawSlice, slice);
+  }
+
+  dsda_WaitTasks(&group);
+
+  // every slice saw the same fuzz progression
+  fuzzpos = draw_slices[0].fuzzpos;
+
+  for (i = 0; i < draw_slice_count; ++i)
+    dsda_RecordRenderSlice(i, (int) draw_slices[i].time);
+}
+
 R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type, enum draw_filter_type_e filterz) {
-  R_DrawColumn_f result = drawcolumnfuncs[filterz][type];
+  R_DrawColumn_f result = draw_recording ? recordcolumnfuncs[filterz][type] :
+                                           drawcolumnfuncs[filterz][type];
   if (result == NULL)
     I_Error("R_GetDrawColumnFunc: undefined function (%d, %d)", type, filterz);
   return result;
@@ -431,25 +803,39 @@ void R_InitTranslationTables (void)
 //  and the inner loop has to step in texture space u and v.
 //
 
+static INLINE void R_DrawSpanRange(const draw_span_vars_t *dsvars, int x1, int x2,
+                                   fixed_t xfrac, fixed_t yfrac) {
+  byte *dest = drawvars.topleft + dsvars->y*drawvars.pitch + x1;
+
+  R_DrawSpanKernel(dest, dsvars->source, dsvars->colormap, x2 - x1 + 1,
+                   xfrac, yfrac, dsvars->xstep, dsvars->ystep);
+}
+
 void R_DrawSpan(draw_span_vars_t *dsvars) {
-  unsigned count = dsvars->x2 - dsvars->x1 + 1;
-  fixed_t xfrac = dsvars->xfrac;
-  fixed_t yfrac = dsvars->yfrac;
-  const fixed_t xstep = dsvars->xstep;
-  const fixed_t ystep = dsvars->ystep;
-  const byte *source = dsvars->source;
-  const byte *colormap = dsvars->colormap;
-  byte *dest = drawvars.topleft + dsvars->y*drawvars.pitch + dsvars->x1;
-
-  while (count) {
-    const fixed_t xtemp = (xfrac >> 16) & 63;
-    const fixed_t ytemp = (yfrac >> 10) & 4032;
-    const fixed_t spot = xtemp | ytemp;
-    xfrac += xstep;
-    yfrac += ystep;
-    *dest++ = colormap[source[spot]];
-    count--;
+  if (draw_recording) {
+    R_RecordSpan(dsvars);
+    return;
   }
+
+  R_DrawSpanRange(dsvars, dsvars->x1, dsvars->x2, dsvars->xfrac, dsvars->yfrac);
+}
+
+// Draw the part of a span inside the current slice. The texture
+// coordinates are stepped as if the span had been drawn from x1,
+// which is exact since the stepping is plain integer addition.
+static void R_DrawSpanSlice(const draw_span_vars_t *dsvars) {
+  int x1 = MAX(dsvars->x1, drawclip_x1);
+  int x2 = MIN(dsvars->x2, drawclip_x2 - 1);
+  unsigned skip;
+
+  if (x1 > x2)
+    return;
+
+  skip = x1 - dsvars->x1;
+
+  R_DrawSpanRange(dsvars, x1, x2,
+                  (fixed_t) ((unsigned) dsvars->xfrac + skip * (unsigned) dsvars->xstep),
+                  (fixed_t) ((unsigned) dsvars->yfrac + skip * (unsigned) dsvars->ystep));
 }
 
 void R_InitBuffersRes(void)
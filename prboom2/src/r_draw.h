@@ -140,6 +140,10 @@ void R_DrawViewBorder(void);
 // column drawing.
 void R_ResetColumnBuffer(void);
 
+// Split the software scene across worker threads by screen column
+dboolean R_BeginSlicedDraw(void);
+void R_FinishSlicedDraw(void);
+
 void R_SetFuzzPos(int fuzzpos);
 int R_GetFuzzPos();
 
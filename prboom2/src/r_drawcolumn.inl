@@ -142,6 +142,10 @@ static void R_DRAWCOLUMN_FUNCNAME(draw_column_vars_t *dcvars)
 
 // do nothing else when drawin fuzz columns
 #if (!(R_DRAWCOLUMN_PIPELINE & RDC_FUZZ))
+  // columns outside the current slice never reach the screen
+  if (R_ColumnClipped(dcvars->x))
+    return;
+
   {
     const byte          *source = dcvars->source;
 
@@ -155,6 +159,16 @@ static void R_DRAWCOLUMN_FUNCNAME(draw_column_vars_t *dcvars)
 
     count++;
 
+#if (!(R_DRAWCOLUMN_PIPELINE & (RDC_TRANSLATED | RDC_NOCOLMAP)))
+    // Power of 2 textures, 128 included, can use a vectorized drawer
+    if (R_DrawColumnKernel && dcvars->texheight &&
+        !(dcvars->texheight & (dcvars->texheight - 1))) {
+      R_DrawColumnKernel(dest, source, colormap, count, frac, fracstep,
+                         ((dcvars->texheight - 1) << FRACBITS) | 0xffff);
+      return;
+    }
+#endif
+
     // Inner loop that does the actual texture mapping,
     //  e.g. a DDA-lile scaling.
     // This is as fast as it gets.       (Yeah, right!!! -- killough)
@@ -56,6 +56,14 @@ static void R_FLUSHWHOLE_FUNCNAME(void)
       dest   = drawvars.topleft + yl*drawvars.pitch + startx + temp_x;
       count  = tempyh[temp_x] - yl + 1;
 
+      if (R_ColumnClipped(startx + temp_x))
+      {
+#if (R_DRAWCOLUMN_PIPELINE & RDC_FUZZ)
+         fuzzpos = (fuzzpos + count) % FUZZTABLE;
+#endif
+         continue;
+      }
+
       while(--count >= 0)
       {
 #if (R_DRAWCOLUMN_PIPELINE & RDC_TRANSLUCENT)
@@ -96,6 +104,18 @@ static void R_FLUSHHEADTAIL_FUNCNAME(void)
       yl = tempyl[colnum];
       yh = tempyh[colnum];
 
+      if (R_ColumnClipped(startx + colnum))
+      {
+#if (R_DRAWCOLUMN_PIPELINE & RDC_FUZZ)
+         if(yl < commontop)
+            fuzzpos = (fuzzpos + commontop - yl) % FUZZTABLE;
+         if(yh > commonbot)
+            fuzzpos = (fuzzpos + yh - commonbot) % FUZZTABLE;
+#endif
+         ++colnum;
+         continue;
+      }
+
       // flush column head
       if(yl < commontop)
       {
@@ -171,6 +191,38 @@ static void R_FLUSHQUAD_FUNCNAME(void)
 
    count = commonbot - commontop + 1;
 
+   // The quad straddles a slice edge: flush only the columns inside it.
+   // Each column only reads its own pixels, so the order is unimportant.
+   if (R_ColumnClipped(startx) || R_ColumnClipped(startx + 3))
+   {
+      int colnum, n;
+
+      for (colnum = 0; colnum < 4; ++colnum)
+      {
+#if (R_DRAWCOLUMN_PIPELINE & RDC_FUZZ)
+         int fuzz = colnum == 0 ? fuzz1 : colnum == 1 ? fuzz2 : colnum == 2 ? fuzz3 : fuzz4;
+#endif
+
+         if (R_ColumnClipped(startx + colnum))
+            continue;
+
+         for (n = 0; n < count; ++n)
+         {
+            byte *d = dest + n * drawvars.pitch + colnum;
+#if (R_DRAWCOLUMN_PIPELINE & RDC_TRANSLUCENT)
+            *d = GETDESTCOLOR(*d, source[(n << 2) + colnum]);
+#elif (R_DRAWCOLUMN_PIPELINE & RDC_FUZZ)
+            *d = GETDESTCOLOR(d[fuzzoffset[fuzz]]);
+            fuzz = (fuzz + 1) % FUZZTABLE;
+#else
+            *d = source[(n << 2) + colnum];
+#endif
+         }
+      }
+
+      return;
+   }
+
 #if (R_DRAWCOLUMN_PIPELINE & RDC_TRANSLUCENT)
    while(--count >= 0)
    {
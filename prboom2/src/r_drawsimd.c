@@ -0,0 +1,459 @@
+/* Emacs style mode select   -*- C -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Vectorized span and column drawers, chosen at startup
+ *      from the instruction sets the cpu reports.
+ *
+ *      The texture and colormap reads are table lookups, so they stay
+ *      scalar. What is vectorized is the texture coordinate stepping
+ *      and masking, which is most of the remaining work per pixel.
+ *      Every variant must produce exactly the same pixels as the
+ *      scalar drawers, which -bench_drawers checks.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "doomtype.h"
+#include "m_fixed.h"
+#include "lprintf.h"
+#include "r_drawsimd.h"
+
+#include "dsda/time.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define R_SIMD_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define R_SIMD_ARM
+#include <arm_neon.h>
+#endif
+
+// Let gcc and clang build the vector code without raising the baseline
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+#define SPAN_SPOT(xfrac, yfrac) ((((xfrac) >> 16) & 63) | (((yfrac) >> 10) & 4032))
+
+static void R_DrawSpanScalar(byte *dest, const byte *source, const lighttable_t *colormap,
+                             int count, fixed_t xfrac, fixed_t yfrac,
+                             fixed_t xstep, fixed_t ystep)
+{
+  while (count-- > 0) {
+    const fixed_t spot = SPAN_SPOT(xfrac, yfrac);
+    xfrac += xstep;
+    yfrac += ystep;
+    *dest++ = colormap[source[spot]];
+  }
+}
+
+static void R_DrawColumnScalar(byte *dest, const byte *source, const lighttable_t *colormap,
+                               int count, fixed_t frac, fixed_t fracstep, fixed_t mask)
+{
+  while (count-- > 0) {
+    *dest = colormap[source[(frac & mask) >> FRACBITS]];
+    dest += 4;
+    frac += fracstep;
+  }
+}
+
+// Lane i starts i steps ahead; the stepping wraps like the scalar code
+#define LANE(frac, step, i) ((int) ((unsigned) (frac) + (i) * (unsigned) (step)))
+
+#ifdef R_SIMD_X86
+
+TARGET_SSE2 static void R_DrawSpanSSE2(byte *dest, const byte *source, const lighttable_t *colormap,
+                                       int count, fixed_t xfrac, fixed_t yfrac,
+                                       fixed_t xstep, fixed_t ystep)
+{
+  if (count >= 8) {
+    const __m128i xmask = _mm_set1_epi32(63);
+    const __m128i ymask = _mm_set1_epi32(4032);
+    const __m128i xstep4 = _mm_set1_epi32(LANE(0, xstep, 4));
+    const __m128i ystep4 = _mm_set1_epi32(LANE(0, ystep, 4));
+    __m128i xf = _mm_setr_epi32(xfrac, LANE(xfrac, xstep, 1), LANE(xfrac, xstep, 2), LANE(xfrac, xstep, 3));
+    __m128i yf = _mm_setr_epi32(yfrac, LANE(yfrac, ystep, 1), LANE(yfrac, ystep, 2), LANE(yfrac, ystep, 3));
+    unsigned int spot[8];
+    int i;
+
+    while (count >= 8) {
+      for (i = 0; i < 8; i += 4) {
+        __m128i s = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(xf, 16), xmask),
+                                 _mm_and_si128(_mm_srli_epi32(yf, 10), ymask));
+        _mm_storeu_si128((__m128i *) &spot[i], s);
+        xf = _mm_add_epi32(xf, xstep4);
+        yf = _mm_add_epi32(yf, ystep4);
+      }
+
+      for (i = 0; i < 8; ++i)
+        dest[i] = colormap[source[spot[i]]];
+
+      dest += 8;
+      count -= 8;
+    }
+
+    xfrac = _mm_cvtsi128_si32(xf);
+    yfrac = _mm_cvtsi128_si32(yf);
+  }
+
+  R_DrawSpanScalar(dest, source, colormap, count, xfrac, yfrac, xstep, ystep);
+}
+
+TARGET_SSE2 static void R_DrawColumnSSE2(byte *dest, const byte *source, const lighttable_t *colormap,
+                                         int count, fixed_t frac, fixed_t fracstep, fixed_t mask)
+{
+  if (count >= 8) {
+    const __m128i vmask = _mm_set1_epi32(mask);
+    const __m128i step4 = _mm_set1_epi32(LANE(0, fracstep, 4));
+    __m128i f = _mm_setr_epi32(frac, LANE(frac, fracstep, 1), LANE(frac, fracstep, 2), LANE(frac, fracstep, 3));
+    unsigned int spot[8];
+    int i;
+
+    while (count >= 8) {
+      for (i = 0; i < 8; i += 4) {
+        _mm_storeu_si128((__m128i *) &spot[i], _mm_srli_epi32(_mm_and_si128(f, vmask), FRACBITS));
+        f = _mm_add_epi32(f, step4);
+      }
+
+      for (i = 0; i < 8; ++i)
+        dest[i << 2] = colormap[source[spot[i]]];
+
+      dest += 32;
+      count -= 8;
+    }
+
+    frac = _mm_cvtsi128_si32(f);
+  }
+
+  R_DrawColumnScalar(dest, source, colormap, count, frac, fracstep, mask);
+}
+
+TARGET_AVX2 static void R_DrawSpanAVX2(byte *dest, const byte *source, const lighttable_t *colormap,
+                                       int count, fixed_t xfrac, fixed_t yfrac,
+                                       fixed_t xstep, fixed_t ystep)
+{
+  if (count >= 16) {
+    const __m256i xmask = _mm256_set1_epi32(63);
+    const __m256i ymask = _mm256_set1_epi32(4032);
+    const __m256i xstep8 = _mm256_set1_epi32(LANE(0, xstep, 8));
+    const __m256i ystep8 = _mm256_set1_epi32(LANE(0, ystep, 8));
+    __m256i xf = _mm256_setr_epi32(
+      xfrac, LANE(xfrac, xstep, 1), LANE(xfrac, xstep, 2), LANE(xfrac, xstep, 3),
+      LANE(xfrac, xstep, 4), LANE(xfrac, xstep, 5), LANE(xfrac, xstep, 6), LANE(xfrac, xstep, 7)
+    );
+    __m256i yf = _mm256_setr_epi32(
+      yfrac, LANE(yfrac, ystep, 1), LANE(yfrac, ystep, 2), LANE(yfrac, ystep, 3),
+      LANE(yfrac, ystep, 4), LANE(yfrac, ystep, 5), LANE(yfrac, ystep, 6), LANE(yfrac, ystep, 7)
+    );
+    unsigned int spot[16];
+    int i;
+
+    while (count >= 16) {
+      for (i = 0; i < 16; i += 8) {
+        __m256i s = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(xf, 16), xmask),
+                                    _mm256_and_si256(_mm256_srli_epi32(yf, 10), ymask));
+        _mm256_storeu_si256((__m256i *) &spot[i], s);
+        xf = _mm256_add_epi32(xf, xstep8);
+        yf = _mm256_add_epi32(yf, ystep8);
+      }
+
+      for (i = 0; i < 16; ++i)
+        dest[i] = colormap[source[spot[i]]];
+
+      dest += 16;
+      count -= 16;
+    }
+
+    xfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(xf));
+    yfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(yf));
+  }
+
+  R_DrawSpanScalar(dest, source, colormap, count, xfrac, yfrac, xstep, ystep);
+}
+
+TARGET_AVX2 static void R_DrawColumnAVX2(byte *dest, const byte *source, const lighttable_t *colormap,
+                                         int count, fixed_t frac, fixed_t fracstep, fixed_t mask)
+{
+  if (count >= 16) {
+    const __m256i vmask = _mm256_set1_epi32(mask);
+    const __m256i step8 = _mm256_set1_epi32(LANE(0, fracstep, 8));
+    __m256i f = _mm256_setr_epi32(
+      frac, LANE(frac, fracstep, 1), LANE(frac, fracstep, 2), LANE(frac, fracstep, 3),
+      LANE(frac, fracstep, 4), LANE(frac, fracstep, 5), LANE(frac, fracstep, 6), LANE(frac, fracstep, 7)
+    );
+    unsigned int spot[16];
+    int i;
+
+    while (count >= 16) {
+      for (i = 0; i < 16; i += 8) {
+        _mm256_storeu_si256((__m256i *) &spot[i], _mm256_srli_epi32(_mm256_and_si256(f, vmask), FRACBITS));
+        f = _mm256_add_epi32(f, step8);
+      }
+
+      for (i = 0; i < 16; ++i)
+        dest[i << 2] = colormap[source[spot[i]]];
+
+      dest += 64;
+      count -= 16;
+    }
+
+    frac = _mm_cvtsi128_si32(_mm256_castsi256_si128(f));
+  }
+
+  R_DrawColumnScalar(dest, source, colormap, count, frac, fracstep, mask);
+}
+
+#endif // R_SIMD_X86
+
+#ifdef R_SIMD_ARM
+
+static void R_DrawSpanNEON(byte *dest, const byte *source, const lighttable_t *colormap,
+                           int count, fixed_t xfrac, fixed_t yfrac,
+                           fixed_t xstep, fixed_t ystep)
+{
+  if (count >= 8) {
+    const uint32x4_t xmask = vdupq_n_u32(63);
+    const uint32x4_t ymask = vdupq_n_u32(4032);
+    const uint32x4_t xstep4 = vdupq_n_u32(LANE(0, xstep, 4));
+    const uint32x4_t ystep4 = vdupq_n_u32(LANE(0, ystep, 4));
+    const unsigned int xinit[4] = {
+      xfrac, LANE(xfrac, xstep, 1), LANE(xfrac, xstep, 2), LANE(xfrac, xstep, 3)
+    };
+    const unsigned int yinit[4] = {
+      yfrac, LANE(yfrac, ystep, 1), LANE(yfrac, ystep, 2), LANE(yfrac, ystep, 3)
+    };
+    uint32x4_t xf = vld1q_u32(xinit);
+    uint32x4_t yf = vld1q_u32(yinit);
+    unsigned int spot[8];
+    int i;
+
+    while (count >= 8) {
+      for (i = 0; i < 8; i += 4) {
+        vst1q_u32(&spot[i], vorrq_u32(vandq_u32(vshrq_n_u32(xf, 16), xmask),
+                                      vandq_u32(vshrq_n_u32(yf, 10), ymask)));
+        xf = vaddq_u32(xf, xstep4);
+        yf = vaddq_u32(yf, ystep4);
+      }
+
+      for (i = 0; i < 8; ++i)
+        dest[i] = colormap[source[spot[i]]];
+
+      dest += 8;
+      count -= 8;
+    }
+
+    xfrac = (fixed_t) vgetq_lane_u32(xf, 0);
+    yfrac = (fixed_t) vgetq_lane_u32(yf, 0);
+  }
+
+  R_DrawSpanScalar(dest, source, colormap, count, xfrac, yfrac, xstep, ystep);
+}
+
+static void R_DrawColumnNEON(byte *dest, const byte *source, const lighttable_t *colormap,
+                             int count, fixed_t frac, fixed_t fracstep, fixed_t mask)
+{
+  if (count >= 8) {
+    const uint32x4_t vmask = vdupq_n_u32(mask);
+    const uint32x4_t step4 = vdupq_n_u32(LANE(0, fracstep, 4));
+    const unsigned int init[4] = {
+      frac, LANE(frac, fracstep, 1), LANE(frac, fracstep, 2), LANE(frac, fracstep, 3)
+    };
+    uint32x4_t f = vld1q_u32(init);
+    unsigned int spot[8];
+    int i;
+
+    while (count >= 8) {
+      for (i = 0; i < 8; i += 4) {
+        vst1q_u32(&spot[i], vshrq_n_u32(vandq_u32(f, vmask), FRACBITS));
+        f = vaddq_u32(f, step4);
+      }
+
+      for (i = 0; i < 8; ++i)
+        dest[i << 2] = colormap[source[spot[i]]];
+
+      dest += 32;
+      count -= 8;
+    }
+
+    frac = (fixed_t) vgetq_lane_u32(f, 0);
+  }
+
+  R_DrawColumnScalar(dest, source, colormap, count, frac, fracstep, mask);
+}
+
+#endif // R_SIMD_ARM
+
+typedef struct {
+  const char *name;
+  R_DrawSpanKernel_f span;
+  R_DrawColumnKernel_f column;
+} simd_drawers_t;
+
+static const simd_drawers_t simd_drawers[R_SIMD_MAX] = {
+  [R_SIMD_NONE] = { "scalar", R_DrawSpanScalar, R_DrawColumnScalar },
+#ifdef R_SIMD_X86
+  [R_SIMD_SSE2] = { "sse2", R_DrawSpanSSE2, R_DrawColumnSSE2 },
+  [R_SIMD_AVX2] = { "avx2", R_DrawSpanAVX2, R_DrawColumnAVX2 },
+#endif
+#ifdef R_SIMD_ARM
+  [R_SIMD_NEON] = { "neon", R_DrawSpanNEON, R_DrawColumnNEON },
+#endif
+};
+
+R_DrawSpanKernel_f R_DrawSpanKernel = R_DrawSpanScalar;
+R_DrawColumnKernel_f R_DrawColumnKernel;
+
+static dboolean R_SIMDSupported(r_simd_t simd)
+{
+  if (!simd_drawers[simd].span)
+    return false;
+
+  switch (simd)
+  {
+    case R_SIMD_SSE2:
+      return SDL_HasSSE2();
+    case R_SIMD_AVX2:
+      return SDL_HasAVX2();
+    case R_SIMD_NEON:
+      return SDL_HasNEON();
+    default:
+      return true;
+  }
+}
+
+void R_InitSIMDDrawers(void)
+{
+  int simd;
+
+  for (simd = R_SIMD_MAX - 1; simd > R_SIMD_NONE; --simd)
+    if (R_SIMDSupported(simd))
+      break;
+
+  R_DrawSpanKernel = simd_drawers[simd].span;
+
+  // The scalar column loop is inlined in every column drawer
+  R_DrawColumnKernel = (simd == R_SIMD_NONE ? NULL : simd_drawers[simd].column);
+
+  lprintf(LO_DEBUG, "R_InitSIMDDrawers: using %s drawers\n", simd_drawers[simd].name);
+}
+
+//
+// R_BenchmarkDrawers
+//
+// Times every supported drawer on random flats and columns, and checks
+// that each one writes the same pixels as the scalar drawers.
+//
+
+#define BENCH_LENGTH 2048
+#define BENCH_RUNS 2048
+#define BENCH_COLUMN_HEIGHT 128
+
+void R_BenchmarkDrawers(void)
+{
+  byte *source, *colormap, *expected, *result;
+  fixed_t *params;
+  int simd, run, i;
+
+  source = malloc(64 * 64 + BENCH_COLUMN_HEIGHT);
+  colormap = malloc(256);
+  expected = malloc(BENCH_RUNS * BENCH_LENGTH * 2);
+  result = malloc(BENCH_RUNS * BENCH_LENGTH * 2);
+  params = malloc(BENCH_RUNS * 4 * sizeof(*params));
+
+  if (!source || !colormap || !expected || !result || !params)
+    I_Error("R_BenchmarkDrawers: out of memory");
+
+  srand(1);
+
+  for (i = 0; i < 64 * 64 + BENCH_COLUMN_HEIGHT; ++i)
+    source[i] = rand() & 255;
+
+  for (i = 0; i < 256; ++i)
+    colormap[i] = rand() & 255;
+
+  // Steps of all sizes and signs, including ones that wrap
+  for (i = 0; i < BENCH_RUNS * 4; ++i)
+    params[i] = (fixed_t) (((unsigned) rand() << 17) ^ ((unsigned) rand() << 2) ^ (unsigned) rand());
+
+  lprintf(LO_INFO, "\nDrawer benchmark (%d runs of %d pixels):\n", BENCH_RUNS, BENCH_LENGTH);
+
+  for (simd = R_SIMD_NONE; simd < R_SIMD_MAX; ++simd) {
+    const simd_drawers_t *drawers = &simd_drawers[simd];
+    byte *output = (simd == R_SIMD_NONE ? expected : result);
+    unsigned long long span_time, column_time;
+
+    if (!R_SIMDSupported(simd))
+      continue;
+
+    memset(output, 0, BENCH_RUNS * BENCH_LENGTH * 2);
+
+    span_time = dsda_MonotonicTime();
+
+    for (run = 0; run < BENCH_RUNS; ++run) {
+      const fixed_t *p = &params[run * 4];
+
+      drawers->span(output + run * BENCH_LENGTH, source, colormap,
+                    BENCH_LENGTH - (run & 31), p[0], p[1], p[2] >> 4, p[3] >> 4);
+    }
+
+    span_time = dsda_MonotonicTime() - span_time;
+    column_time = dsda_MonotonicTime();
+
+    for (run = 0; run < BENCH_RUNS; ++run) {
+      const fixed_t *p = &params[run * 4];
+      byte *dest = output + BENCH_RUNS * BENCH_LENGTH + run * BENCH_LENGTH + (run & 3);
+
+      drawers->column(dest, source, colormap, BENCH_LENGTH / 4 - (run & 31),
+                      p[0], p[1] >> 8, ((BENCH_COLUMN_HEIGHT - 1) << FRACBITS) | 0xffff);
+    }
+
+    column_time = dsda_MonotonicTime() - column_time;
+
+    lprintf(LO_INFO, "  %-8s span %6.2f ns/pixel, column %6.2f ns/pixel%s\n",
+            drawers->name,
+            span_time * 1000.0 / (BENCH_RUNS * BENCH_LENGTH),
+            column_time * 1000.0 / (BENCH_RUNS * BENCH_LENGTH / 4),
+            output == result && memcmp(expected, result, BENCH_RUNS * BENCH_LENGTH * 2) ?
+              " (MISMATCH)" : "");
+  }
+
+  free(source);
+  free(colormap);
+  free(expected);
+  free(result);
+  free(params);
+}
@@ -0,0 +1,65 @@
+/* Emacs style mode select   -*- C -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Vectorized span and column drawers, chosen at startup
+ *      from the instruction sets the cpu reports.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __R_DRAWSIMD__
+#define __R_DRAWSIMD__
+
+#include "r_defs.h"
+
+typedef enum {
+  R_SIMD_NONE,
+  R_SIMD_SSE2,
+  R_SIMD_AVX2,
+  R_SIMD_NEON,
+  R_SIMD_MAX,
+} r_simd_t;
+
+// Draws count pixels of a 64x64 flat along a row
+typedef void (*R_DrawSpanKernel_f)(byte *dest, const byte *source, const lighttable_t *colormap,
+                                   int count, fixed_t xfrac, fixed_t yfrac,
+                                   fixed_t xstep, fixed_t ystep);
+
+// Draws count pixels of a power of 2 column into the column buffer (stride 4)
+typedef void (*R_DrawColumnKernel_f)(byte *dest, const byte *source, const lighttable_t *colormap,
+                                     int count, fixed_t frac, fixed_t fracstep, fixed_t mask);
+
+extern R_DrawSpanKernel_f R_DrawSpanKernel;
+
+// NULL when the scalar loop in the column drawer should be used
+extern R_DrawColumnKernel_f R_DrawColumnKernel;
+
+void R_InitSIMDDrawers(void);
+void R_BenchmarkDrawers(void);
+
+#endif
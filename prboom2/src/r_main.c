@@ -46,6 +46,7 @@
 #include "r_plane.h"
 #include "r_bsp.h"
 #include "r_draw.h"
+#include "r_drawsimd.h"
 #include "m_bbox.h"
 #include "r_sky.h"
 #include "v_video.h"
@@ -61,10 +62,12 @@
 #include "e6y.h"//e6y
 #include "xs_Float.h"
 
+#include "dsda/args.h"
 #include "dsda/configuration.h"
 #include "dsda/exhud.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
+#include "dsda/profiler.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
@@ -761,6 +764,8 @@ void R_ExecuteSetViewSize (void)
 
 void R_Init (void)
 {
+  zone_category_t category = Z_SetCategory(ZONE_CAT_RENDERER);
+
   // CPhipps - R_DrawColumn isn't constant anymore, so must
   //  initialise in code
   // current column draw function
@@ -779,6 +784,13 @@ void R_Init (void)
   R_InitTranslationTables();
   lprintf(LO_DEBUG, "R_InitPatches ");
   R_InitPatches();
+  lprintf(LO_DEBUG, "R_InitSIMDDrawers ");
+  R_InitSIMDDrawers();
+
+  if (dsda_Flag(dsda_arg_bench_drawers))
+    R_BenchmarkDrawers();
+
+  Z_SetCategory(category);
 }
 
 //
@@ -1042,6 +1054,8 @@ static void R_RenderBSPNodes(void)
 
 void R_RenderPlayerView (player_t* player)
 {
+  dboolean sliced;
+
   r_frame_count++;
 
   DSDA_ADD_CONTEXT(sf_setup_frame);
@@ -1061,6 +1075,8 @@ void R_RenderPlayerView (player_t* player)
 
   FakeNetUpdate();
 
+  sliced = V_IsSoftwareMode() && R_BeginSlicedDraw();
+
   if (V_IsOpenGLMode()) {
     DSDA_ADD_CONTEXT(sf_gl_frustum);
     gld_FrustumSetup();
@@ -1068,7 +1084,9 @@ void R_RenderPlayerView (player_t* player)
   }
 
   DSDA_ADD_CONTEXT(sf_bsp_nodes);
+  DSDA_PROFILE_BEGIN(dsda_profile_bsp_nodes);
   R_RenderBSPNodes();
+  DSDA_PROFILE_END(dsda_profile_bsp_nodes);
   DSDA_REMOVE_CONTEXT(sf_bsp_nodes);
 
   FakeNetUpdate();
@@ -1076,7 +1094,9 @@ void R_RenderPlayerView (player_t* player)
   if (V_IsSoftwareMode())
   {
     DSDA_ADD_CONTEXT(sf_draw_planes);
+    DSDA_PROFILE_BEGIN(dsda_profile_draw_planes);
     R_DrawPlanes();
+    DSDA_PROFILE_END(dsda_profile_draw_planes);
     DSDA_REMOVE_CONTEXT(sf_draw_planes);
   }
 
@@ -1088,11 +1108,19 @@ void R_RenderPlayerView (player_t* player)
 
   if (V_IsSoftwareMode()) {
     DSDA_ADD_CONTEXT(sf_draw_masked);
+    DSDA_PROFILE_BEGIN(dsda_profile_draw_masked);
     R_DrawMasked ();
     R_ResetColumnBuffer();
+    DSDA_PROFILE_END(dsda_profile_draw_masked);
     DSDA_REMOVE_CONTEXT(sf_draw_masked);
   }
 
+  if (sliced) {
+    DSDA_ADD_CONTEXT(sf_draw_slices);
+    R_FinishSlicedDraw();
+    DSDA_REMOVE_CONTEXT(sf_draw_slices);
+  }
+
   FakeNetUpdate();
 
   if (V_IsOpenGLMode() && !automap_on) {
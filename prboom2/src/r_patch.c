@@ -74,6 +74,7 @@
 #include <assert.h>
 
 #include "dsda/palette.h"
+#include "dsda/thread_pool.h"
 
 // posts are runs of non masked source pixels
 typedef struct
@@ -108,6 +109,11 @@ static rpatch_t *patches = 0;
 
 static rpatch_t *texture_composites = 0;
 
+// the background precache batch holding each pending patch and composite
+typedef struct precache_batch_s precache_batch_t;
+static precache_batch_t **patch_batches;
+static precache_batch_t **composite_batches;
+
 // indices of two duplicate PLAYPAL entries, second is -1 if none found
 static int playpal_transparent, playpal_duplicate;
 
@@ -129,6 +135,10 @@ void R_InitPatches(void) {
     // clear out new patches to signal they're uninitialized
     memset(texture_composites, 0, sizeof(rpatch_t)*numtextures);
   }
+  if (!patch_batches)
+    patch_batches = Z_Calloc(numlumps, sizeof(*patch_batches));
+  if (!composite_batches)
+    composite_batches = Z_Calloc(numtextures, sizeof(*composite_batches));
 
   dsda_InitPlayPal();
   R_UpdatePlayPal();
@@ -137,6 +147,9 @@ void R_InitPatches(void) {
 void R_UpdatePlayPal(void) {
   dsda_playpal_t* playpal_data;
 
+  // the workers read the transparent indices
+  R_FinishPrecache();
+
   playpal_data = dsda_PlayPalData();
   playpal_transparent = playpal_data->transparent;
   playpal_duplicate = playpal_data->duplicate;
@@ -148,6 +161,8 @@ void R_UpdatePlayPal(void) {
 void R_FlushAllPatches(void) {
   int i;
 
+  R_FinishPrecache();
+
   if (patches)
   {
     Z_Free(patches);
@@ -233,7 +248,31 @@ static int getColumnEdgeSlope(const column_t *prevcolumn, const column_t *nextco
 }
 
 //---------------------------------------------------------------------------
-static void FillEmptySpace(rpatch_t *patch)
+// The patch builders run on the precache workers when worker is set.
+// The zone and I_Error are only safe on the main thread, so a worker
+// allocates with malloc, reads lumps resolved for it beforehand, and
+// reports a failure through its return value. The main thread copies
+// the result into the zone and reports any error when it adopts it.
+static void *PatchMalloc(size_t size, dboolean worker)
+{
+  return worker ? malloc(size) : Z_Malloc(size);
+}
+
+static void *PatchCalloc(size_t n, size_t size, dboolean worker)
+{
+  return worker ? calloc(n, size) : Z_Calloc(n, size);
+}
+
+static void PatchFree(void *ptr, dboolean worker)
+{
+  if (worker)
+    free(ptr);
+  else
+    Z_Free(ptr);
+}
+
+//---------------------------------------------------------------------------
+static dboolean FillEmptySpace(rpatch_t *patch, dboolean worker)
 {
   int x, y, w, h, numpix, pass, transparent, has_holes;
   byte *orig, *copy, *src, *dest, *prev, *next;
@@ -249,7 +288,9 @@ static void FillEmptySpace(rpatch_t *patch)
 
   // alternate between two buffers to avoid "overlapping memcpy"-like symptoms
   orig = patch->pixels;
-  copy = Z_Malloc(numpix);
+  copy = PatchMalloc(numpix, worker);
+  if (!copy && numpix)
+    return false;
 
   for (pass = 0; pass < 8; pass++) // arbitrarily chosen limit (must be even)
   {
@@ -301,7 +342,7 @@ static void FillEmptySpace(rpatch_t *patch)
       break; // avoid infinite loop on entirely transparent patches
   }
 
-  Z_Free(copy);
+  PatchFree(copy, worker);
 
   // copy top row of patch into any space at bottom, and vice versa
   // a hack to fix erroneous row of pixels at top of firing chaingun
@@ -316,6 +357,8 @@ static void FillEmptySpace(rpatch_t *patch)
 
   if (has_holes)
     patch->flags |= PATCH_HASHOLES;
+
+  return true;
 }
 
 //==========================================================================
@@ -337,7 +380,7 @@ static dboolean CheckIfPatch(int lump)
   if (size < 13)
     return false;
 
-  patch = (const patch_t *)W_LumpByNum(lump);
+  patch = (const patch_t *)W_BorrowLumpNum(lump);
 
   width = LittleShort(patch->width);
   height = LittleShort(patch->height);
@@ -365,6 +408,8 @@ static dboolean CheckIfPatch(int lump)
     }
   }
 
+  W_ReturnLumpNum(lump);
+
   return result;
 }
 
@@ -378,10 +423,8 @@ static void StorePixel(rpatch_t *patch, int x, int y, byte color)
 }
 
 //---------------------------------------------------------------------------
-static void createPatch(int id) {
-  rpatch_t *patch;
-  const int patchNum = id;
-  const patch_t *oldPatch;
+// Returns the size of the patch data, or 0 if a worker ran out of memory.
+static int createPatch(int id, rpatch_t *patch, const patch_t *oldPatch, dboolean worker) {
   const column_t *oldColumn, *oldPrevColumn, *oldNextColumn;
   int x, y;
   int pixelDataSize;
@@ -394,20 +437,6 @@ static void createPatch(int id) {
   int numPostsUsedSoFar;
   int edgeSlope;
 
-#ifdef RANGECHECK
-  if (id >= numlumps)
-    I_Error("createPatch: %i >= numlumps", id);
-#endif
-
-  if (!CheckIfPatch(patchNum))
-  {
-    I_Error("createPatch: Unknown patch format %s.",
-      (patchNum < numlumps ? lumpinfo[patchNum].name : NULL));
-  }
-
-  oldPatch = (const patch_t*)W_LumpByNum(patchNum);
-
-  patch = &patches[id];
   // proff - 2003-02-16 What about endianess?
   patch->width = LittleShort(oldPatch->width);
   patch->widthmask = 0;
@@ -434,7 +463,9 @@ static void createPatch(int id) {
   columnsDataSize = sizeof(rcolumn_t) * patch->width;
 
   // count the number of posts in each column
-  numPostsInColumn = Z_Malloc(sizeof(int) * patch->width);
+  numPostsInColumn = PatchMalloc(sizeof(int) * patch->width, worker);
+  if (!numPostsInColumn)
+    return 0;
   numPostsTotal = 0;
 
   for (x=0; x<patch->width; x++) {
@@ -451,7 +482,12 @@ static void createPatch(int id) {
 
   // allocate our data chunk
   dataSize = pixelDataSize + columnsDataSize + postsDataSize;
-  patch->data = (unsigned char*) Z_Malloc(dataSize);
+  patch->data = (unsigned char*) PatchMalloc(dataSize, worker);
+  if (!patch->data)
+  {
+    PatchFree(numPostsInColumn, worker);
+    return 0;
+  }
   memset(patch->data, 0, dataSize);
 
   // set out pixel, column, and post pointers into our data array
@@ -539,9 +575,16 @@ static void createPatch(int id) {
     }
   }
 
-  FillEmptySpace(patch);
+  PatchFree(numPostsInColumn, worker);
 
-  Z_Free(numPostsInColumn);
+  if (!FillEmptySpace(patch, worker))
+  {
+    PatchFree(patch->data, worker);
+    patch->data = NULL;
+    return 0;
+  }
+
+  return dataSize;
 }
 
 typedef struct {
@@ -564,11 +607,11 @@ static void switchPosts(rpost_t *post1, rpost_t *post2) {
   post2->slope = dummy.slope;
 }
 
-static void removePostFromColumn(rcolumn_t *column, int post) {
+static dboolean removePostFromColumn(rcolumn_t *column, int post) {
   int i;
 #ifdef RANGECHECK
   if (post >= column->numPosts)
-    I_Error("removePostFromColumn: invalid post index");
+    return false;
 #endif
   if (post < column->numPosts)
     for (i=post; i<(column->numPosts-1); i++) {
@@ -579,14 +622,17 @@ static void removePostFromColumn(rcolumn_t *column, int post) {
       post1->slope = post2->slope;
     }
   column->numPosts--;
+
+  return true;
 }
 
 //---------------------------------------------------------------------------
-static void createTextureCompositePatch(int id) {
-  rpatch_t *composite_patch;
+// Returns the size of the patch data, 0 if a worker ran out of memory,
+// or -1 if a worker found an invalid post.
+static int createTextureCompositePatch(int id, rpatch_t *composite_patch,
+                                       const patch_t **oldPatches, dboolean worker) {
   texture_t *texture;
   texpatch_t *texpatch;
-  int patchNum;
   const patch_t *oldPatch;
   const column_t *oldColumn, *oldPrevColumn, *oldNextColumn;
   int i, x, y;
@@ -601,13 +647,6 @@ static void createTextureCompositePatch(int id) {
   int edgeSlope;
   count_t *countsInColumn;
 
-#ifdef RANGECHECK
-  if (id >= numtextures)
-    I_Error("createTextureCompositePatch: %i >= numtextures", id);
-#endif
-
-  composite_patch = &texture_composites[id];
-
   texture = textures[id];
 
   composite_patch->width = texture->width;
@@ -622,13 +661,14 @@ static void createTextureCompositePatch(int id) {
   columnsDataSize = sizeof(rcolumn_t) * composite_patch->width;
 
   // count the number of posts in each column
-  countsInColumn = (count_t *)Z_Calloc(sizeof(count_t), composite_patch->width);
+  countsInColumn = (count_t *)PatchCalloc(sizeof(count_t), composite_patch->width, worker);
+  if (!countsInColumn && composite_patch->width)
+    return 0;
   numPostsTotal = 0;
 
   for (i=0; i<texture->patchcount; i++) {
     texpatch = &texture->patches[i];
-    patchNum = texpatch->patch;
-    oldPatch = (const patch_t*)W_LumpByNum(patchNum);
+    oldPatch = oldPatches[i];
 
     for (x=0; x<LittleShort(oldPatch->width); x++) {
       int tx = texpatch->originx + x;
@@ -653,7 +693,12 @@ static void createTextureCompositePatch(int id) {
 
   // allocate our data chunk
   dataSize = pixelDataSize + columnsDataSize + postsDataSize;
-  composite_patch->data = (unsigned char*) Z_Malloc(dataSize);
+  composite_patch->data = (unsigned char*) PatchMalloc(dataSize, worker);
+  if (!composite_patch->data)
+  {
+    PatchFree(countsInColumn, worker);
+    return 0;
+  }
   memset(composite_patch->data, 0, dataSize);
 
   // set out pixel, column, and post pointers into our data array
@@ -681,8 +726,7 @@ static void createTextureCompositePatch(int id) {
   // fill in the pixels, posts, and columns
   for (i=0; i<texture->patchcount; i++) {
     texpatch = &texture->patches[i];
-    patchNum = texpatch->patch;
-    oldPatch = (const patch_t*)W_LumpByNum(patchNum);
+    oldPatch = oldPatches[i];
 
     for (x=0; x<LittleShort(oldPatch->width); x++) {
       int top = -1;
@@ -813,7 +857,16 @@ static void createTextureCompositePatch(int id) {
           post1->slope = post2->slope;
           post1->length = length;
         }
-        removePostFromColumn(column, i+1);
+        if (!removePostFromColumn(column, i+1))
+        {
+          if (!worker)
+            I_Error("removePostFromColumn: invalid post index");
+
+          PatchFree(countsInColumn, worker);
+          PatchFree(composite_patch->data, worker);
+          composite_patch->data = NULL;
+          return -1;
+        }
         i = 0;
         continue;
       }
@@ -821,9 +874,252 @@ static void createTextureCompositePatch(int id) {
     }
   }
 
-  FillEmptySpace(composite_patch);
+  PatchFree(countsInColumn, worker);
+
+  if (!FillEmptySpace(composite_patch, worker))
+  {
+    PatchFree(composite_patch->data, worker);
+    composite_patch->data = NULL;
+    return 0;
+  }
+
+  return dataSize;
+}
+
+//---------------------------------------------------------------------------
+static const patch_t **R_BorrowTextureLumps(const texture_t *texture)
+{
+  const patch_t **lumps;
+  int i;
+
+  lumps = Z_Malloc(texture->patchcount * sizeof(*lumps));
+
+  for (i = 0; i < texture->patchcount; i++)
+    lumps[i] = W_BorrowLumpNum(texture->patches[i].patch);
+
+  return lumps;
+}
+
+static void R_ReturnTextureLumps(const texture_t *texture, const patch_t **lumps)
+{
+  int i;
+
+  for (i = 0; i < texture->patchcount; i++)
+    W_ReturnLumpNum(texture->patches[i].patch);
+
+  Z_Free(lumps);
+}
+
+//---------------------------------------------------------------------------
+// Background precaching
+//
+// Patches and composites needed by a level are built in small batches on the
+// thread pool. Each result is adopted by the main thread the first time
+// something in its batch is needed.
+//---------------------------------------------------------------------------
+
+#define PRECACHE_BATCH_SIZE 8
+
+typedef struct {
+  int id;
+  dboolean composite;
+  const patch_t *lump;
+  const patch_t **lumps;
+  int size;
+  rpatch_t patch;
+} precache_item_t;
+
+struct precache_batch_s {
+  dsda_task_group_t group;
+  dboolean queued;
+  dboolean adopted;
+  int count;
+  precache_item_t items[PRECACHE_BATCH_SIZE];
+};
+
+static precache_batch_t **precache_batches;
+static int precache_batch_count;
+static int precache_batch_capacity;
+
+static void R_PrecacheBatchTask(void *data)
+{
+  precache_batch_t *batch = data;
+  int i;
+
+  for (i = 0; i < batch->count; i++)
+  {
+    precache_item_t *item = &batch->items[i];
+
+    if (item->composite)
+      item->size = createTextureCompositePatch(item->id, &item->patch, item->lumps, true);
+    else
+      item->size = createPatch(item->id, &item->patch, item->lump, true);
+  }
+}
+
+static void R_QueuePrecacheBatch(precache_batch_t *batch)
+{
+  if (!batch->queued)
+  {
+    batch->queued = true;
+    dsda_QueueTask(&batch->group, R_PrecacheBatchTask, batch);
+  }
+}
+
+// Move a worker-built patch into the zone, rebasing its internal pointers
+static void R_AdoptPatch(rpatch_t *dest, rpatch_t *src, int size)
+{
+  int x;
+
+  *dest = *src;
+  dest->data = Z_Malloc(size);
+  memcpy(dest->data, src->data, size);
+
+  dest->pixels = dest->data + (src->pixels - src->data);
+  dest->columns = (rcolumn_t *)(dest->data + ((byte *)src->columns - src->data));
+  dest->posts = (rpost_t *)(dest->data + ((byte *)src->posts - src->data));
+
+  for (x = 0; x < dest->width; x++)
+  {
+    dest->columns[x].pixels = dest->pixels + (src->columns[x].pixels - src->pixels);
+    dest->columns[x].posts = dest->posts + (src->columns[x].posts - src->posts);
+  }
+
+  free(src->data);
+  src->data = NULL;
+}
+
+static void R_AdoptPrecacheBatch(precache_batch_t *batch)
+{
+  zone_category_t category;
+  int i;
+
+  if (batch->adopted)
+    return;
+
+  R_QueuePrecacheBatch(batch);
+  dsda_WaitTasks(&batch->group);
+
+  batch->adopted = true;
+
+  category = Z_SetCategory(ZONE_CAT_RENDERER);
+
+  for (i = 0; i < batch->count; i++)
+  {
+    precache_item_t *item = &batch->items[i];
+    rpatch_t *dest;
+
+    if (item->composite)
+    {
+      dest = &texture_composites[item->id];
+      composite_batches[item->id] = NULL;
+    }
+    else
+    {
+      dest = &patches[item->id];
+      patch_batches[item->id] = NULL;
+    }
+
+    if (item->size < 0)
+      I_Error("createTextureCompositePatch: invalid post index in %.8s",
+              textures[item->id]->name);
+
+    // an item that ran out of memory is built again on demand
+    if (item->patch.data)
+      R_AdoptPatch(dest, &item->patch, item->size);
+
+    if (item->composite)
+      R_ReturnTextureLumps(textures[item->id], item->lumps);
+    else
+      W_ReturnLumpNum(item->id);
+
+    item->lumps = NULL;
+  }
+
+  Z_SetCategory(category);
+}
+
+static precache_item_t *R_AddPrecacheItem(int id, dboolean composite)
+{
+  precache_batch_t *batch = NULL;
+  precache_item_t *item;
+
+  if (precache_batch_count)
+  {
+    batch = precache_batches[precache_batch_count - 1];
+
+    if (batch->queued || batch->count == PRECACHE_BATCH_SIZE)
+    {
+      R_QueuePrecacheBatch(batch);
+      batch = NULL;
+    }
+  }
+
+  if (!batch)
+  {
+    if (precache_batch_count == precache_batch_capacity)
+    {
+      precache_batch_capacity = precache_batch_capacity ? precache_batch_capacity * 2 : 64;
+      precache_batches = Z_Realloc(precache_batches,
+                                   precache_batch_capacity * sizeof(*precache_batches));
+    }
+
+    batch = Z_Calloc(1, sizeof(*batch));
+    precache_batches[precache_batch_count++] = batch;
+  }
+
+  item = &batch->items[batch->count++];
+  item->id = id;
+  item->composite = composite;
+
+  if (composite)
+    composite_batches[id] = batch;
+  else
+    patch_batches[id] = batch;
+
+  return item;
+}
+
+void R_PrecachePatch(int lump)
+{
+  if (lump < 0 || lump >= numlumps || patches[lump].data || patch_batches[lump])
+    return;
+
+  // a lump that is not a patch is left for R_PatchByNum to report
+  if (!CheckIfPatch(lump))
+    return;
 
-  Z_Free(countsInColumn);
+  R_AddPrecacheItem(lump, false)->lump = W_BorrowLumpNum(lump);
+}
+
+void R_PrecacheComposite(int id)
+{
+  if (id < 0 || id >= numtextures || texture_composites[id].data || composite_batches[id])
+    return;
+
+  R_AddPrecacheItem(id, true)->lumps = R_BorrowTextureLumps(textures[id]);
+}
+
+void R_StartPrecache(void)
+{
+  if (precache_batch_count)
+    R_QueuePrecacheBatch(precache_batches[precache_batch_count - 1]);
+}
+
+void R_FinishPrecache(void)
+{
+  int i;
+
+  for (i = 0; i < precache_batch_count; i++)
+  {
+    R_AdoptPrecacheBatch(precache_batches[i]);
+    Z_Free(precache_batches[i]);
+  }
+
+  Z_Free(precache_batches);
+  precache_batches = NULL;
+  precache_batch_count = 0;
+  precache_batch_capacity = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -836,8 +1132,20 @@ const rpatch_t *R_PatchByNum(int id) {
     I_Error("createPatch: %i >= numlumps", id);
 #endif
 
-  if (!patches[id].data)
-    createPatch(id);
+  if (patch_batches[id])
+    R_AdoptPrecacheBatch(patch_batches[id]);
+
+  if (!patches[id].data) {
+    zone_category_t category;
+
+    if (!CheckIfPatch(id))
+      I_Error("createPatch: Unknown patch format %s.", lumpinfo[id].name);
+
+    category = Z_SetCategory(ZONE_CAT_RENDERER);
+    createPatch(id, &patches[id], W_BorrowLumpNum(id), false);
+    W_ReturnLumpNum(id);
+    Z_SetCategory(category);
+  }
 
   return &patches[id];
 }
@@ -852,8 +1160,17 @@ const rpatch_t *R_TextureCompositePatchByNum(int id) {
     I_Error("createTextureCompositePatch: %i >= numtextures", id);
 #endif
 
-  if (!texture_composites[id].data)
-    createTextureCompositePatch(id);
+  if (composite_batches[id])
+    R_AdoptPrecacheBatch(composite_batches[id]);
+
+  if (!texture_composites[id].data) {
+    zone_category_t category = Z_SetCategory(ZONE_CAT_RENDERER);
+    const patch_t **lumps = R_BorrowTextureLumps(textures[id]);
+
+    createTextureCompositePatch(id, &texture_composites[id], lumps, false);
+    R_ReturnTextureLumps(textures[id], lumps);
+    Z_SetCategory(category);
+  }
 
   return &texture_composites[id];
 
@@ -107,6 +107,15 @@ void R_InitPatches();
 void R_UpdatePlayPal();
 void R_FlushAllPatches();
 
+// Background precaching on the thread pool: queue the patches and composites
+// a level needs, then R_StartPrecache to submit the last partial batch.
+// Lookups wait only on the batch holding the requested patch.
+// R_FinishPrecache waits for everything still queued.
+void R_PrecachePatch(int lump);
+void R_PrecacheComposite(int id);
+void R_StartPrecache(void);
+void R_FinishPrecache(void);
+
 extern int playpal_black;
 extern int playpal_white;
 
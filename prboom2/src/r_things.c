@@ -43,10 +43,12 @@
 #include "p_pspr.h"
 #include "lprintf.h"
 #include "e6y.h"//e6y
+#include "md5.h"
 
 #include "dsda/configuration.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
+#include "dsda/startup_cache.h"
 
 #define BASEYCENTER 100
 
@@ -79,19 +81,22 @@ typedef struct drawseg_xrange_item_s
   drawseg_t *user;
 } drawseg_xrange_item_t;
 
-typedef struct drawsegs_xrange_s
-{
-  drawseg_xrange_item_t *items;
-  int count;
-} drawsegs_xrange_t;
-
-#define DS_RANGES_COUNT 3
-static drawsegs_xrange_t drawsegs_xranges[DS_RANGES_COUNT];
+// Drawsegs that can clip sprites are indexed by screen column bucket once
+// per frame, so each sprite only visits the drawsegs near its x1..x2.
+// Items keep the back-to-front drawseg order and bucket lists refer to them
+// by index, so a sprite spanning several buckets merges the lists with a
+// bitmask and still clips in the original order.
+#define DS_BUCKET_SHIFT 5
 
 static drawseg_xrange_item_t *drawsegs_xrange;
 static unsigned int drawsegs_xrange_size = 0;
 static int drawsegs_xrange_count = 0;
 
+static int *drawsegs_bucket_start;
+static int *drawsegs_bucket_items;
+static unsigned int drawsegs_bucket_size;
+static unsigned int *drawsegs_mask;
+
 // constant arrays
 //  used for psprite clipping and initializing clipping
 
@@ -126,6 +131,11 @@ void R_InitSpritesRes(void)
 
   clipbot = Z_Calloc(1, 2 * SCREENWIDTH * sizeof(*clipbot));
   cliptop = clipbot + SCREENWIDTH;
+
+  if (drawsegs_bucket_start) Z_Free(drawsegs_bucket_start);
+
+  drawsegs_bucket_start = Z_Calloc(((SCREENWIDTH - 1) >> DS_BUCKET_SHIFT) + 2,
+                                   sizeof(*drawsegs_bucket_start));
 }
 
 void R_UpdateVisSpriteTranMap(vissprite_t *vis, mobj_t *thing)
@@ -231,10 +241,93 @@ static void R_InstallSpriteLump(int lump, unsigned frame,
 
 #define R_SpriteNameHash(s) ((unsigned)((s)[0]-((s)[1]*3-(s)[3]*2-(s)[2])*2))
 
+// The sprite definitions only depend on the sprite lump names
+// and the name list, so they are kept in the startup cache.
+
+static void R_SpriteCacheInputs(const char * const * namelist, dsda_cksum_t *cksum)
+{
+  struct MD5Context md5;
+  int i;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const byte *) &num_sprites, sizeof(num_sprites));
+
+  for (i = 0; i < num_sprites; i++)
+  {
+    // missing names are hashed as empty, which no real name can be
+    char name[4] = { 0 };
+
+    if (namelist[i])
+      strncpy(name, namelist[i], sizeof(name));
+
+    MD5Update(&md5, (const byte *) name, sizeof(name));
+  }
+
+  MD5Final(cksum->bytes, &md5);
+}
+
+static dboolean R_LoadSpriteCache(const dsda_cksum_t *inputs)
+{
+  dboolean complete;
+  int i;
+
+  if (!dsda_OpenStartupCache(dsda_startup_cache_sprites, inputs))
+    return false;
+
+  for (i = 0; i < num_sprites; i++)
+  {
+    const int *numframes;
+    const spriteframe_t *frames;
+
+    numframes = dsda_ReadStartupCache(sizeof(*numframes));
+    if (!numframes || *numframes < 0 || *numframes > MAX_SPRITE_FRAMES)
+      break;
+
+    if (!*numframes)
+      continue;
+
+    frames = dsda_ReadStartupCache(*numframes * sizeof(*frames));
+    if (!frames)
+      break;
+
+    sprites[i].numframes = *numframes;
+    sprites[i].spriteframes = Z_Malloc(*numframes * sizeof(*frames));
+    memcpy(sprites[i].spriteframes, frames, *numframes * sizeof(*frames));
+  }
+
+  complete = dsda_CloseStartupCache() && i == num_sprites;
+
+  if (!complete)
+  {
+    while (--i >= 0)
+      Z_Free(sprites[i].spriteframes);
+    memset(sprites, 0, num_sprites * sizeof(*sprites));
+  }
+
+  return complete;
+}
+
+static void R_SaveSpriteCache(const dsda_cksum_t *inputs)
+{
+  int i;
+
+  dsda_BeginStartupCache(dsda_startup_cache_sprites, inputs);
+
+  for (i = 0; i < num_sprites; i++)
+  {
+    dsda_WriteStartupCache(&sprites[i].numframes, sizeof(sprites[i].numframes));
+    dsda_WriteStartupCache(sprites[i].spriteframes,
+                           sprites[i].numframes * sizeof(spriteframe_t));
+  }
+
+  dsda_EndStartupCache();
+}
+
 static void R_InitSpriteDefs(const char * const * namelist)
 {
   size_t numentries = lastspritelump-firstspritelump+1;
   struct { int index, next; } *hash;
+  dsda_cksum_t inputs;
   int i;
 
   if (!numentries || !*namelist)
@@ -242,6 +335,11 @@ static void R_InitSpriteDefs(const char * const * namelist)
 
   sprites = Z_Calloc(num_sprites, sizeof(*sprites));
 
+  R_SpriteCacheInputs(namelist, &inputs);
+
+  if (R_LoadSpriteCache(&inputs))
+    return;
+
   // Create hash table based on just the first four letters of each sprite
   // killough 1/31/98
 
@@ -385,6 +483,8 @@ static void R_InitSpriteDefs(const char * const * namelist)
         }
     }
   Z_Free(hash);             // free hash table
+
+  R_SaveSpriteCache(&inputs);
 }
 
 //
@@ -1378,10 +1478,10 @@ void R_SortVisSprites (void)
 }
 
 //
-// R_DrawSprite
+// R_ClipSpriteToDrawseg
 //
 
-static void R_DrawSprite (vissprite_t* spr)
+static void R_ClipSpriteToDrawseg(vissprite_t* spr, const drawseg_xrange_item_t *curr)
 {
   drawseg_t *ds;
   int     x;
@@ -1390,6 +1490,77 @@ static void R_DrawSprite (vissprite_t* spr)
   fixed_t scale;
   fixed_t lowscale;
 
+  // determine if the drawseg obscures the sprite
+  if (curr->x1 > spr->x2 || curr->x2 < spr->x1)
+    return;      // does not cover sprite
+
+  ds = curr->user;
+
+  if (ds->scale1 > ds->scale2)
+  {
+    lowscale = ds->scale2;
+    scale = ds->scale1;
+  }
+  else
+  {
+    lowscale = ds->scale1;
+    scale = ds->scale2;
+  }
+
+  if (scale < spr->scale || (lowscale < spr->scale &&
+    !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
+  {
+    if (ds->maskedtexturecol)       // masked mid texture?
+    {
+      r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+      r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+      R_RenderMaskedSegRange(ds, r1, r2);
+    }
+    return;               // seg is behind sprite
+  }
+
+  r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+  r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+
+  // clip this piece of the sprite
+  // killough 3/27/98: optimized and made much shorter
+
+  if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
+    for (x=r1 ; x<=r2 ; x++)
+      if (clipbot[x] == -2)
+        clipbot[x] = ds->sprbottomclip[x];
+
+  if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
+    for (x=r1 ; x<=r2 ; x++)
+      if (cliptop[x] == -2)
+        cliptop[x] = ds->sprtopclip[x];
+}
+
+static int R_LowestBit(unsigned int bits)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  int i = 0;
+
+  while (!(bits & 1))
+  {
+    bits >>= 1;
+    i++;
+  }
+
+  return i;
+#endif
+}
+
+//
+// R_DrawSprite
+//
+
+static void R_DrawSprite (vissprite_t* spr)
+{
+  int     x;
+
   for (x = spr->x1 ; x<=spr->x2 ; x++)
     clipbot[x] = -2;
   for (x = spr->x1 ; x<=spr->x2 ; x++)
@@ -1402,57 +1573,47 @@ static void R_DrawSprite (vissprite_t* spr)
   // (pointer check was originally nonportable
   // and buggy, by going past LEFT end of array):
 
-  // e6y: optimization
-  if (drawsegs_xrange_size)
+  if (drawsegs_xrange_count)
   {
-    const drawseg_xrange_item_t *last = &drawsegs_xrange[drawsegs_xrange_count - 1];
-    drawseg_xrange_item_t *curr = &drawsegs_xrange[-1];
-    while (++curr <= last)
-    {
-      // determine if the drawseg obscures the sprite
-      if (curr->x1 > spr->x2 || curr->x2 < spr->x1)
-        continue;      // does not cover sprite
+    int b1 = spr->x1 >> DS_BUCKET_SHIFT;
+    int b2 = spr->x2 >> DS_BUCKET_SHIFT;
+    const int *item = &drawsegs_bucket_items[drawsegs_bucket_start[b1]];
+    const int *last = &drawsegs_bucket_items[drawsegs_bucket_start[b2 + 1]];
 
-      ds = curr->user;
+    if (b1 == b2)
+    {
+      for (; item < last; item++)
+        R_ClipSpriteToDrawseg(spr, &drawsegs_xrange[*item]);
+    }
+    else
+    {
+      int word;
+      int first_word = INT_MAX;
+      int last_word = -1;
 
-      if (ds->scale1 > ds->scale2)
+      // Items of neighbouring buckets overlap, so merge them in index order
+      for (; item < last; item++)
       {
-        lowscale = ds->scale2;
-        scale = ds->scale1;
-      }
-      else
-      {
-        lowscale = ds->scale1;
-        scale = ds->scale2;
+        word = *item >> 5;
+        drawsegs_mask[word] |= 1u << (*item & 31);
+        if (word < first_word)
+          first_word = word;
+        if (word > last_word)
+          last_word = word;
       }
 
-      if (scale < spr->scale || (lowscale < spr->scale &&
-        !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
+      for (word = first_word; word <= last_word; word++)
       {
-        if (ds->maskedtexturecol)       // masked mid texture?
+        unsigned int bits = drawsegs_mask[word];
+
+        drawsegs_mask[word] = 0;
+
+        while (bits)
         {
-          r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-          r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-          R_RenderMaskedSegRange(ds, r1, r2);
+          R_ClipSpriteToDrawseg(spr, &drawsegs_xrange[(word << 5) + R_LowestBit(bits)]);
+          bits &= bits - 1;
         }
-        continue;               // seg is behind sprite
       }
-
-      r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-      r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-
-      // clip this piece of the sprite
-      // killough 3/27/98: optimized and made much shorter
-
-      if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
-        for (x=r1 ; x<=r2 ; x++)
-          if (clipbot[x] == -2)
-            clipbot[x] = ds->sprbottomclip[x];
-
-      if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
-        for (x=r1 ; x<=r2 ; x++)
-          if (cliptop[x] == -2)
-            cliptop[x] = ds->sprtopclip[x];
     }
   }
 
@@ -1523,7 +1684,6 @@ void R_DrawMasked(void)
 {
   int i;
   drawseg_t *ds;
-  int cx = SCREENWIDTH / 2;
 
   R_SortVisSprites();
 
@@ -1531,46 +1691,68 @@ void R_DrawMasked(void)
   // Reducing of cache misses in the following R_DrawSprite()
   // Makes sense for scenes with huge amount of drawsegs.
   // ~12% of speed improvement on epic.wad map05
-  for(i = 0; i < DS_RANGES_COUNT; i++)
-    drawsegs_xranges[i].count = 0;
+  drawsegs_xrange_count = 0;
 
   if (num_vissprite > 0)
   {
+    int *bucket_start;
+    int bucket_count;
+    int entries = 0;
+
+    bucket_count = ((viewwidth - 1) >> DS_BUCKET_SHIFT) + 1;
+
     if (drawsegs_xrange_size < maxdrawsegs)
     {
       drawsegs_xrange_size = 2 * maxdrawsegs;
-      for(i = 0; i < DS_RANGES_COUNT; i++)
-      {
-        drawsegs_xranges[i].items = Z_Realloc(
-          drawsegs_xranges[i].items,
-          drawsegs_xrange_size * sizeof(drawsegs_xranges[i].items[0]));
-      }
+      drawsegs_xrange = Z_Realloc(drawsegs_xrange,
+                                  drawsegs_xrange_size * sizeof(*drawsegs_xrange));
+      Z_Free(drawsegs_mask);
+      drawsegs_mask = Z_Calloc((drawsegs_xrange_size + 31) / 32, sizeof(*drawsegs_mask));
     }
+
+    bucket_start = drawsegs_bucket_start;
+    memset(bucket_start, 0, (bucket_count + 1) * sizeof(*bucket_start));
+
     for (ds = ds_p; ds-- > drawsegs;)
     {
       if (ds->silhouette || ds->maskedtexturecol)
       {
-        drawsegs_xranges[0].items[drawsegs_xranges[0].count].x1 = ds->x1;
-        drawsegs_xranges[0].items[drawsegs_xranges[0].count].x2 = ds->x2;
-        drawsegs_xranges[0].items[drawsegs_xranges[0].count].user = ds;
+        drawseg_xrange_item_t *item = &drawsegs_xrange[drawsegs_xrange_count++];
+        int b;
 
-        // e6y: ~13% of speed improvement on sunder.wad map10
-        if (ds->x1 < cx)
-        {
-          drawsegs_xranges[1].items[drawsegs_xranges[1].count] =
-            drawsegs_xranges[0].items[drawsegs_xranges[0].count];
-          drawsegs_xranges[1].count++;
-        }
-        if (ds->x2 >= cx)
-        {
-          drawsegs_xranges[2].items[drawsegs_xranges[2].count] =
-            drawsegs_xranges[0].items[drawsegs_xranges[0].count];
-          drawsegs_xranges[2].count++;
-        }
+        item->x1 = ds->x1;
+        item->x2 = ds->x2;
+        item->user = ds;
 
-        drawsegs_xranges[0].count++;
+        for (b = ds->x1 >> DS_BUCKET_SHIFT; b <= ds->x2 >> DS_BUCKET_SHIFT; b++, entries++)
+          bucket_start[b + 1]++;
       }
     }
+
+    if (drawsegs_bucket_size < entries)
+    {
+      drawsegs_bucket_size = 2 * entries;
+      Z_Free(drawsegs_bucket_items);
+      drawsegs_bucket_items = Z_Malloc(drawsegs_bucket_size * sizeof(*drawsegs_bucket_items));
+    }
+
+    for (i = 0; i < bucket_count; i++)
+      bucket_start[i + 1] += bucket_start[i];
+
+    // Fill each bucket in item order, advancing its start as the cursor
+    // and shifting the starts back into place afterwards
+    for (i = 0; i < drawsegs_xrange_count; i++)
+    {
+      const drawseg_xrange_item_t *item = &drawsegs_xrange[i];
+      int b;
+
+      for (b = item->x1 >> DS_BUCKET_SHIFT; b <= item->x2 >> DS_BUCKET_SHIFT; b++)
+        drawsegs_bucket_items[bucket_start[b]++] = i;
+    }
+
+    for (i = bucket_count; i > 0; i--)
+      bucket_start[i] = bucket_start[i - 1];
+    bucket_start[0] = 0;
   }
 
   // draw all vissprites back to front
@@ -1578,27 +1760,7 @@ void R_DrawMasked(void)
   dsda_RecordVisSprites(num_vissprite);
 
   for (i = num_vissprite ;--i>=0; )
-  {
-    vissprite_t* spr = vissprite_ptrs[i];
-
-    if (spr->x2 < cx)
-    {
-      drawsegs_xrange = drawsegs_xranges[1].items;
-      drawsegs_xrange_count = drawsegs_xranges[1].count;
-    }
-    else if (spr->x1 >= cx)
-    {
-      drawsegs_xrange = drawsegs_xranges[2].items;
-      drawsegs_xrange_count = drawsegs_xranges[2].count;
-    }
-    else
-    {
-      drawsegs_xrange = drawsegs_xranges[0].items;
-      drawsegs_xrange_count = drawsegs_xranges[0].count;
-    }
-
     R_DrawSprite(vissprite_ptrs[i]);
-  }
 
   // render any remaining masked mid textures
 
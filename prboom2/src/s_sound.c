@@ -58,6 +58,7 @@
 #include "dsda/mapinfo.h"
 #include "dsda/memory.h"
 #include "dsda/music.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/sfx.h"
 #include "dsda/skip.h"
@@ -571,7 +572,7 @@ void S_ResumeSound(void)
 //
 // Updates music & sounds
 //
-void S_UpdateSounds(void)
+static void S_UpdateSoundChannels(void)
 {
   mobj_t *listener;
   int cnum;
@@ -629,6 +630,13 @@ void S_UpdateSounds(void)
   }
 }
 
+void S_UpdateSounds(void)
+{
+  DSDA_PROFILE_BEGIN(dsda_profile_update_sounds);
+  S_UpdateSoundChannels();
+  DSDA_PROFILE_END(dsda_profile_update_sounds);
+}
+
 // Starts some music with the music id found in sounds.h.
 //
 void S_StartMusic(int m_id)
@@ -44,7 +44,7 @@
 #include "z_zone.h"
 #include "lprintf.h"
 
-static void **lump_data;
+static const void **lump_data;
 
 /* W_InitCache
  *
@@ -60,6 +60,9 @@ void W_InitCache(void)
 
 void W_DoneCache(void)
 {
+  // the lumps themselves belong to the lump cache
+  free(lump_data);
+  lump_data = NULL;
 }
 
 /* W_LumpByNum
@@ -75,16 +78,19 @@ const void *W_LumpByNum(int lump)
     I_Error ("W_LumpByNum: %i >= numlumps",lump);
 #endif
 
-  // read the lump in
-  if (!lump_data[lump]) {
-    lump_data[lump] = Z_Malloc(W_LumpLength(lump));
-    W_ReadLump(lump, lump_data[lump]);
-  }
+  // callers keep the pointer, so the lump stays locked for the session
+  if (!lump_data[lump])
+    lump_data[lump] = W_LockLumpNum(lump);
 
   return lump_data[lump];
 }
 
-const void *W_LockLumpNum(int lump)
+const void *W_BorrowLumpNum(int lump)
 {
-  return W_LumpByNum(lump);
+  return W_LockLumpNum(lump);
+}
+
+void W_ReturnLumpNum(int lump)
+{
+  W_UnlockLumpNum(lump);
 }
@@ -55,7 +55,7 @@
 
 #include "e6y.h"//e6y
 
-static void **lump_data;
+#include "dsda/zipfile.h"
 
 #ifdef _WIN32
 typedef struct {
@@ -71,18 +71,15 @@ void W_DoneCache(void)
 {
   size_t i;
 
-  if (lump_data) {
-    Z_Free(lump_data);
-    lump_data = NULL;
-  }
-
   if (!mapped_wad)
     return;
   for (i=0; i<numwadfiles; i++)
   {
     if (mapped_wad[i].data)
     {
-      UnmapViewOfFile(mapped_wad[i].data);
+      // views shared with another member of the same archive have no handles
+      if (mapped_wad[i].hnd_map)
+        UnmapViewOfFile(mapped_wad[i].data);
       mapped_wad[i].data=NULL;
     }
     if (mapped_wad[i].hnd_map)
@@ -105,11 +102,6 @@ void W_InitCache(void)
   // Wipe any existing cache
   W_DoneCache();
 
-  // set up caching
-  lump_data = Z_Calloc(numlumps, sizeof *lump_data);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
-
   mapped_wad = Z_Calloc(numwadfiles,sizeof(mmap_info_t));
   memset(mapped_wad,0,sizeof(mmap_info_t)*numwadfiles);
   {
@@ -118,15 +110,31 @@ void W_InitCache(void)
     {
       int wad_index = (int)(lumpinfo[i].wadfile-wadfiles);
 
-      if (!lumpinfo[i].wadfile)
+      if (!lumpinfo[i].wadfile || dsda_ZipEntryInMemory(lumpinfo[i].wadfile->zip_entry))
         continue;
 #ifdef RANGECHECK
       if ((wad_index<0)||((size_t)wad_index>=numwadfiles))
         I_Error("W_InitCache: wad_index out of range");
 #endif
+      // stored members of one archive share a single view of it
+      if (!mapped_wad[wad_index].data && wadfiles[wad_index].zip_entry)
+      {
+        size_t j;
+
+        for (j = 0; j < numwadfiles; j++)
+          if (mapped_wad[j].data && wadfiles[j].zip_entry &&
+              wadfiles[j].zip_entry->archive == wadfiles[wad_index].zip_entry->archive)
+          {
+            mapped_wad[wad_index].data = mapped_wad[j].data;
+            break;
+          }
+      }
       if (!mapped_wad[wad_index].data)
       {
-        wchar_t *wname = ConvertUtf8ToWide(wadfiles[wad_index].name);
+        // stored archive members are mapped from the archive itself
+        wchar_t *wname = ConvertUtf8ToWide(wadfiles[wad_index].zip_entry ?
+                                           wadfiles[wad_index].zip_entry->archive :
+                                           wadfiles[wad_index].name);
         mapped_wad[wad_index].hnd = CreateFileW(wname,
           GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
           NULL, OPEN_EXISTING, 0, NULL);
@@ -170,6 +178,8 @@ const void* W_LumpByNum(int lump)
 #endif
   if (!lumpinfo[lump].wadfile)
     return NULL;
+  if (dsda_ZipEntryInMemory(lumpinfo[lump].wadfile->zip_entry))
+    return dsda_ZipEntryData(lumpinfo[lump].wadfile->zip_entry) + lumpinfo[lump].position;
   return (void*)((unsigned char *)mapped_wad[wad_index].data+lumpinfo[lump].position);
 }
 
@@ -180,10 +190,6 @@ void ** mapped_wad;
 void W_InitCache(void)
 {
   int maxfd = 0;
-  // set up caching
-  lump_data = Z_Calloc(numlumps, sizeof *lump_data);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
 
   {
     int i;
@@ -195,7 +201,7 @@ void W_InitCache(void)
   {
     int i;
     for (i=0; i<numlumps; i++) {
-      if (lumpinfo[i].wadfile) {
+      if (lumpinfo[i].wadfile && !dsda_ZipEntryInMemory(lumpinfo[i].wadfile->zip_entry)) {
         int fd = lumpinfo[i].wadfile->handle;
         if (!mapped_wad[fd])
           if ((mapped_wad[fd] = mmap(NULL,I_Filelength(fd),PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
@@ -232,6 +238,10 @@ const void* W_LumpByNum(int lump)
   if (!lumpinfo[lump].wadfile)
     return NULL;
 
+  // compressed archive members are inflated on first use
+  if (dsda_ZipEntryInMemory(lumpinfo[lump].wadfile->zip_entry))
+    return dsda_ZipEntryData(lumpinfo[lump].wadfile->zip_entry) + lumpinfo[lump].position;
+
   return
     (const void *) (
       ((const byte *) (mapped_wad[lumpinfo[lump].wadfile->handle]))
@@ -240,23 +250,12 @@ const void* W_LumpByNum(int lump)
 }
 #endif
 
-/*
- * W_LockLumpNum
- *
- * This copies the lump into a malloced memory region and returns its address
- * instead of returning a pointer into the memory mapped area
- *
- */
-const void* W_LockLumpNum(int lump)
+// Mapped lumps cost nothing to keep, and the system pages them out
+const void* W_BorrowLumpNum(int lump)
 {
-  size_t len = W_LumpLength(lump);
-  const void *data = W_LumpByNum(lump);
-
-  // read the lump in
-  if (!lump_data[lump]) {
-    lump_data[lump] = Z_Malloc(len);
-    memcpy(lump_data[lump], data, len);
-  }
+  return W_LumpByNum(lump);
+}
 
-  return lump_data[lump];
+void W_ReturnLumpNum(int lump)
+{
 }
@@ -55,7 +55,9 @@
 #include "lprintf.h"
 #include "e6y.h"
 
+#include "dsda/configuration.h"
 #include "dsda/utility.h"
+#include "dsda/zipfile.h"
 
 //
 // GLOBALS
@@ -112,6 +114,57 @@ char *AddDefaultExtension(char *path, const char *ext)
 // LUMP BASED ROUTINES.
 //
 
+// Reads part of a wad file, which may be a member of an archive
+static void W_ReadFile(wadfile_info_t *wadfile, int offset, void *dest, int length)
+{
+  dsda_zip_entry_t *entry = wadfile->zip_entry;
+
+  if (entry)
+  {
+    if (offset < 0 || length < 0 || length > entry->size - offset)
+      I_Error("W_AddFile: Wad file %s is truncated", wadfile->name);
+
+    if (!entry->stored)
+    {
+      memcpy(dest, dsda_ZipEntryData(entry) + offset, length);
+      return;
+    }
+
+    offset += entry->offset;
+  }
+
+  lseek(wadfile->handle, offset, SEEK_SET);
+  I_Read(wadfile->handle, dest, length);
+}
+
+// Another wad file open on the same handle, which happens for stored
+// members of one archive
+static wadfile_info_t *W_HandleSharedWith(wadfile_info_t *wadfile, int handle)
+{
+  size_t i;
+
+  for (i = 0; i < numwadfiles; ++i)
+    if (&wadfiles[i] != wadfile && wadfiles[i].handle == handle)
+      return &wadfiles[i];
+
+  return NULL;
+}
+
+// Stored members of an archive share one handle, and so one mapping
+static int W_OpenArchive(wadfile_info_t *wadfile)
+{
+  size_t i;
+
+  for (i = 0; i < numwadfiles; ++i)
+    if (&wadfiles[i] != wadfile &&
+        wadfiles[i].handle > 0 &&
+        wadfiles[i].zip_entry &&
+        wadfiles[i].zip_entry->archive == wadfile->zip_entry->archive)
+      return wadfiles[i].handle;
+
+  return M_OpenRB(wadfile->zip_entry->archive);
+}
+
 //
 // W_AddFile
 // All files are optional, but at least one file must be
@@ -137,6 +190,8 @@ static void W_AddFile(wadfile_info_t *wadfile)
   filelump_t  singleinfo;
   int         flags = 0;
 
+  wadfile->zip_entry = dsda_ZipEntry(wadfile->name);
+
   if (wadfile->src == source_skip)
   {
     return;
@@ -145,18 +200,30 @@ static void W_AddFile(wadfile_info_t *wadfile)
   // Close any existing handle
   if (wadfile->handle > 0)
   {
-    close(wadfile->handle);
+    if (!W_HandleSharedWith(wadfile, wadfile->handle))
+      close(wadfile->handle);
     wadfile->handle = 0;
   }
 
   // open the file and add to directory
 
-  wadfile->handle = M_OpenRB(wadfile->name);
-  if (wadfile->handle == -1)
+  // archive members are read in place: stored ones from the archive itself,
+  // compressed ones from memory once inflated
+  if (dsda_ZipEntryInMemory(wadfile->zip_entry))
+    wadfile->handle = -1;
+  else
   {
-    if (!dsda_HasFileExt(wadfile->name, ".lmp"))
-      I_Error("W_AddFile: couldn't open %s",wadfile->name);
-    return;
+    if (wadfile->zip_entry)
+      wadfile->handle = W_OpenArchive(wadfile);
+    else
+      wadfile->handle = M_OpenRB(wadfile->name);
+
+    if (wadfile->handle == -1)
+    {
+      if (!dsda_HasFileExt(wadfile->name, ".lmp"))
+        I_Error("W_AddFile: couldn't open %s",wadfile->name);
+      return;
+    }
   }
 
   //jff 8/3/98 use logical output routine
@@ -182,14 +249,15 @@ static void W_AddFile(wadfile_info_t *wadfile)
       // single lump file
       fileinfo = &singleinfo;
       singleinfo.filepos = 0;
-      singleinfo.size = LittleLong(I_Filelength(wadfile->handle));
+      singleinfo.size = LittleLong(wadfile->zip_entry ? wadfile->zip_entry->size :
+                                                        I_Filelength(wadfile->handle));
       ExtractFileBase(wadfile->name, singleinfo.name);
       numlumps++;
     }
   else
     {
       // WAD file
-      I_Read(wadfile->handle, &header, sizeof(header));
+      W_ReadFile(wadfile, 0, &header, sizeof(header));
       if (strncmp(header.identification,"IWAD",4) &&
           strncmp(header.identification,"PWAD",4))
         I_Error("W_AddFile: Wad file %s doesn't have IWAD or PWAD id", wadfile->name);
@@ -197,8 +265,7 @@ static void W_AddFile(wadfile_info_t *wadfile)
       header.infotableofs = LittleLong(header.infotableofs);
       length = header.numlumps*sizeof(filelump_t);
       fileinfo2free = fileinfo = Z_Malloc(length);    // killough
-      lseek(wadfile->handle, header.infotableofs, SEEK_SET),
-      I_Read(wadfile->handle, fileinfo, length);
+      W_ReadFile(wadfile, header.infotableofs, fileinfo, length);
       numlumps += header.numlumps;
     }
 
@@ -213,6 +280,15 @@ static void W_AddFile(wadfile_info_t *wadfile)
         lump_p->wadfile = wadfile;                    //  killough 4/25/98
         lump_p->position = LittleLong(fileinfo->filepos);
         lump_p->size = LittleLong(fileinfo->size);
+        if (wadfile->zip_entry)
+        {
+          if (lump_p->size && (lump_p->position < 0 || lump_p->size < 0 ||
+              lump_p->size > wadfile->zip_entry->size - lump_p->position))
+            I_Error("W_AddFile: Wad file %s has a lump outside of the file", wadfile->name);
+
+          if (wadfile->zip_entry->stored)
+            lump_p->position += wadfile->zip_entry->offset;
+        }
         if (wadfile->src == source_lmp)
         {
           // Modifications to place command-line-added demo lumps
@@ -464,6 +540,202 @@ int W_ListNumFromName(const char *name, int lump)
   return i;
 }
 
+//
+// Locked lump cache
+//
+// W_LockLumpNum hands out a private copy of a lump that stays valid until the
+// matching W_UnlockLumpNum. Unlocked copies are kept for reuse, and once the
+// cache grows past dsda_lump_cache_size MB the least recently used ones are
+// freed. A size of 0 keeps everything.
+//
+// Without mmap, every lump read goes through this cache: W_LumpByNum locks
+// a lump for good, while W_BorrowLumpNum and W_ReturnLumpNum let the map
+// loaders and the patch builders release the lumps they have converted.
+//
+
+typedef struct
+{
+  void *data;
+  int locks;
+  int prev, next; // unlocked copies, most recently used first
+} lump_cache_t;
+
+static lump_cache_t *lump_cache;
+static int lump_cache_head = -1;
+static int lump_cache_tail = -1;
+static size_t lump_cache_budget;
+static size_t lump_cache_bytes;
+static size_t lump_cache_peak;
+static unsigned int lump_cache_hits;
+static unsigned int lump_cache_misses;
+static unsigned int lump_cache_evictions;
+
+static void W_UnlinkCachedLump(int lump)
+{
+  lump_cache_t *cache = &lump_cache[lump];
+
+  if (cache->prev != -1)
+    lump_cache[cache->prev].next = cache->next;
+  else
+    lump_cache_head = cache->next;
+
+  if (cache->next != -1)
+    lump_cache[cache->next].prev = cache->prev;
+  else
+    lump_cache_tail = cache->prev;
+
+  cache->prev = cache->next = -1;
+}
+
+static void W_LinkCachedLump(int lump)
+{
+  lump_cache_t *cache = &lump_cache[lump];
+
+  cache->prev = -1;
+  cache->next = lump_cache_head;
+
+  if (lump_cache_head != -1)
+    lump_cache[lump_cache_head].prev = lump;
+  else
+    lump_cache_tail = lump;
+
+  lump_cache_head = lump;
+}
+
+static void W_TrimLumpCache(void)
+{
+  if (!lump_cache_budget)
+    return;
+
+  // locked lumps can't be freed, so the budget is a soft limit
+  while (lump_cache_bytes > lump_cache_budget && lump_cache_tail != -1)
+  {
+    int lump = lump_cache_tail;
+
+    W_UnlinkCachedLump(lump);
+    Z_Free(lump_cache[lump].data);
+    lump_cache[lump].data = NULL;
+    lump_cache_bytes -= lumpinfo[lump].size;
+    ++lump_cache_evictions;
+  }
+}
+
+static void W_FreeLumpCache(void)
+{
+  int i;
+
+  if (!lump_cache)
+    return;
+
+  for (i = 0; i < numlumps; ++i)
+    Z_Free(lump_cache[i].data);
+
+  Z_Free(lump_cache);
+  lump_cache = NULL;
+  lump_cache_head = lump_cache_tail = -1;
+  lump_cache_bytes = 0;
+}
+
+static void W_InitLumpCache(void)
+{
+  int i;
+
+  W_FreeLumpCache();
+
+  lump_cache = Z_Malloc(numlumps * sizeof(*lump_cache));
+  for (i = 0; i < numlumps; ++i)
+  {
+    lump_cache[i].data = NULL;
+    lump_cache[i].locks = 0;
+    lump_cache[i].prev = lump_cache[i].next = -1;
+  }
+
+  W_UpdateLumpCacheSize();
+}
+
+void W_UpdateLumpCacheSize(void)
+{
+  lump_cache_budget = (size_t) dsda_IntConfig(dsda_config_lump_cache_size) * 1024 * 1024;
+
+  if (lump_cache)
+    W_TrimLumpCache();
+}
+
+const void *W_LockLumpNum(int lump)
+{
+  lump_cache_t *cache;
+
+#ifdef RANGECHECK
+  if ((unsigned)lump >= (unsigned)numlumps)
+    I_Error ("W_LockLumpNum: %i >= numlumps",lump);
+#endif
+
+  cache = &lump_cache[lump];
+
+  if (cache->data)
+  {
+    ++lump_cache_hits;
+
+    if (!cache->locks)
+      W_UnlinkCachedLump(lump);
+  }
+  else
+  {
+    zone_category_t category = Z_SetCategory(ZONE_CAT_WAD);
+
+    ++lump_cache_misses;
+
+    cache->data = Z_Malloc(lumpinfo[lump].size);
+    Z_SetCategory(category);
+
+    W_ReadLump(lump, cache->data);
+
+    lump_cache_bytes += lumpinfo[lump].size;
+    if (lump_cache_bytes > lump_cache_peak)
+      lump_cache_peak = lump_cache_bytes;
+
+    W_TrimLumpCache();
+  }
+
+  ++cache->locks;
+
+  return cache->data;
+}
+
+void W_UnlockLumpNum(int lump)
+{
+  lump_cache_t *cache;
+
+#ifdef RANGECHECK
+  if ((unsigned)lump >= (unsigned)numlumps)
+    I_Error ("W_UnlockLumpNum: %i >= numlumps",lump);
+  if (lump_cache[lump].locks <= 0)
+    I_Error ("W_UnlockLumpNum: lump %i is not locked",lump);
+#endif
+
+  cache = &lump_cache[lump];
+
+  if (cache->locks <= 0 || --cache->locks)
+    return;
+
+  W_LinkCachedLump(lump);
+  W_TrimLumpCache();
+}
+
+void W_PrintLumpCacheStats(void)
+{
+  unsigned int requests = lump_cache_hits + lump_cache_misses;
+
+  lprintf(LO_INFO, "\nLump cache:\n");
+  lprintf(LO_INFO, "  budget      %12lu KB\n", (unsigned long) (lump_cache_budget / 1024));
+  lprintf(LO_INFO, "  live        %12lu KB\n", (unsigned long) (lump_cache_bytes / 1024));
+  lprintf(LO_INFO, "  peak        %12lu KB\n", (unsigned long) (lump_cache_peak / 1024));
+  lprintf(LO_INFO, "  hits        %12u (%.1f%%)\n", lump_cache_hits,
+          requests ? 100.0 * lump_cache_hits / requests : 0.0);
+  lprintf(LO_INFO, "  misses      %12u\n", lump_cache_misses);
+  lprintf(LO_INFO, "  evictions   %12u\n", lump_cache_evictions);
+}
+
 // W_Init
 // Loads each of the files in the wadfiles array.
 // All files are optional, but at least one file
@@ -515,6 +787,7 @@ void W_Init(void)
   /* cph 2001/07/07 - separated cache setup */
   lprintf(LO_DEBUG, "W_InitCache\n");
   W_InitCache();
+  W_InitLumpCache();
 
   V_FreePlaypal();
 }
@@ -558,6 +831,12 @@ void W_ReadLump(int lump, void *dest)
     {
       if (l->wadfile)
       {
+        if (dsda_ZipEntryInMemory(l->wadfile->zip_entry))
+        {
+          memcpy(dest, dsda_ZipEntryData(l->wadfile->zip_entry) + l->position, l->size);
+          return;
+        }
+
         lseek(l->wadfile->handle, l->position, SEEK_SET);
         I_Read(l->wadfile->handle, dest, l->size);
       }
@@ -572,8 +851,7 @@ char* W_ReadLumpToString(int lump)
   if (lump >= 0 && lump < numlumps && l->wadfile)
   {
     buffer = Z_Malloc(l->size + 1);
-    lseek(l->wadfile->handle, l->position, SEEK_SET);
-    I_Read(l->wadfile->handle, buffer, l->size);
+    W_ReadLump(lump, buffer);
     buffer[l->size] = '\0';
   }
 
@@ -617,13 +895,20 @@ void W_Shutdown(void)
   int i;
 
   W_DoneCache();
+  W_FreeLumpCache();
 
   for (i = 0; i < numwadfiles; ++i)
   {
     if (wadfiles[i].handle > 0)
     {
-      close(wadfiles[i].handle);
+      wadfile_info_t *shared;
+      int handle = wadfiles[i].handle;
+
+      close(handle);
       wadfiles[i].handle = -1;
+
+      while ((shared = W_HandleSharedWith(&wadfiles[i], handle)))
+        shared->handle = -1;
     }
   }
 }
@@ -86,6 +86,7 @@ typedef struct {
   char* name;
   wad_source_t src;
   int handle;
+  struct dsda_zip_entry_s* zip_entry; // read in place from an archive
 } wadfile_info_t;
 
 extern wadfile_info_t *wadfiles;
@@ -161,6 +162,13 @@ char*   W_ReadLumpToString (int lump);
 const void* W_SafeLumpByNum (int lump);
 const void* W_LumpByNum (int lump);
 const void* W_LockLumpNum(int lump);
+void W_UnlockLumpNum(int lump);
+// Lumps that are only read while they are converted. Unlike W_LumpByNum,
+// a borrowed lump can be evicted from the lump cache once it is returned.
+const void* W_BorrowLumpNum(int lump);
+void W_ReturnLumpNum(int lump);
+void W_UpdateLumpCacheSize(void);
+void W_PrintLumpCacheStats(void);
 
 int W_LumpNumExists(int lump);
 int W_LumpNameExists(const char *name);
@@ -67,17 +67,235 @@ enum {
   ZONE_MAX
 };
 
+// The signature comes last, so it sits right before the user pointer
+// for every kind of block, including pool slots.
 typedef struct memblock {
-  unsigned signature;
   struct memblock *next,*prev;
   size_t size;
   unsigned char tag;
+  unsigned char category;
+  unsigned signature;
 } memblock_t;
 
 static const size_t HEADER_SIZE = sizeof(memblock_t);
 
 static memblock_t *blockbytag[ZONE_MAX];
 
+/* Statistics
+ * Every block is charged to the category that was current when it was
+ * allocated. Level blocks always count as level memory, since they all
+ * go away together. Pool slots are charged through their slabs.
+ */
+
+static zone_category_t zone_category = ZONE_CAT_GENERAL;
+static zone_stats_t zone_stats[ZONE_CAT_MAX];
+static zone_stats_t zone_total;
+
+static const char *zone_category_names[ZONE_CAT_MAX] = {
+  [ZONE_CAT_GENERAL] = "general",
+  [ZONE_CAT_LEVEL] = "level",
+  [ZONE_CAT_RENDERER] = "renderer",
+  [ZONE_CAT_WAD] = "wad cache",
+  [ZONE_CAT_KEY_FRAME] = "key frames",
+  [ZONE_CAT_SOUND] = "sound",
+};
+
+static void Z_CountStats(zone_stats_t *stats, size_t size)
+{
+  stats->live += size;
+  if (stats->live > stats->peak)
+    stats->peak = stats->live;
+  ++stats->allocations;
+}
+
+static void Z_CountAlloc(int category, size_t size)
+{
+  Z_CountStats(&zone_stats[category], size);
+  Z_CountStats(&zone_total, size);
+}
+
+static void Z_CountFree(int category, size_t size)
+{
+  zone_stats[category].live -= size;
+  zone_total.live -= size;
+}
+
+#ifndef ZONEDEBUG
+
+/* Level arena
+ * Small level blocks are carved out of large chunks, which are all
+ * released at once when the level ends. Freed blocks are kept on
+ * per-size free lists for reuse during the level. Build with ZONEDEBUG
+ * to allocate every level block separately instead.
+ */
+
+#define ARENA_SIGNATURE 0x5a3c17e9
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+#define ARENA_ALIGN 16
+#define ARENA_MAX_BLOCK 4096
+#define ARENA_CLASSES (ARENA_MAX_BLOCK / ARENA_ALIGN + 1)
+
+typedef union arena_chunk {
+  union arena_chunk *next;
+  long double align;
+} arena_chunk_t;
+
+static arena_chunk_t *arena_chunks;
+static char *arena_top, *arena_end;
+static memblock_t *arena_last; // newest bump allocation, which can grow in place
+static memblock_t *arena_free[ARENA_CLASSES];
+static size_t arena_live; // bytes handed out, released in bulk with the chunks
+
+static size_t Z_ArenaSize(size_t size)
+{
+  return (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+// Distance from one block to the next. The header is padded out so that
+// the user pointer of every block stays ARENA_ALIGN aligned.
+static size_t Z_ArenaStride(size_t size)
+{
+  return Z_ArenaSize(HEADER_SIZE) + size;
+}
+
+static void Z_NewArenaChunk(void)
+{
+  arena_chunk_t *chunk;
+
+  if (!(chunk = malloc(ARENA_CHUNK_SIZE)))
+    I_Error("Z_NewArenaChunk: Failure trying to allocate %lu bytes", (unsigned long) ARENA_CHUNK_SIZE);
+
+  chunk->next = arena_chunks;
+  arena_chunks = chunk;
+
+  // Place the first header so that the memory after it is aligned
+  arena_top = (char *) (((uintptr_t) (chunk + 1) + HEADER_SIZE + ARENA_ALIGN - 1) &
+                        ~(uintptr_t) (ARENA_ALIGN - 1)) - HEADER_SIZE;
+  arena_end = (char *) chunk + ARENA_CHUNK_SIZE;
+  arena_last = NULL;
+}
+
+static void *Z_ArenaMalloc(size_t size)
+{
+  memblock_t *block;
+
+  size = Z_ArenaSize(size);
+
+  if ((block = arena_free[size / ARENA_ALIGN]))
+    arena_free[size / ARENA_ALIGN] = block->next;
+  else
+  {
+    if (!arena_top || arena_end - arena_top < (ptrdiff_t) Z_ArenaStride(size))
+      Z_NewArenaChunk();
+
+    block = (memblock_t *) arena_top;
+    arena_top += Z_ArenaStride(size);
+    arena_last = block;
+  }
+
+  block->next = block->prev = NULL;
+  block->size = size;
+  block->signature = ARENA_SIGNATURE;
+  block->tag = ZONE_LEVEL;
+  block->category = ZONE_CAT_LEVEL;
+
+  arena_live += size;
+  Z_CountAlloc(ZONE_CAT_LEVEL, size);
+
+  return (char *) block + HEADER_SIZE;
+}
+
+static void Z_ArenaFree(memblock_t *block)
+{
+  block->signature = 0;
+
+  arena_live -= block->size;
+  Z_CountFree(ZONE_CAT_LEVEL, block->size);
+
+  if (block == arena_last)
+  {
+    arena_top = (char *) block;
+    arena_last = NULL;
+    return;
+  }
+
+  block->next = arena_free[block->size / ARENA_ALIGN];
+  arena_free[block->size / ARENA_ALIGN] = block;
+}
+
+// Grow or shrink the newest arena block without moving it
+static dboolean Z_ArenaResize(memblock_t *block, size_t size)
+{
+  size = Z_ArenaSize(size);
+
+  if (block != arena_last || size > ARENA_MAX_BLOCK ||
+      arena_end - (char *) block < (ptrdiff_t) Z_ArenaStride(size))
+    return false;
+
+  arena_live += size - block->size;
+  Z_CountFree(ZONE_CAT_LEVEL, block->size);
+  Z_CountAlloc(ZONE_CAT_LEVEL, size);
+
+  block->size = size;
+  arena_top = (char *) block + Z_ArenaStride(size);
+
+  return true;
+}
+
+static void Z_FreeArena(void)
+{
+  while (arena_chunks)
+  {
+    arena_chunk_t *next = arena_chunks->next;
+    free(arena_chunks);
+    arena_chunks = next;
+  }
+
+  Z_CountFree(ZONE_CAT_LEVEL, arena_live);
+  arena_live = 0;
+
+  arena_top = arena_end = NULL;
+  arena_last = NULL;
+  memset(arena_free, 0, sizeof(arena_free));
+}
+
+#endif
+
+/* Level pools
+ * Objects of the same type are packed into slabs with cache line aligned
+ * slots, so that walking the thinker list stays within a few regions of
+ * memory. Each slot only has a small header in front of it, with the
+ * same signature position as memblock_t, so Z_Free works on it.
+ */
+
+#define POOL_SIGNATURE 0x7b2e40c5
+#define POOL_SLAB_SIZE (64 * 1024)
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+  unsigned pool;
+  unsigned signature;
+} poolslot_t;
+
+typedef struct {
+  size_t stride;
+  void *free_list;
+  char *top, *end;
+} zone_pool_t;
+
+static zone_pool_t pools[ZONE_POOL_MAX];
+
+static void Z_PoolFree(void *p)
+{
+  poolslot_t *slot = (poolslot_t *) p - 1;
+  zone_pool_t *pool = &pools[slot->pool];
+
+  slot->signature = 0;
+
+  *(void **) p = pool->free_list;
+  pool->free_list = p;
+}
+
 /* Z_Malloc
  * cph - the algorithm here was a very simple first-fit round-robin
  *  one - just keep looping around, freeing everything we can until
@@ -95,6 +313,11 @@ static void *Z_MallocTag(size_t size, int tag)
   if (!size)
     return NULL; // malloc(0) returns NULL
 
+#ifndef ZONEDEBUG
+  if (tag == ZONE_LEVEL && size <= ARENA_MAX_BLOCK)
+    return Z_ArenaMalloc(size);
+#endif
+
   if (!(block = malloc(size + HEADER_SIZE)))
   {
     I_Error ("Z_Malloc: Failure trying to allocate %lu bytes", (unsigned long) size);
@@ -116,6 +339,8 @@ static void *Z_MallocTag(size_t size, int tag)
   block->size = size;
   block->signature = ZONE_SIGNATURE;
   block->tag = tag;           // tag
+  block->category = (tag == ZONE_LEVEL ? ZONE_CAT_LEVEL : zone_category);
+  Z_CountAlloc(block->category, size);
   block = (memblock_t *)((char *) block + HEADER_SIZE);
 
   return block;
@@ -128,9 +353,24 @@ void Z_Free(void *p)
   if (!p)
     return;
 
+  if (block->signature == POOL_SIGNATURE)
+  {
+    Z_PoolFree(p);
+    return;
+  }
+
+#ifndef ZONEDEBUG
+  if (block->signature == ARENA_SIGNATURE)
+  {
+    Z_ArenaFree(block);
+    return;
+  }
+#endif
+
   if (block->signature != ZONE_SIGNATURE)
     I_Error("Z_Free: freed a non-zone pointer");
   block->signature = 0;       // Nullify signature so another free fails
+  Z_CountFree(block->category, block->size);
 
   if (block == block->next)
     blockbytag[block->tag] = NULL;
@@ -150,6 +390,14 @@ static void Z_FreeTag(int tag)
   if (tag < 0 || tag >= ZONE_MAX)
     I_Error("Z_FreeTag: Tag %i does not exist", tag);
 
+  if (tag == ZONE_LEVEL)
+  {
+    memset(pools, 0, sizeof(pools));
+#ifndef ZONEDEBUG
+    Z_FreeArena();
+#endif
+  }
+
   block = blockbytag[tag];
   if (!block)
     return;
@@ -166,11 +414,35 @@ static void Z_FreeTag(int tag)
 
 static void *Z_ReallocTag(void *ptr, size_t n, int tag)
 {
-  void *p = Z_MallocTag(n, tag);
+  void *p;
+  zone_category_t category = zone_category;
+
+#ifndef ZONEDEBUG
+  if (ptr && n && tag == ZONE_LEVEL)
+  {
+    memblock_t *block = (memblock_t *)((char *) ptr - HEADER_SIZE);
+
+    if (block->signature == ARENA_SIGNATURE && Z_ArenaResize(block, n))
+      return ptr;
+  }
+#endif
+
+  // A block keeps its category when it moves
+  if (ptr && ((memblock_t *)((char *) ptr - HEADER_SIZE))->signature == ZONE_SIGNATURE)
+    zone_category = ((memblock_t *)((char *) ptr - HEADER_SIZE))->category;
+
+  p = Z_MallocTag(n, tag);
+  zone_category = category;
+
   if (ptr)
     {
       memblock_t *block = (memblock_t *)((char *) ptr - HEADER_SIZE);
-      memcpy(p, ptr, n <= block->size ? n : block->size);
+      size_t size = block->size;
+
+      if (block->signature == POOL_SIGNATURE)
+        size = pools[((poolslot_t *) ptr - 1)->pool].stride - sizeof(poolslot_t);
+
+      memcpy(p, ptr, n <= size ? n : size);
       Z_Free(ptr);
     }
   return p;
@@ -231,3 +503,93 @@ char *Z_StrdupLevel(const char *s)
 {
   return Z_StrdupTag(s, ZONE_LEVEL);
 }
+
+void *Z_MallocPool(zone_pool_id_t id, size_t size)
+{
+#ifdef ZONEDEBUG
+  // Keep every object in its own block so memory tools can see it
+  return Z_MallocLevel(size);
+#else
+  zone_pool_t *pool = &pools[id];
+  poolslot_t *slot;
+  char *p;
+
+  if (!pool->stride)
+    pool->stride = (size + sizeof(poolslot_t) + CACHE_LINE_SIZE - 1) & ~(size_t) (CACHE_LINE_SIZE - 1);
+  else if (size + sizeof(poolslot_t) > pool->stride)
+    I_Error("Z_MallocPool: %lu bytes do not fit in pool %d", (unsigned long) size, id);
+
+  if (pool->free_list)
+  {
+    p = pool->free_list;
+    pool->free_list = *(void **) p;
+  }
+  else
+  {
+    if (!pool->top || pool->end - pool->top < (ptrdiff_t) pool->stride)
+    {
+      char *slab = Z_MallocLevel(POOL_SLAB_SIZE);
+
+      pool->top = (char *) (((uintptr_t) slab + sizeof(poolslot_t) + CACHE_LINE_SIZE - 1) &
+                            ~(uintptr_t) (CACHE_LINE_SIZE - 1));
+      pool->end = slab + POOL_SLAB_SIZE;
+    }
+
+    p = pool->top;
+    pool->top += pool->stride;
+  }
+
+  slot = (poolslot_t *) p - 1;
+  slot->pool = id;
+  slot->signature = POOL_SIGNATURE;
+
+  return p;
+#endif
+}
+
+void *Z_CallocPool(zone_pool_id_t id, size_t size)
+{
+  return memset(Z_MallocPool(id, size), 0, size);
+}
+
+zone_category_t Z_SetCategory(zone_category_t category)
+{
+  zone_category_t previous = zone_category;
+
+  zone_category = category;
+
+  return previous;
+}
+
+const char *Z_CategoryName(zone_category_t category)
+{
+  return zone_category_names[category];
+}
+
+void Z_GetStats(zone_stats_t *category_stats, zone_stats_t *total_stats)
+{
+  if (category_stats)
+    memcpy(category_stats, zone_stats, sizeof(zone_stats));
+
+  if (total_stats)
+    *total_stats = zone_total;
+}
+
+void Z_PrintStats(void)
+{
+  int i;
+
+  lprintf(LO_INFO, "\nZone memory:\n");
+  lprintf(LO_INFO, "  %-12s %12s %12s %12s\n", "category", "live KB", "peak KB", "allocations");
+
+  for (i = 0; i < ZONE_CAT_MAX; ++i)
+    lprintf(LO_INFO, "  %-12s %12lu %12lu %12lu\n", zone_category_names[i],
+            (unsigned long) (zone_stats[i].live / 1024),
+            (unsigned long) (zone_stats[i].peak / 1024),
+            zone_stats[i].allocations);
+
+  lprintf(LO_INFO, "  %-12s %12lu %12lu %12lu\n", "total",
+          (unsigned long) (zone_total.live / 1024),
+          (unsigned long) (zone_total.peak / 1024),
+          zone_total.allocations);
+}
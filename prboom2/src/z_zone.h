@@ -49,6 +49,23 @@
 
 #include <stddef.h>
 
+// Memory is accounted by the subsystem that asked for it
+typedef enum {
+  ZONE_CAT_GENERAL,
+  ZONE_CAT_LEVEL,
+  ZONE_CAT_RENDERER,
+  ZONE_CAT_WAD,
+  ZONE_CAT_KEY_FRAME,
+  ZONE_CAT_SOUND,
+  ZONE_CAT_MAX
+} zone_category_t;
+
+typedef struct {
+  size_t live;
+  size_t peak;
+  unsigned long allocations;
+} zone_stats_t;
+
 void Z_Free(void *ptr);
 void Z_FreeLevel(void);
 
@@ -62,4 +79,24 @@ void *Z_CallocLevel(size_t n, size_t n2);
 void *Z_ReallocLevel(void *p, size_t n);
 char *Z_StrdupLevel(const char *s);
 
+// Level lifetime pools for frequently created objects, freed with Z_Free
+typedef enum {
+  ZONE_POOL_MOBJ,
+  ZONE_POOL_SECNODE,
+  ZONE_POOL_FLOOR,
+  ZONE_POOL_CEILING,
+  ZONE_POOL_DOOR,
+  ZONE_POOL_PLAT,
+  ZONE_POOL_MAX
+} zone_pool_id_t;
+
+void *Z_MallocPool(zone_pool_id_t id, size_t size);
+void *Z_CallocPool(zone_pool_id_t id, size_t size);
+
+// Sets the category charged for static allocations and returns the old one
+zone_category_t Z_SetCategory(zone_category_t category);
+const char *Z_CategoryName(zone_category_t category);
+void Z_GetStats(zone_stats_t *category_stats, zone_stats_t *total_stats);
+void Z_PrintStats(void);
+
 #endif
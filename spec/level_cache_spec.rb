@@ -0,0 +1,30 @@
+require 'fileutils'
+require 'tmpdir'
+
+RSpec.describe 'level cache' do
+  let(:data) { Dir.mktmpdir('dsda-data') }
+  let(:lmp) { 'lv01-039.lmp' }
+
+  # -blockmap builds the blockmap instead of loading the lump
+  let(:extra) { "-blockmap -data #{data}" }
+
+  after do
+    FileUtils.rm_rf(data)
+  end
+
+  def load_map
+    Utility.play_demo_output(lmp: lmp, extra: extra)
+  end
+
+  context 'when the same map is loaded twice' do
+    it 'builds the sections the first time' do
+      expect(load_map).not_to include('Level cache reused')
+    end
+
+    it 'reuses the blockmap and geometry the second time' do
+      load_map
+
+      expect(load_map).to match(/Level cache reused bmap geom/)
+    end
+  end
+end
@@ -0,0 +1,206 @@
+# Plays a manifest of demos on a pool of dsda-doom-headless processes
+#
+# ruby spec/support/batch_runner.rb manifest.json [-j workers] [-o results.json] [-b binary]
+#
+# The manifest lists the demos and the wads they need. Paths are relative
+# to the manifest file:
+#
+# {
+#   "demos": [
+#     { "lmp": "lmps/30uv1755.lmp", "iwad": "wads/DOOM2.WAD" },
+#     { "lmp": "lmps/ru12-2114.lmp", "iwad": "wads/DOOM2.WAD",
+#       "pwad": ["wads/rush.wad"], "extra": "-complevel 9" }
+#   ]
+# }
+#
+# Demos with the same iwad, pwads and extra options are split into chunks,
+# and each chunk is played by one process with -batch, so the wads are
+# loaded once per chunk. If a demo crashes its process, the rest of its
+# chunk is played by a new one.
+
+require 'etc'
+require 'json'
+require 'optparse'
+require 'shellwords'
+require 'tmpdir'
+
+module BatchRunner
+  extend self
+
+  TICRATE = 35.0
+  WORLD_HASH_HEADER = 4
+  WORLD_HASH_FRAME = 16
+
+  def run(manifest_path, binary:, workers:, output:, chunk:)
+    root = File.dirname(File.expand_path(manifest_path))
+    demos = JSON.parse(File.read(manifest_path))['demos']
+    queue = Queue.new
+    results = []
+    lock = Mutex.new
+    started = Time.now
+
+    demos.each_with_index
+         .group_by { |demo, _| [demo['iwad'].to_s, Array(demo['pwad']), demo['extra'].to_s] }
+         .each_value do |group|
+           size = [[(group.size.to_f / workers).ceil, 1].max, chunk].min
+           group.each_slice(size) { |slice| queue << slice }
+         end
+
+    threads = Array.new(workers) do
+      Thread.new do
+        loop do
+          slice = begin
+            queue.pop(true)
+          rescue ThreadError
+            break
+          end
+
+          played, rest = play(slice, root, binary)
+
+          lock.synchronize do
+            played.each do |(demo, i), result|
+              results[i] = result
+              puts "#{result['status'] == 0 ? 'ok    ' : 'failed'} #{demo['lmp']}"
+            end
+          end
+
+          queue << rest unless rest.empty?
+        end
+      end
+    end
+
+    threads.each(&:join)
+
+    File.write(output, JSON.pretty_generate('demos' => results))
+
+    elapsed = Time.now - started
+    failed = results.count { |result| result['status'] != 0 }
+    puts "#{results.size} demos, #{failed} failed, #{elapsed.round(1)}s"
+
+    failed == 0
+  end
+
+  # Returns the results for the demos that were reached and the demos
+  # left over after a crash
+  def play(slice, root, binary)
+    Dir.mktmpdir('dsda-batch') do |dir|
+      demo = slice.first.first
+      list = File.join(dir, 'demos.txt')
+      out = File.join(dir, 'out')
+
+      File.write(list, slice.map { |d, _| File.expand_path(d['lmp'], root) }.join("\n") + "\n")
+
+      command = [binary]
+      command += ['-iwad', File.expand_path(demo['iwad'], root)]
+      pwads = Array(demo['pwad']).map { |pwad| File.expand_path(pwad, root) }
+      command += ['-file', *pwads] unless pwads.empty?
+      command += ['-batch', list, out]
+      command += %w[-nosound -nomusic -nodraw -levelstat -analysis]
+      command += ['-config', File.join(dir, 'dsda-doom.cfg')]
+      command += Shellwords.split(demo['extra']) if demo['extra']
+
+      pid = Process.spawn(*command, chdir: dir, out: File::NULL, err: File.join(dir, 'stderr.txt'))
+      Process.wait(pid)
+      status = $?.exitstatus
+
+      played = []
+
+      slice.each_with_index do |(d, i), n|
+        result = read_demo(File.join(out, n.to_s), d)
+
+        if result.nil?
+          result = {
+            'lmp' => d['lmp'],
+            'status' => status == 0 ? 1 : status,
+            'error' => File.read(File.join(dir, 'stderr.txt')).lines.last(5).join
+          }
+          played << [[d, i], result]
+
+          return played, slice.drop(n + 1)
+        end
+
+        played << [[d, i], result]
+      end
+
+      return played, []
+    end
+  end
+
+  def read_demo(dir, demo)
+    summary = File.join(dir, 'demo.txt')
+    return nil unless File.exist?(summary)
+
+    fields = Hash[File.readlines(summary, chomp: true).map { |line| line.split(' ', 2) }]
+
+    result = {
+      'lmp' => demo['lmp'],
+      'status' => 0,
+      'gametics' => fields['gametics'].to_i,
+      'seconds' => (fields['realtics'].to_i / TICRATE).round(3)
+    }
+
+    result.merge!(read_world_hash(File.join(dir, 'world.wsh')))
+    result.merge!(read_levelstat(File.join(dir, 'levelstat.txt')))
+    result['analysis'] = read_analysis(File.join(dir, 'analysis.txt'))
+
+    result
+  end
+
+  # The last frame holds the final tic and the sync hash
+  def read_world_hash(path)
+    return {} unless File.exist?(path) && File.size(path) >= WORLD_HASH_HEADER + WORLD_HASH_FRAME
+
+    File.open(path, 'rb') do |file|
+      file.seek(-WORLD_HASH_FRAME, IO::SEEK_END)
+      tic, map, hash = file.read(WORLD_HASH_FRAME).unpack('l<l<Q<')
+
+      { 'final_tic' => tic, 'final_map' => map, 'world_hash' => format('%016x', hash) }
+    end
+  end
+
+  def read_levelstat(path)
+    return {} unless File.exist?(path)
+
+    lines = File.readlines(path, chomp: true).map(&:strip).reject(&:empty?)
+    totals = { 'kills' => 0, 'items' => 0, 'secrets' => 0 }
+
+    lines.each do |line|
+      { 'kills' => 'K', 'items' => 'I', 'secrets' => 'S' }.each do |key, label|
+        totals[key] += Regexp.last_match(1).to_i if line =~ /#{label}:\s*(\d+)\//
+      end
+    end
+
+    { 'levelstat' => lines, 'totals' => totals }
+  end
+
+  def read_analysis(path)
+    return {} unless File.exist?(path)
+
+    Hash[
+      File.readlines(path, chomp: true).map(&:split).map do |a|
+        [a[0], a[1..].join(' ')]
+      end
+    ]
+  end
+end
+
+if __FILE__ == $0
+  options = {
+    binary: File.expand_path('../../build/dsda-doom-headless.exe', __dir__),
+    workers: Etc.nprocessors,
+    output: 'batch_results.json',
+    chunk: 64
+  }
+
+  OptionParser.new do |opts|
+    opts.banner = 'Usage: batch_runner.rb manifest.json [options]'
+    opts.on('-b', '--binary PATH', 'dsda-doom-headless executable') { |v| options[:binary] = File.expand_path(v) }
+    opts.on('-j', '--workers N', Integer, 'parallel processes') { |v| options[:workers] = v }
+    opts.on('-c', '--chunk N', Integer, 'most demos per process') { |v| options[:chunk] = v }
+    opts.on('-o', '--output PATH', 'results file') { |v| options[:output] = v }
+  end.parse!
+
+  abort 'missing manifest' if ARGV.empty?
+
+  exit(BatchRunner.run(ARGV[0], **options) ? 0 : 1)
+end
@@ -1,14 +1,23 @@
 module Utility
   extend self
 
-  def play_demo(lmp:, iwad: "DOOM2.WAD", pwad: nil, extra: nil)
+  def play_demo(**options)
+    system(demo_command(**options))
+  end
+
+  # Returns what the game printed
+  def play_demo_output(**options)
+    `#{demo_command(**options)}`
+  end
+
+  def demo_command(lmp:, iwad: "DOOM2.WAD", pwad: nil, extra: nil)
     command = "./build/dsda-doom.exe -iwad spec/support/wads/#{iwad}"
     command << " -file spec/support/wads/#{pwad}" if pwad
     command << " -fastdemo \"spec/support/lmps/#{lmp}\""
     command << " -nosound -nomusic -nodraw -levelstat -analysis"
     command << " #{extra}" if extra
 
-    system(command)
+    command
   end
 
   def read_analysis
@@ -46,6 +46,28 @@ RSpec.describe 'sync' do
       it { is_expected.to eq('5:13') }
     end
 
+    # demos that stress the engine's lookup structures
+    [
+      # target index: arch-vile raises and many kills
+      ['doom2 ep 3 max in 26:54 by Vile', '26:54', 'lve3-2654.lmp'],
+      # target index: nightmare respawns
+      ['doom2 map 2 uv respawn in 1:07 by Looper', '1:07', 're02-107.lmp'],
+      # noise alerts: gunfire across a whole map
+      ['doom2 map 1 uv max in 0:39 by Xit Vono', '0:39', 'lv01-039.lmp'],
+      # noise alerts: nightmare episode, monsters woken and respawning
+      ['doom2 episode 1 nm100s in 11:56 by JCD', '11:56', '1156ns01.lmp'],
+      # blockmap line checks: fast monsters crowding the player
+      ['doom2 map 4 uv fast in 1:09 by Radek Pecka', '1:09', 'fa04-109.lmp'],
+      # blockmap line checks: nightmare speed through tight geometry
+      ['doom2 map 4 nm speed in 0:36 by Vile', '0:36', 'nm04-036.lmp'],
+    ].each do |lmp_description, lmp_time, lmp_file|
+      context lmp_description do
+        let(:lmp) { lmp_file }
+
+        it { is_expected.to eq(lmp_time) }
+      end
+    end
+
     # heretic
     context 'heretic' do
       let(:iwad) { "DOOM.WAD" }